@@ -1,71 +1,543 @@
-// ClientData.cpp
-// Class ClientData stores customer's credit information.
-#include <string>
-#include "ClientData.h"
-using namespace std;
-
-// default ClientData constructor
-ClientData::ClientData( int accountNumberValue, 
-   string lastNameValue, string firstNameValue, double balanceValue )
-{
-   setAccountNumber( accountNumberValue );
-   setLastName( lastNameValue );
-   setFirstName( firstNameValue );
-   setBalance( balanceValue );
-} // end ClientData constructor
-
-// get account-number value
-int ClientData::getAccountNumber() const
-{
-   return accountNumber;
-} // end function getAccountNumber
-
-// set account-number value
-void ClientData::setAccountNumber( int accountNumberValue )
-{
-   accountNumber = accountNumberValue; // should validate
-} // end function setAccountNumber
-
-// get last-name value
-string ClientData::getLastName() const
-{
-   return lastName;
-} // end function getLastName
-
-// set last-name value
-void ClientData::setLastName( string lastNameString )
-{
-   // copy at most 15 characters from string to lastName
-   int length = lastNameString.size();
-   length = ( length < 15 ? length : 14 );
-   lastNameString.copy( lastName, length );
-   lastName[ length ] = '\0'; // append null character to lastName
-} // end function setLastName
-
-// get first-name value
-string ClientData::getFirstName() const
-{
-   return firstName;
-} // end function getFirstName
-
-// set first-name value
-void ClientData::setFirstName( string firstNameString )
-{
-   // copy at most 10 characters from string to firstName
-   int length = firstNameString.size();
-   length = ( length < 10 ? length : 9 );
-   firstNameString.copy( firstName, length );
-   firstName[ length ] = '\0'; // append null character to firstName
-} // end function setFirstName
-
-// get balance value
-double ClientData::getBalance() const
-{
-   return balance;
-} // end function getBalance
-
-// set balance value
-void ClientData::setBalance( double balanceValue )
-{
-   balance = balanceValue;
-} // end function setBalance
+// ClientData.cpp
+// Class ClientData stores customer's credit information.
+#include <string>
+#include <sstream>
+#include <cstddef> // offsetof
+#include <cstring> // memset, memcpy, memcmp
+#include <cmath> // floor
+#include <vector>
+#include <algorithm> // min, max
+#include <fstream>
+#include <cerrno> // errno
+#include <fcntl.h> // open, posix_fallocate
+#include <unistd.h> // pwrite, ftruncate, lseek, close
+#include <sys/file.h> // flock
+#include <sys/stat.h> // stat, fstat
+#include <cstdio> // rename
+// the crc32 instruction is compiled in whatever the flags of the
+// build, and used if the processor has it
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define CRC32C_INSTRUCTION
+#include <nmmintrin.h> // crc32 instruction
+#endif
+#include "ClientData.h"
+using namespace std;
+
+// first bytes of credit.dat
+static const char CREDIT_MAGIC[ 8 ] = 
+   { 'C', 'R', 'E', 'D', 'I', 'T', 'D', 'B' };
+
+// the header must fill the space before the first record
+typedef char CreditHeaderSizeCheck[ 
+   sizeof( CreditFileHeader ) == CREDIT_HEADER_SIZE ? 1 : -1 ];
+
+// default ClientData constructor
+ClientData::ClientData( int accountNumberValue, 
+   string lastNameValue, string firstNameValue, double balanceValue )
+{
+   // zero fill so unused bytes are the same in every record
+   memset( lastName, 0, sizeof( lastName ) );
+   memset( firstName, 0, sizeof( firstName ) );
+   memset( reserved, 0, sizeof( reserved ) );
+   setAccountNumber( accountNumberValue );
+   setLastName( lastNameValue );
+   setFirstName( firstNameValue );
+   setBalance( balanceValue );
+} // end ClientData constructor
+
+// get account-number value
+int ClientData::getAccountNumber() const
+{
+   return accountNumber;
+} // end function getAccountNumber
+
+// set account-number value
+void ClientData::setAccountNumber( int accountNumberValue )
+{
+   accountNumber = accountNumberValue; // should validate
+} // end function setAccountNumber
+
+// get last-name value
+string ClientData::getLastName() const
+{
+   return lastName;
+} // end function getLastName
+
+// set last-name value
+void ClientData::setLastName( string lastNameString )
+{
+   // copy at most 15 characters from string to lastName
+   int length = lastNameString.size();
+   length = ( length < 15 ? length : 14 );
+   lastNameString.copy( lastName, length );
+   lastName[ length ] = '\0'; // append null character to lastName
+} // end function setLastName
+
+// get first-name value
+string ClientData::getFirstName() const
+{
+   return firstName;
+} // end function getFirstName
+
+// set first-name value
+void ClientData::setFirstName( string firstNameString )
+{
+   // copy at most 10 characters from string to firstName
+   int length = firstNameString.size();
+   length = ( length < 10 ? length : 9 );
+   firstNameString.copy( firstName, length );
+   firstName[ length ] = '\0'; // append null character to firstName
+} // end function setFirstName
+
+// get balance value in dollars
+double ClientData::getBalance() const
+{
+   return balanceCents / 100.0;
+} // end function getBalance
+
+// set balance value in dollars
+void ClientData::setBalance( double balanceValue )
+{
+   balanceCents = dollarsToCents( balanceValue );
+} // end function setBalance
+
+// get balance value in cents
+int64_t ClientData::getBalanceCents() const
+{
+   return balanceCents;
+} // end function getBalanceCents
+
+// set balance value in cents
+void ClientData::setBalanceCents( int64_t balanceValue )
+{
+   balanceCents = balanceValue;
+} // end function setBalanceCents
+
+// FNV-1a hash of the field offsets and sizes, with the balance
+// described by the name of its field
+uint32_t ClientData::hashLayout( const char *balanceName )
+{
+   ostringstream layout;
+   layout << "accountNumber:" << offsetof( ClientData, accountNumber ) 
+      << ':' << sizeof( int32_t )
+      << ";lastName:" << offsetof( ClientData, lastName ) << ':' << 15
+      << ";firstName:" << offsetof( ClientData, firstName ) << ':' << 10
+      << ";reserved:" << offsetof( ClientData, reserved ) << ':' << 3
+      << ';' << balanceName << ':' << offsetof( ClientData, balanceCents ) 
+      << ':' << sizeof( balanceCents )
+      << ";size:" << sizeof( ClientData );
+
+   // FNV-1a over the description
+   string text = layout.str();
+   uint32_t hash = 2166136261u;
+   for ( size_t i = 0; i < text.size(); i++ )
+   {
+      hash ^= static_cast< unsigned char >( text[ i ] );
+      hash *= 16777619u;
+   } // end for
+
+   return hash;
+} // end function hashLayout
+
+// hash of the field offsets and sizes, so a file written with
+// another layout of the record is refused instead of misread
+uint32_t ClientData::layoutHash()
+{
+   return hashLayout( "balanceCents" );
+} // end function layoutHash
+
+// hash of the layout of files whose balance is a double in dollars,
+// which took the place and size of balanceCents
+uint32_t ClientData::doubleLayoutHash()
+{
+   return hashLayout( "balance" );
+} // end function doubleLayoutHash
+
+// dollars rounded to the nearest cent, halves away from zero
+int64_t dollarsToCents( double dollars )
+{
+   double cents = floor( fabs( dollars ) * 100 + 0.5 );
+   if ( cents != cents ) // NaN
+      return 0;
+   if ( cents >= 9223372036854775808.0 ) // 2^63
+      return dollars < 0 ? INT64_MIN : INT64_MAX;
+   return static_cast< int64_t >( dollars < 0 ? -cents : cents );
+} // end function dollarsToCents
+
+// write cents as dollars with two decimals
+int formatCents( char *text, int64_t cents )
+{
+   // digits backwards, at least three so there is a whole dollar
+   uint64_t magnitude = ( cents < 0 )
+      ? 0 - static_cast< uint64_t >( cents )
+      : static_cast< uint64_t >( cents );
+   char digits[ 20 ];
+   int count = 0;
+   do
+   {
+      digits[ count++ ] = '0' + magnitude % 10;
+      magnitude /= 10;
+   } while ( magnitude > 0 || count < 3 );
+
+   int length = 0;
+   if ( cents < 0 )
+      text[ length++ ] = '-';
+   while ( count > 2 )
+      text[ length++ ] = digits[ --count ];
+   text[ length++ ] = '.';
+   text[ length++ ] = digits[ 1 ];
+   text[ length++ ] = digits[ 0 ];
+   text[ length ] = '\0';
+   return length;
+} // end function formatCents
+
+// read dollars with at most two decimals as exact cents
+int parseCents( const char *text, int64_t &cents )
+{
+   const char *next = text;
+   bool negative = ( *next == '-' );
+   if ( *next == '-' || *next == '+' )
+      next++;
+
+   // whole dollars, at most 16 digits so the cents fit
+   uint64_t value = 0;
+   int digits = 0;
+   for ( ; *next >= '0' && *next <= '9'; next++, digits++ )
+      value = value * 10 + ( *next - '0' );
+
+   // up to two decimals
+   int decimals = 0;
+   if ( *next == '.' )
+      for ( next++; *next >= '0' && *next <= '9'; next++, decimals++ )
+         value = value * 10 + ( *next - '0' );
+
+   if ( digits + decimals == 0 || digits > 16 || decimals > 2 )
+      return 0;
+   for ( ; decimals < 2; decimals++ )
+      value *= 10;
+
+   cents = negative ? -static_cast< int64_t >( value )
+                    : static_cast< int64_t >( value );
+   return next - text;
+} // end function parseCents
+
+// header for a credit.dat of a number of account records
+CreditFileHeader makeCreditHeader( int recordCount )
+{
+   CreditFileHeader header;
+   memset( &header, 0, sizeof( CreditFileHeader ) );
+   memcpy( header.magic, CREDIT_MAGIC, sizeof( CREDIT_MAGIC ) );
+   header.version = CREDIT_VERSION;
+   header.headerSize = CREDIT_HEADER_SIZE;
+   header.recordSize = sizeof( ClientData );
+   header.byteOrder = CREDIT_BYTE_ORDER;
+   header.layoutHash = ClientData::layoutHash();
+   header.recordCount = recordCount;
+   return header;
+} // end function makeCreditHeader
+
+// read the header of credit.dat and check it describes its records
+bool readCreditHeader( istream &inFile, CreditFileHeader &header, 
+   string &reason, bool acceptHashed )
+{
+   inFile.seekg( 0 );
+   inFile.read( reinterpret_cast< char * >( &header ), 
+      sizeof( CreditFileHeader ) );
+
+   if ( !inFile 
+      || memcmp( header.magic, CREDIT_MAGIC, sizeof( CREDIT_MAGIC ) ) != 0 )
+      reason = "file has no header, upgrade it with UpgradeRAFile";
+   else if ( header.byteOrder != CREDIT_BYTE_ORDER )
+      reason = "file was written on a host of another byte order";
+   else if ( header.version == CREDIT_HASHED_VERSION && !acceptHashed )
+      reason = "file is hashed by account number, use TransactionProcessing";
+   else if ( header.version != CREDIT_VERSION 
+      && header.version != CREDIT_HASHED_VERSION )
+      reason = "file format version is not supported";
+   else if ( header.layoutHash == ClientData::doubleLayoutHash() )
+      reason = "balances of the file are doubles, convert it with CentsRAFile";
+   else if ( header.headerSize != CREDIT_HEADER_SIZE 
+      || header.recordSize != sizeof( ClientData )
+      || header.layoutHash != ClientData::layoutHash() )
+      reason = "records of the file have another layout";
+   else if ( header.recordCount < 0 || header.accountsInUse < 0 
+      || header.accountsInUse > header.recordCount )
+      reason = "record count of the file is corrupt";
+   else
+      reason = "";
+
+   inFile.clear(); // a short file leaves the stream failed
+   return reason.empty();
+} // end function readCreditHeader
+
+// true if credit.dat starts with the magic of the header
+bool hasCreditHeader( istream &inFile )
+{
+   char magic[ sizeof( CREDIT_MAGIC ) ];
+   inFile.seekg( 0 );
+   inFile.read( magic, sizeof( magic ) );
+   bool found = inFile
+      && memcmp( magic, CREDIT_MAGIC, sizeof( CREDIT_MAGIC ) ) == 0;
+   inFile.clear(); // a short file leaves the stream failed
+   return found;
+} // end function hasCreditHeader
+
+// byte offset of an account record in credit.dat
+streamoff accountPosition( int accountNumber )
+{
+   // records follow the header
+   return CREDIT_HEADER_SIZE 
+      + static_cast< streamoff >( accountNumber - 1 ) * sizeof( ClientData );
+} // end function accountPosition
+
+// create a records file of blank records without writing them
+bool createCreditFile( const string &name, const CreditFileHeader &header,
+   bool preallocate, string &reason )
+{
+   off_t size = CREDIT_HEADER_SIZE
+      + static_cast< off_t >( header.recordCount ) * sizeof( ClientData );
+   int fd = open( name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+   if ( fd < 0 )
+   {
+      reason = strerror( errno );
+      return false;
+   } // end if
+
+   // reserving the blocks is an error only if the space is missing;
+   // a file system that cannot reserve them leaves the file sparse
+   int error = preallocate ? posix_fallocate( fd, 0, size ) : 0;
+   if ( error == EINVAL || error == EOPNOTSUPP )
+      error = 0;
+   if ( error == 0 && ( pwrite( fd, &header, sizeof( header ), 0 )
+      != static_cast< ssize_t >( sizeof( header ) )
+      || ftruncate( fd, size ) < 0 ) )
+      error = errno;
+
+   if ( close( fd ) < 0 && error == 0 )
+      error = errno;
+   if ( error != 0 )
+      reason = strerror( error );
+   return error == 0;
+} // end function createCreditFile
+
+// the next run of records that holds written bytes
+bool findWrittenRecords( int fd, int64_t from, int64_t last,
+   int64_t &first, int64_t &end )
+{
+   if ( from > last )
+      return false;
+   first = from;
+   end = last + 1;
+
+#if defined( SEEK_DATA ) && defined( SEEK_HOLE )
+   off_t data = lseek( fd, accountPosition( static_cast< int >( from ) ),
+      SEEK_DATA );
+   if ( data < 0 )
+      return errno != ENXIO; // ENXIO: nothing is written past from
+
+   // the records the data and the hole after it touch
+   off_t hole = lseek( fd, data, SEEK_HOLE );
+   int64_t dataRecord = ( data - CREDIT_HEADER_SIZE )
+      / static_cast< off_t >( sizeof( ClientData ) ) + 1;
+   first = max( from, dataRecord );
+   if ( first > last )
+      return false;
+   if ( hole > data )
+      end = min( last + 1, ( hole - CREDIT_HEADER_SIZE
+         + static_cast< off_t >( sizeof( ClientData ) ) - 1 )
+         / static_cast< off_t >( sizeof( ClientData ) ) + 1 );
+#endif
+   return true;
+} // end function findWrittenRecords
+
+// take the writer lock of a records file
+int lockCreditFile( const string &name, string &reason )
+{
+   // a writer that replaces the file holds the lock of the old file
+   // until the new one has the name, so a lock taken on a file that
+   // was replaced meanwhile is taken again on the new one
+   for ( int tries = 0; tries < 3; tries++ )
+   {
+      int fd = open( name.c_str(), O_RDWR );
+      if ( fd < 0 )
+      {
+         reason = strerror( errno );
+         return -1;
+      } // end if
+      if ( flock( fd, LOCK_EX | LOCK_NB ) < 0 )
+      {
+         reason = ( errno == EWOULDBLOCK
+            ? "file is being written by another program" : strerror( errno ) );
+         close( fd );
+         return -1;
+      } // end if
+
+      struct stat locked;
+      struct stat named;
+      if ( fstat( fd, &locked ) == 0 && stat( name.c_str(), &named ) == 0
+         && locked.st_dev == named.st_dev && locked.st_ino == named.st_ino )
+         return fd;
+      close( fd );
+   } // end for
+
+   reason = "file is being replaced by another program";
+   return -1;
+} // end function lockCreditFile
+
+// rename a new records file over a locked one
+bool replaceCreditFile( const string &newName, const string &name,
+   int &lock )
+{
+   string reason;
+   int newLock = lockCreditFile( newName, reason );
+   if ( newLock < 0 )
+      return false;
+   if ( rename( newName.c_str(), name.c_str() ) != 0 )
+   {
+      close( newLock );
+      return false;
+   } // end if
+
+   // the old file is released only once the new one has the name
+   if ( lock >= 0 )
+      close( lock );
+   lock = newLock;
+   return true;
+} // end function replaceCreditFile
+
+#ifdef CRC32C_INSTRUCTION
+// CRC32C of a record with the crc32 instruction, one instruction per
+// four bytes of the record
+__attribute__(( target( "sse4.2" ) ))
+static uint32_t recordCrcInstruction( const unsigned char *bytes )
+{
+   uint32_t crc = 0xffffffffu;
+   for ( size_t i = 0; i < sizeof( ClientData ); i += 4 )
+   {
+      uint32_t word;
+      memcpy( &word, bytes + i, 4 );
+      crc = _mm_crc32_u32( crc, word );
+   } // end for
+   return crc;
+} // end function recordCrcInstruction
+
+// whether the processor has the crc32 instruction (SSE4.2)
+static bool hasCrcInstruction()
+{
+   __builtin_cpu_init(); // the check may run before main
+   return __builtin_cpu_supports( "sse4.2" );
+} // end function hasCrcInstruction
+
+// checked before main, so threads can share it
+static const bool crcInstruction = hasCrcInstruction();
+#endif
+
+// CRC32C of an account record, never zero
+uint32_t accountChecksum( const ClientData &record )
+{
+   const unsigned char *bytes = 
+      reinterpret_cast< const unsigned char * >( &record );
+   uint32_t crc = 0xffffffffu;
+
+#ifdef CRC32C_INSTRUCTION
+   if ( crcInstruction )
+      crc = recordCrcInstruction( bytes );
+   else
+#endif
+   {
+      // table of the CRC of each byte value, built on first use
+      static uint32_t table[ 256 ];
+      static bool tableBuilt = false;
+      if ( !tableBuilt )
+      {
+         for ( uint32_t byte = 0; byte < 256; byte++ )
+         {
+            uint32_t value = byte;
+            for ( int bit = 0; bit < 8; bit++ )
+               value = ( value >> 1 ) ^ ( ( value & 1 ) ? 0x82f63b78u : 0 );
+            table[ byte ] = value;
+         } // end for
+         tableBuilt = true;
+      } // end if
+
+      for ( size_t i = 0; i < sizeof( ClientData ); i++ )
+         crc = ( crc >> 8 ) ^ table[ ( crc ^ bytes[ i ] ) & 0xff ];
+   } // end else
+
+   crc = ~crc;
+   return crc != 0 ? crc : 1; // zero marks a missing checksum
+} // end function accountChecksum
+
+// a closed set of checksums
+AccountChecksums::AccountChecksums()
+   : fd( -1 )
+{
+} // end AccountChecksums constructor
+
+// close credit.crc
+AccountChecksums::~AccountChecksums()
+{
+   close();
+} // end AccountChecksums destructor
+
+// open credit.crc if it exists
+bool AccountChecksums::open()
+{
+   close();
+   fd = ::open( CREDIT_CHECKSUM_FILE, O_RDWR );
+   return fd >= 0;
+} // end function open
+
+// close credit.crc
+void AccountChecksums::close()
+{
+   if ( fd >= 0 )
+      ::close( fd );
+   fd = -1;
+} // end function close
+
+// read the checksums of a run of records
+void AccountChecksums::read( int first, int count, uint32_t *sums )
+{
+   // a record past the end of credit.crc has no checksum
+   ssize_t bytes = ( fd < 0 ) ? 0 : pread( fd, sums, count * sizeof( uint32_t ),
+      static_cast< off_t >( first - 1 ) * sizeof( uint32_t ) );
+   int sumsRead = ( bytes > 0 ) ? bytes / sizeof( uint32_t ) : 0;
+   for ( int i = sumsRead; i < count; i++ )
+      sums[ i ] = 0;
+} // end function read
+
+// store the checksums of a run of records
+bool AccountChecksums::write( int first, int count, const ClientData *records )
+{
+   if ( fd < 0 )
+      return true; // the checksums are optional
+
+   vector< uint32_t > sums( count );
+   for ( int i = 0; i < count; i++ )
+      sums[ i ] = accountChecksum( records[ i ] );
+   ssize_t bytes = count * sizeof( uint32_t );
+   return pwrite( fd, &sums[ 0 ], bytes,
+      static_cast< off_t >( first - 1 ) * sizeof( uint32_t ) ) == bytes;
+} // end function write
+
+// check a run of records against their checksums
+bool AccountChecksums::verify( int first, int count,
+   const ClientData *records )
+{
+   if ( fd < 0 )
+      return true;
+
+   vector< uint32_t > sums( count );
+   read( first, count, &sums[ 0 ] );
+   bool intact = true;
+   for ( int i = 0; i < count; i++ )
+      // a record without a checksum is not checked
+      if ( sums[ i ] != 0 && sums[ i ] != accountChecksum( records[ i ] ) )
+      {
+         cerr << "Account #" << first + i
+            << " fails its checksum, the record is damaged." << endl;
+         intact = false;
+      } // end if
+   return intact;
+} // end function verify
@@ -1,28 +1,60 @@
-// CreatRAFile.cpp
-// Creating a randomly accessed file.
-#include <iostream>
-#include <fstream>
-#include <cstdlib> // exit function prototype
-#include "ClientData.h" // ClientData class definition
-using namespace std;
-
-int main()
-{
-   ofstream outCredit( "credit.dat", ios::out | ios::binary );
-
-   // exit program if ofstream could not open file
-   if ( !outCredit ) 
-   {
-      cerr << "File could not be opened." << endl;
-      exit( 1 );
-   } // end if
-
-   ClientData blankClient; // constructor zeros out each data member
-
-   // output 100 blank records to file
-   for ( int i = 0; i < 100; i++ )
-      outCredit.write(
-                    reinterpret_cast< const char * >( &blankClient ),
-                    sizeof( ClientData )
-                );
-} // end main
+// CreatRAFile.cpp
+// Creating a randomly accessed file.
+// usage: CreatRAFile [records] [-p]
+// the blank records are not written: a blank record is all zero
+// bytes, which is what a sparse file reads as where nothing was
+// written, so the file is created in the same time for 100 records
+// as for tens of millions. -p reserves the blocks of the records.
+#include <iostream>
+#include <fstream>
+#include <cstdlib> // exit, atol function prototypes
+#include <climits> // INT_MAX
+#include <cstring> // strcmp
+#include <cerrno> // errno
+#include <fcntl.h> // open
+#include <unistd.h> // ftruncate, close
+#include "ClientData.h" // ClientData class definition
+using namespace std;
+
+int main( int argc, char *argv[] )
+{
+   int64_t accountCount = 100; // records in the file
+   bool preallocate = false;
+   for ( int i = 1; i < argc; i++ )
+      if ( strcmp( argv[ i ], "-p" ) == 0 )
+         preallocate = true;
+      else
+         accountCount = atol( argv[ i ] );
+
+   // account numbers are ints, so are the records
+   if ( accountCount < 1 || accountCount > INT_MAX )
+   {
+      cerr << "usage: " << argv[ 0 ] << " [records] [-p]" << endl;
+      exit( 1 );
+   } // end if
+
+   // output the header describing the records, followed by blank
+   // records the file system fills in
+   string reason;
+   if ( !createCreditFile( "credit.dat", makeCreditHeader(
+      static_cast< int >( accountCount ) ), preallocate, reason ) )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+
+   // a checksum of each record, records are checked against them
+   // whenever they are read; a zero checksum means none, which is
+   // what the blank records get
+   int sums = open( CREDIT_CHECKSUM_FILE, O_WRONLY | O_CREAT | O_TRUNC,
+      0644 );
+   if ( sums < 0 || ftruncate( sums,
+      static_cast< off_t >( accountCount ) * sizeof( uint32_t ) ) < 0 )
+   {
+      cerr << CREDIT_CHECKSUM_FILE << ": " << strerror( errno ) << endl;
+      exit( 1 );
+   } // end if
+   close( sums );
+
+   cout << "credit.dat: " << accountCount << " blank record(s)" << endl;
+} // end main
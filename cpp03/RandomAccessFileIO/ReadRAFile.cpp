@@ -1,58 +1,96 @@
-// ReadRAFile.cpp
-// Reading a random-access file sequentially.
-#include <iostream>
-#include <iomanip>
-#include <fstream>
-#include <cstdlib> // exit function prototype
-#include "ClientData.h" // ClientData class definition
-using namespace std;
- 
-void outputLine( ostream&, const ClientData & ); // prototype
-
-int main()
-{
-   ifstream inCredit( "credit.dat", ios::in | ios::binary );
-
-   // exit program if ifstream cannot open file
-   if ( !inCredit ) 
-   {
-      cerr << "File could not be opened." << endl;
-      exit( 1 );
-   } // end if
-
-   cout << left << setw( 10 ) << "Account" << setw( 16 )
-      << "Last Name" << setw( 11 ) << "First Name" << left
-      << setw( 10 ) << right << "Balance" << endl;
-
-   ClientData client; // create record
-
-   // read first record from file
-   inCredit.read(
-                reinterpret_cast< char * >( &client ),
-                sizeof( ClientData )
-            );
-
-   // read all records from file
-   while ( inCredit && !inCredit.eof() ) 
-   {
-      // display record
-      if ( client.getAccountNumber() != 0 )
-         outputLine( cout, client );
-
-      // read next from file
-      inCredit.read(
-                    reinterpret_cast< char * >( &client ),
-                    sizeof( ClientData )
-                );
-   } // end while
-} // end main
-
-// display single record
-void outputLine( ostream &output, const ClientData &record )
-{
-   output << left << setw( 10 ) << record.getAccountNumber()
-      << setw( 16 ) << record.getLastName()
-      << setw( 11 ) << record.getFirstName()
-      << setw( 10 ) << setprecision( 2 ) << right << fixed 
-      << showpoint << record.getBalance() << endl;
-} // end function outputLine
+// ReadRAFile.cpp
+// Reading a random-access file sequentially.
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <algorithm> // min
+#include <cstdlib> // exit function prototype
+#include <fcntl.h> // open
+#include <unistd.h> // close
+#include "ClientData.h" // ClientData class definition
+using namespace std;
+ 
+void outputLine( ostream&, const ClientData & ); // prototype
+
+// records read with one read
+const int BATCH_RECORDS = 1024;
+
+int main()
+{
+   ifstream inCredit( "credit.dat", ios::in | ios::binary );
+
+   // exit program if ifstream cannot open file
+   if ( !inCredit ) 
+   {
+      cerr << "File could not be opened." << endl;
+      exit( 1 );
+   } // end if
+
+   // exit program if the file does not describe its records
+   CreditFileHeader header;
+   string reason;
+   if ( !readCreditHeader( inCredit, header, reason ) )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+
+   cout << left << setw( 10 ) << "Account" << setw( 16 )
+      << "Last Name" << setw( 11 ) << "First Name" << left
+      << setw( 10 ) << right << "Balance" << endl;
+
+   // records are read, and checked against credit.crc, a batch
+   // at a time
+   vector< ClientData > batch( BATCH_RECORDS );
+   AccountChecksums checksums;
+   checksums.open();
+
+   // the regions of a sparse file that were never written hold blank
+   // records, they are skipped rather than read
+   int regions = open( "credit.dat", O_RDONLY );
+   int64_t first;
+   int64_t end;
+
+   // read all records counted by the header that were written
+   for ( int64_t from = 1; findWrittenRecords( regions, from,
+      header.recordCount, first, end ); from = end )
+   {
+      // records follow the header
+      inCredit.seekg( accountPosition( static_cast< int >( first ) ) );
+
+      for ( int64_t next = first; inCredit && next < end;
+         next += BATCH_RECORDS )
+      {
+         int count = static_cast< int >(
+            min< int64_t >( BATCH_RECORDS, end - next ) );
+         inCredit.read( reinterpret_cast< char * >( &batch[ 0 ] ),
+            count * sizeof( ClientData ) );
+         // the file may be shorter than its header says
+         int recordsRead = inCredit.gcount() / sizeof( ClientData );
+
+         // warn about damaged records
+         checksums.verify( static_cast< int >( next ), recordsRead,
+            &batch[ 0 ] );
+
+         // display records
+         for ( int i = 0; i < recordsRead; i++ )
+            if ( batch[ i ].getAccountNumber() != 0 )
+               outputLine( cout, batch[ i ] );
+      } // end for
+
+      if ( !inCredit )
+         break;
+   } // end for
+   close( regions );
+} // end main
+
+// display single record
+void outputLine( ostream &output, const ClientData &record )
+{
+   output << left << setw( 10 ) << record.getAccountNumber()
+      << setw( 16 ) << record.getLastName()
+      << setw( 11 ) << record.getFirstName()
+      << setw( 10 ) << setprecision( 2 ) << right << fixed 
+      << showpoint << record.getBalance() << endl;
+} // end function outputLine
@@ -0,0 +1,144 @@
+// UpgradeRAFile.cpp
+// Add the header to a credit.dat written before the file format had
+// one, converting its double balances in dollars to whole cents.
+// the account numbers and names are kept, credit.crc is rewritten
+// for the records.
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm> // min
+#include <climits> // INT_MAX
+#include <cstdio> // remove
+#include <cstdlib> // exit
+#include <cstring> // memcpy, strerror
+#include <cerrno> // errno
+#include <fcntl.h> // open
+#include <unistd.h> // ftruncate, close
+#include "ClientData.h" // ClientData class definition
+using namespace std;
+
+// records upgraded at a time (about 1 MiB)
+const int UPGRADE_RECORDS = ( 1 << 20 ) / sizeof( ClientData );
+
+int main()
+{
+   // no other program writes the file while it is upgraded
+   string reason;
+   int lock = lockCreditFile( "credit.dat", reason );
+   if ( lock < 0 )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+
+   ifstream oldFile( "credit.dat", ios::in | ios::binary );
+   if ( !oldFile )
+   {
+      cerr << "File could not be opened." << endl;
+      exit( 1 );
+   } // end if
+
+   if ( hasCreditHeader( oldFile ) )
+   {
+      cout << "credit.dat already has a header." << endl;
+      return 0;
+   } // end if
+
+   // the old file is bare records of the same size, the balance a
+   // double where the cents now lie
+   oldFile.seekg( 0, ios::end );
+   int64_t size = oldFile.tellg();
+   int64_t recordCount = size / sizeof( ClientData );
+   if ( size <= 0 || size % sizeof( ClientData ) != 0
+      || recordCount > INT_MAX )
+   {
+      cerr << "credit.dat is not a file of account records." << endl;
+      exit( 1 );
+   } // end if
+
+   // the new file is renamed over the old one when complete
+   CreditFileHeader header =
+      makeCreditHeader( static_cast< int >( recordCount ) );
+   ofstream newFile( "credit.dat.tmp", ios::out | ios::binary );
+   newFile.write( reinterpret_cast< const char * >( &header ),
+      sizeof( CreditFileHeader ) );
+
+   // a checksum of each record, as CreatRAFile keeps
+   int sums = open( CREDIT_CHECKSUM_FILE, O_WRONLY | O_CREAT | O_TRUNC,
+      0644 );
+   if ( sums < 0 || ftruncate( sums,
+      static_cast< off_t >( recordCount ) * sizeof( uint32_t ) ) < 0 )
+   {
+      cerr << CREDIT_CHECKSUM_FILE << ": " << strerror( errno ) << endl;
+      exit( 1 );
+   } // end if
+   close( sums );
+   AccountChecksums checksums;
+   checksums.open();
+
+   vector< ClientData > batch( UPGRADE_RECORDS );
+   int64_t upgraded = 0;
+   int64_t rounded = 0; // balances that were not a whole cent
+   bool valid = true;
+   oldFile.seekg( 0 );
+   for ( int64_t first = 1; valid && first <= recordCount;
+      first += UPGRADE_RECORDS )
+   {
+      int count = static_cast< int >(
+         min< int64_t >( UPGRADE_RECORDS, recordCount - first + 1 ) );
+      oldFile.read( reinterpret_cast< char * >( &batch[ 0 ] ),
+         count * sizeof( ClientData ) );
+      if ( !oldFile )
+      {
+         valid = false;
+         break;
+      } // end if
+
+      for ( int i = 0; i < count; i++ )
+      {
+         // the bits of the old double lie where the cents go
+         int64_t bits = batch[ i ].getBalanceCents();
+         double balance;
+         memcpy( &balance, &bits, sizeof( balance ) );
+
+         int accountNumber = batch[ i ].getAccountNumber();
+         if ( accountNumber == 0 ) // empty record
+         {
+            batch[ i ] = ClientData();
+            continue;
+         } // end if
+         if ( balance - balance != 0 ) // infinity or NaN
+         {
+            cerr << "Account #" << accountNumber
+               << " has no valid balance." << endl;
+            valid = false;
+         } // end if
+
+         // built afresh, so the bytes the compiler left as padding
+         // in the old record are zero
+         batch[ i ] = ClientData( accountNumber, batch[ i ].getLastName(),
+            batch[ i ].getFirstName(), balance );
+         upgraded++;
+         rounded += ( batch[ i ].getBalance() != balance );
+      } // end for
+
+      newFile.write( reinterpret_cast< const char * >( &batch[ 0 ] ),
+         count * sizeof( ClientData ) );
+      valid = valid
+         && checksums.write( static_cast< int >( first ), count, &batch[ 0 ] );
+   } // end for
+   newFile.close();
+
+   if ( !valid || newFile.fail()
+      || !replaceCreditFile( "credit.dat.tmp", "credit.dat", lock ) )
+   {
+      cerr << "credit.dat could not be upgraded." << endl;
+      remove( "credit.dat.tmp" );
+      exit( 1 );
+   } // end if
+
+   cout << "Upgraded credit.dat to format version " << CREDIT_VERSION
+      << ", " << recordCount << " record(s), " << upgraded
+      << " account(s), " << rounded
+      << " balance(s) rounded to the nearest cent." << endl;
+} // end main
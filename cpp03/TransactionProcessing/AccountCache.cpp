@@ -0,0 +1,199 @@
+// AccountCache.cpp
+// Member-function definitions for class AccountCache.
+#include <iostream>
+#include <ctime> // clock_gettime
+#include "AccountCache.h" // AccountCache class definition
+using namespace std;
+
+// cache the accounts of an open file
+AccountCache::AccountCache( AccountFile &accountFile, int accounts,
+   int seconds )
+   : file( accountFile ), capacity( accounts > 0 ? accounts : 1 ),
+     flushSeconds( seconds ), hits( 0 ), misses( 0 ), stopping( false )
+{
+   pthread_mutex_init( &mutex, 0 );
+   pthread_cond_init( &stopped, 0 );
+   if ( flushSeconds > 0 )
+      pthread_create( &flusher, 0, flushPeriodically, this );
+} // end AccountCache constructor
+
+// stop the flushing thread and write back all changes
+AccountCache::~AccountCache()
+{
+   pthread_mutex_lock( &mutex );
+   stopping = true;
+   pthread_cond_signal( &stopped );
+   pthread_mutex_unlock( &mutex );
+   if ( flushSeconds > 0 )
+      pthread_join( flusher, 0 );
+
+   flush();
+   pthread_cond_destroy( &stopped );
+   pthread_mutex_destroy( &mutex );
+} // end AccountCache destructor
+
+// the entry of an account, read from the file on a miss
+AccountCache::Entry &AccountCache::lookup( int accountNumber )
+{
+   map< int, Entry >::iterator found = entries.find( accountNumber );
+   if ( found != entries.end() )
+   {
+      // move the account to the front of recent
+      recent.splice( recent.begin(), recent, found->second.age );
+      hits++;
+      return found->second;
+   } // end if
+
+   // make room by evicting the least recently used account
+   if ( entries.size() >= capacity )
+   {
+      map< int, Entry >::iterator oldest = entries.find( recent.back() );
+      if ( !oldest->second.dirty
+         || writeBack( oldest->first, oldest->second ) )
+      {
+         entries.erase( oldest );
+         recent.pop_back();
+      } // end if
+   } // end if
+
+   misses++;
+   Entry &entry = entries[ accountNumber ];
+   entry.exists = file.read( accountNumber, entry.record );
+   entry.inFile = entry.exists;
+   entry.dirty = false;
+   recent.push_front( accountNumber );
+   entry.age = recent.begin();
+   return entry;
+} // end function lookup
+
+// make the file agree with an entry
+bool AccountCache::writeBack( int accountNumber, Entry &entry )
+{
+   if ( entry.exists )
+   {
+      if ( !file.write( entry.record ) )
+      {
+         cerr << "Account #" << accountNumber
+            << " could not be written." << endl;
+         return false;
+      } // end if
+      entry.inFile = true;
+   } // end if
+   else if ( entry.inFile )
+   {
+      if ( !file.remove( accountNumber ) )
+      {
+         cerr << "Account #" << accountNumber
+            << " could not be deleted." << endl;
+         return false;
+      } // end if
+      entry.inFile = false;
+   } // end else if
+
+   entry.dirty = false;
+   dirtyAccounts.erase( accountNumber );
+   return true;
+} // end function writeBack
+
+// read the record of an account
+bool AccountCache::read( int accountNumber, ClientData &record )
+{
+   if ( accountNumber < 1 || accountNumber > getMaxAccount() )
+      return false;
+
+   pthread_mutex_lock( &mutex );
+   Entry &entry = lookup( accountNumber );
+   if ( entry.exists )
+      record = entry.record;
+   bool exists = entry.exists;
+   pthread_mutex_unlock( &mutex );
+   return exists;
+} // end function read
+
+// write the record of an account, adding the account if new
+bool AccountCache::write( const ClientData &record )
+{
+   int accountNumber = record.getAccountNumber();
+   if ( !file.isWriter()
+      || accountNumber < 1 || accountNumber > getMaxAccount() )
+      return false;
+
+   pthread_mutex_lock( &mutex );
+   Entry &entry = lookup( accountNumber );
+   entry.record = record;
+   entry.exists = true;
+   entry.dirty = true;
+   dirtyAccounts.insert( accountNumber );
+   pthread_mutex_unlock( &mutex );
+   return true;
+} // end function write
+
+// blank the record of an account
+bool AccountCache::remove( int accountNumber )
+{
+   if ( !file.isWriter()
+      || accountNumber < 1 || accountNumber > getMaxAccount() )
+      return false;
+
+   pthread_mutex_lock( &mutex );
+   Entry &entry = lookup( accountNumber );
+   bool existed = entry.exists;
+   if ( existed )
+   {
+      entry.record = ClientData();
+      entry.exists = false;
+      entry.dirty = true;
+      dirtyAccounts.insert( accountNumber );
+   } // end if
+   pthread_mutex_unlock( &mutex );
+   return existed;
+} // end function remove
+
+// write back all changes
+bool AccountCache::flush()
+{
+   pthread_mutex_lock( &mutex );
+   bool written = flushLocked();
+   pthread_mutex_unlock( &mutex );
+   return written;
+} // end function flush
+
+// write back all changes with the mutex held
+bool AccountCache::flushLocked()
+{
+   bool written = true;
+
+   // removes go first, so a hashed file does not grow for
+   // accounts that are about to leave it. only the dirty accounts
+   // are visited, so a flush costs as much as the changes it writes
+   for ( int pass = 0; pass < 2; pass++ )
+      for ( set< int >::iterator account = dirtyAccounts.begin();
+         account != dirtyAccounts.end(); )
+      {
+         int accountNumber = *account++; // writeBack() erases it
+         Entry &entry = entries[ accountNumber ];
+         if ( entry.exists == ( pass == 1 ) )
+            written = writeBack( accountNumber, entry ) && written;
+      } // end for
+
+   return written;
+} // end function flushLocked
+
+// body of the thread that flushes every flushSeconds
+void *AccountCache::flushPeriodically( void *argument )
+{
+   AccountCache &cache = *static_cast< AccountCache * >( argument );
+
+   pthread_mutex_lock( &cache.mutex );
+   while ( !cache.stopping )
+   {
+      timespec wakeUp;
+      clock_gettime( CLOCK_REALTIME, &wakeUp );
+      wakeUp.tv_sec += cache.flushSeconds;
+      pthread_cond_timedwait( &cache.stopped, &cache.mutex, &wakeUp );
+      if ( !cache.stopping )
+         cache.flushLocked();
+   } // end while
+   pthread_mutex_unlock( &cache.mutex );
+   return 0;
+} // end function flushPeriodically
@@ -0,0 +1,93 @@
+// AccountCache.h
+// Class AccountCache keeps recently used accounts of credit.dat in
+// memory and writes changed ones back later.
+#ifndef ACCOUNTCACHE_H
+#define ACCOUNTCACHE_H
+
+#include <map>
+#include <set>
+#include <list>
+#include <string>
+#include <pthread.h>
+#include "ClientData.h" // ClientData class definition
+#include "AccountFile.h" // AccountFile class definition
+using namespace std;
+
+// AccountCache reads, writes and removes accounts like AccountFile,
+// through a cache of the most recently used accounts. a read of a
+// cached account, or of one known to be missing, needs no I/O, and
+// writes and removes only change the cache and mark the account
+// dirty. dirty accounts are written back when they are evicted to
+// make room, by flush(), on destruction and by a thread every
+// number of seconds, so a crash loses at most that many seconds of
+// changes. a write that fails at write-back is reported on cerr and
+// kept dirty to be tried again.
+//
+// the file must only be used through the cache while it exists, and
+// no other program may write it: cached accounts would hide its
+// changes, and write-backs would overwrite them. the file must hold
+// the writer lock (AccountFile::lockWriter) for the life of the
+// cache, and writes and removes are refused while it does not, so
+// they fail at once rather than seconds later at write-back.
+class AccountCache
+{
+public:
+   // cache up to a number of accounts of an open file holding the
+   // writer lock, writing changes back every number of seconds (0
+   // for only on flush)
+   AccountCache( AccountFile &, int, int );
+   ~AccountCache(); // writes back all changes
+
+   const string &getFileName() const { return file.getFileName(); }
+   int getMaxAccount() const { return file.getMaxAccount(); }
+
+   // read the record of an account, false if there is none
+   bool read( int, ClientData & );
+   // write the record of an account, adding the account if new
+   bool write( const ClientData & );
+   // blank the record of an account, false if there is none
+   bool remove( int );
+
+   // write back all changes, false if any could not be written
+   bool flush();
+
+   // reads served from the cache and from the file
+   long getHits() const { return hits; }
+   long getMisses() const { return misses; }
+
+private:
+   // an account as the cache knows it
+   struct Entry
+   {
+      ClientData record;
+      bool exists; // the account has a record
+      bool inFile; // the file holds a record of the account
+      bool dirty; // exists or record differs from the file
+      list< int >::iterator age; // position in recent
+   }; // end struct Entry
+
+   // the entry of an account, read from the file on a miss
+   Entry &lookup( int );
+   // make the file agree with an entry
+   bool writeBack( int, Entry & );
+   // write back all changes with the mutex held
+   bool flushLocked();
+   // body of the thread that flushes every flushSeconds
+   static void *flushPeriodically( void * );
+
+   AccountFile &file;
+   map< int, Entry > entries;
+   list< int > recent; // cached accounts, most recently used first
+   set< int > dirtyAccounts; // accounts of the dirty entries
+   size_t capacity;
+   int flushSeconds;
+   long hits;
+   long misses;
+
+   pthread_mutex_t mutex; // guards the cache and the file
+   pthread_cond_t stopped; // signalled when the cache is destroyed
+   bool stopping;
+   pthread_t flusher;
+}; // end class AccountCache
+
+#endif
@@ -0,0 +1,249 @@
+// AccountClient.cpp
+// This program is a teller of the account server: it offers the
+// menu of TransactionProcessing, and sends each choice to the server
+// that owns credit.dat instead of opening the file.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib> // exit, atoi
+#include <cerrno> // errno
+#include <csignal> // signal
+#include <unistd.h> // read, write, close
+#include "ClientData.h" // ClientData class definition
+#include "AccountService.h" // connectService, fields of the requests
+#include "PrintFile.h" // outputLine
+using namespace std;
+
+int enterChoice();
+void createTextFile( int );
+void updateRecord( int );
+void newRecord( int );
+void deleteRecord( int );
+int getAccount( int, const char * const );
+vector< string > request( int, const string & );
+
+enum Choices { PRINT = 1, UPDATE, NEW, DELETE, END };
+
+int main()
+{
+   // the server of the current directory holds credit.dat
+   int service = connectService();
+   if ( service < 0 )
+   {
+      cerr << CREDIT_SOCKET_FILE << ": no account server is running."
+         << endl;
+      exit( 1 );
+   } // end if
+   // a server that went away is seen by request()
+   signal( SIGPIPE, SIG_IGN );
+
+   int choice; // store user choice
+
+   // enable user to specify action
+   while ( ( choice = enterChoice() ) != END )
+   {
+      switch ( choice )
+      {
+         case PRINT: // have the server create the text file
+            createTextFile( service );
+            break;
+         case UPDATE: // update record
+            updateRecord( service );
+            break;
+         case NEW: // create record
+            newRecord( service );
+            break;
+         case DELETE: // delete existing record
+            deleteRecord( service );
+            break;
+         default: // display error if user does not select valid choice
+            cerr << "Incorrect choice" << endl;
+            break;
+      } // end switch
+   } // end while
+
+   close( service );
+} // end main
+
+// enable user to input menu choice
+int enterChoice()
+{
+   // display available options
+   cout << "\nEnter your choice" << endl
+      << "1 - store a formatted text file of accounts" << endl
+      << "    called \"print.txt\" for printing" << endl
+      << "2 - update an account" << endl
+      << "3 - add a new account" << endl
+      << "4 - delete an account" << endl
+      << "5 - end program\n? ";
+
+   int menuChoice;
+   cin >> menuChoice; // input menu selection from user
+   return menuChoice;
+} // end function enterChoice
+
+// have the server write print.txt, in its directory
+void createTextFile( int service )
+{
+   vector< string > reply = request( service, "print" );
+   if ( reply[ 0 ] != "ok" )
+   {
+      cerr << "File could not be created." << endl;
+      exit( 1 );
+   } // end if
+} // end function createTextFile
+
+// update balance in record
+void updateRecord( int service )
+{
+   // obtain number of account to update
+   int accountNumber = getAccount( service, "Enter account to update" );
+   string account = numberText( accountNumber );
+
+   // read record of the account from the server
+   ClientData client;
+   vector< string > reply = request( service, "read\t" + account );
+
+   // update record
+   if ( reply[ 0 ] == "ok" && parseRecord( reply, 1, client ) )
+   {
+      outputLine( cout, client ); // display the record
+
+      // request user to specify transaction
+      cout << "\nEnter charge (+) or payment (-): ";
+      double transaction; // charge or payment
+      cin >> transaction;
+
+      // the server adds the whole cents to the balance it holds, so
+      // tellers updating the account at once do not undo each other
+      reply = request( service, "update\t" + account + '\t'
+         + numberText( dollarsToCents( transaction ) ) );
+      if ( reply[ 0 ] == "ok" && parseRecord( reply, 1, client ) )
+         outputLine( cout, client ); // display the record
+      else if ( reply[ 0 ] == "none" )
+         cerr << "Account #" << accountNumber
+            << " has no information." << endl;
+      else
+         cerr << "Account #" << accountNumber
+            << " could not be written." << endl;
+   } // end if
+   else // display error if account does not exist
+      cerr << "Account #" << accountNumber
+         << " has no information." << endl;
+} // end function updateRecord
+
+// create and insert record
+void newRecord( int service )
+{
+   // obtain number of account to create
+   int accountNumber = getAccount( service, "Enter new account number" );
+   string account = numberText( accountNumber );
+
+   // create record, if record does not previously exist
+   vector< string > reply = request( service, "read\t" + account );
+   if ( reply[ 0 ] == "none" )
+   {
+      string lastName;
+      string firstName;
+      double balance;
+
+      // user enters last name, first name and balance
+      cout << "Enter lastname, firstname, balance\n? ";
+      cin >> lastName;
+      cin >> firstName;
+      cin >> balance;
+
+      // use values to populate account values
+      ClientData client( accountNumber, lastName, firstName, balance );
+
+      // the server refuses the account if another teller added it
+      reply = request( service, "new\t" + recordFields( client ) );
+      if ( reply[ 0 ] == "exists" )
+         cerr << "Account #" << accountNumber
+            << " already contains information." << endl;
+      else if ( reply[ 0 ] != "ok" )
+         cerr << "Account #" << accountNumber
+            << " could not be written." << endl;
+   } // end if
+   else // display error if account already exists
+      cerr << "Account #" << accountNumber
+         << " already contains information." << endl;
+} // end function newRecord
+
+// delete an existing record
+void deleteRecord( int service )
+{
+   // obtain number of account to delete
+   int accountNumber = getAccount( service, "Enter account to delete" );
+
+   // the server blanks the record, if the account exists
+   vector< string > reply = request( service,
+      "delete\t" + numberText( accountNumber ) );
+   if ( reply[ 0 ] == "ok" )
+   {
+      cout << "Account #" << accountNumber << " deleted.\n";
+   } // end if
+   else // display error if record does not exist
+      cerr << "Account #" << accountNumber << " is empty.\n";
+} // end deleteRecord
+
+// obtain account-number value from user
+int getAccount( int service, const char * const prompt )
+{
+   // the largest account number depends on the file the server holds
+   vector< string > reply = request( service, "max" );
+   int maxAccount = ( reply.size() > 1 ? atoi( reply[ 1 ].c_str() ) : 0 );
+   int accountNumber;
+
+   // obtain account-number value
+   do
+   {
+      cout << prompt << " (1 - " << maxAccount << "): ";
+      cin >> accountNumber;
+   } while ( accountNumber < 1 || accountNumber > maxAccount );
+
+   return accountNumber;
+} // end function getAccount
+
+// send a request line to the server and return the fields of its
+// reply; exit if the server is gone
+vector< string > request( int service, const string &line )
+{
+   static string received; // bytes of the server past the last reply
+   string message = line + '\n';
+   size_t sent = 0;
+   while ( sent < message.size() )
+   {
+      ssize_t bytes = write( service, message.data() + sent,
+         message.size() - sent );
+      if ( bytes < 0 && errno == EINTR )
+         continue;
+      if ( bytes <= 0 )
+         break;
+      sent += bytes;
+   } // end while
+
+   string::size_type end;
+   while ( sent == message.size()
+      && ( end = received.find( '\n' ) ) == string::npos )
+   {
+      char buffer[ 4096 ];
+      ssize_t bytes = read( service, buffer, sizeof( buffer ) );
+      if ( bytes < 0 && errno == EINTR )
+         continue;
+      if ( bytes <= 0 )
+         break;
+      received.append( buffer, bytes );
+   } // end while
+
+   end = received.find( '\n' );
+   if ( sent < message.size() || end == string::npos )
+   {
+      cerr << "The account server closed the connection." << endl;
+      exit( 1 );
+   } // end if
+
+   vector< string > reply = splitFields( received.substr( 0, end ) );
+   received.erase( 0, end + 1 );
+   return reply;
+} // end function request
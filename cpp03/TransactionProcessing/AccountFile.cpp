@@ -0,0 +1,459 @@
+// AccountFile.cpp
+// Member-function definitions for class AccountFile.
+#include <cstdio> // remove
+#include <vector>
+#include <algorithm> // min, max
+#include <cerrno> // errno
+#include <fcntl.h> // open
+#include <unistd.h> // pwrite, ftruncate, close
+#include "AccountFile.h" // AccountFile class definition
+using namespace std;
+
+// slots read with one read while probing (about 4 KiB)
+static const int PROBE_SLOTS = 4096 / sizeof( ClientData );
+// slots per read or write when a whole file is copied (about 1 MiB)
+static const int COPY_SLOTS = ( 1 << 20 ) / sizeof( ClientData );
+// fewest and most slots of a hashed file
+static const int MIN_SLOTS = 64;
+static const int MAX_SLOTS = 1 << 30;
+
+// create a closed account file
+AccountFile::AccountFile()
+   : hashed( false ), slotCount( 0 ), hashBits( 0 ), keepChecksums( false ),
+     lockFd( -1 ), writerFd( -1 ), keepSnapshots( false )
+{
+   header = makeCreditHeader( 0 );
+} // end AccountFile constructor
+
+// close the file, releasing its descriptors and locks
+AccountFile::~AccountFile()
+{
+   close();
+} // end AccountFile destructor
+
+// open a credit.dat of either organization
+bool AccountFile::open( const string &name, string &reason )
+{
+   close();
+   file.open( name.c_str(), ios::in | ios::out | ios::binary );
+   if ( !file )
+   {
+      reason = "file could not be opened";
+      return false;
+   } // end if
+
+   if ( !readCreditHeader( file, header, reason, true ) )
+   {
+      file.close();
+      return false;
+   } // end if
+
+   hashed = ( header.version == CREDIT_HASHED_VERSION );
+   slotCount = static_cast< int >( header.recordCount );
+   hashBits = 0;
+   while ( hashed && ( 1 << hashBits ) < slotCount )
+      hashBits++;
+
+   // probing wraps at a power of two slots and needs a free slot
+   if ( hashed && ( slotCount < MIN_SLOTS || ( 1 << hashBits ) != slotCount
+      || header.accountsInUse >= slotCount ) )
+   {
+      reason = "slot count of the hashed file is corrupt";
+      file.close();
+      return false;
+   } // end if
+
+   fileName = name;
+   keepChecksums = true;
+   checksums.open();
+   lockFd = ::open( name.c_str(), O_RDWR );
+   keepSnapshots = ( lockFd >= 0 );
+   return true;
+} // end function open
+
+// close the file
+void AccountFile::close()
+{
+   if ( file.is_open() )
+      file.close();
+   file.clear();
+   checksums.close();
+   if ( lockFd >= 0 )
+      ::close( lockFd );
+   lockFd = -1;
+   if ( writerFd >= 0 )
+      ::close( writerFd );
+   writerFd = -1;
+   slotCount = 0;
+} // end function close
+
+// take the writer lock of the file
+bool AccountFile::lockWriter( string &reason )
+{
+   if ( writerFd >= 0 )
+      return true;
+   if ( !file.is_open() )
+   {
+      reason = "file is not open";
+      return false;
+   } // end if
+
+   string name = fileName;
+   int lock = lockCreditFile( name, reason );
+   if ( lock < 0 )
+      return false;
+
+   // another writer may have changed the header, or replaced the
+   // file, since it was opened
+   if ( !open( name, reason ) )
+   {
+      ::close( lock );
+      return false;
+   } // end if
+   writerFd = lock;
+   return true;
+} // end function lockWriter
+
+// largest account number the file can hold
+int AccountFile::getMaxAccount() const
+{
+   return hashed ? MAX_ACCOUNT_NUMBER : slotCount;
+} // end function getMaxAccount
+
+// read a run of slots into an array
+int AccountFile::readSlots( int first, int count, ClientData *records )
+{
+   file.seekg( accountPosition( first ) );
+   file.read( reinterpret_cast< char * >( records ),
+      static_cast< streamsize >( count ) * sizeof( ClientData ) );
+   int slotsRead = file.gcount() / sizeof( ClientData );
+   file.clear(); // a short read at the end of file fails the stream
+   return slotsRead;
+} // end function readSlots
+
+// home slot of an account in a hashed file
+int AccountFile::homeSlot( int accountNumber ) const
+{
+   // multiplicative (Fibonacci) hashing: the top bits of the
+   // product spread consecutive account numbers over the file
+   uint64_t product =
+      static_cast< uint64_t >( accountNumber ) * 0x9e3779b97f4a7c15ULL;
+   return static_cast< int >( product >> ( 64 - hashBits ) ) + 1;
+} // end function homeSlot
+
+// slot holding an account, or the free slot it would take, 0 if
+// there is neither; the record in the slot is read into the argument
+int AccountFile::find( int accountNumber, ClientData &record, bool &found )
+{
+   found = false;
+   if ( accountNumber < 1 || accountNumber > getMaxAccount() )
+      return 0;
+
+   if ( !hashed ) // account n is record n
+   {
+      if ( readSlots( accountNumber, 1, &record ) != 1 )
+         return 0;
+      found = ( record.getAccountNumber() != 0 );
+      return accountNumber;
+   } // end if
+
+   // read a page of slots at a time from the home slot, the
+   // account is in the run of used slots that starts there
+   ClientData run[ PROBE_SLOTS ];
+   int slot = homeSlot( accountNumber );
+   for ( int probed = 0; probed < slotCount; )
+   {
+      int count = min( PROBE_SLOTS, slotCount - slot + 1 );
+      int slotsRead = readSlots( slot, count, run );
+
+      for ( int i = 0; i < slotsRead; i++ )
+      {
+         if ( run[ i ].getAccountNumber() == accountNumber
+            || run[ i ].getAccountNumber() == 0 )
+         {
+            found = ( run[ i ].getAccountNumber() != 0 );
+            record = run[ i ];
+            return slot + i;
+         } // end if
+      } // end for
+
+      if ( slotsRead < count )
+         return 0; // the file is shorter than its header says
+      probed += count;
+      slot = nextSlot( slot + count - 1 );
+   } // end for
+
+   return 0; // no free slot
+} // end function find
+
+// read the record of an account
+bool AccountFile::read( int accountNumber, ClientData &record )
+{
+   bool found;
+   int slot = find( accountNumber, record, found );
+
+   // warn about a damaged record
+   if ( slot != 0 && keepChecksums )
+      checksums.verify( slot, 1, &record );
+   return found;
+} // end function read
+
+// write the record of an account, adding the account if new
+bool AccountFile::write( const ClientData &record )
+{
+   if ( writerFd < 0 )
+      return false; // another program may be writing the file
+
+   // a snapshot sees all of the update or none of it
+   if ( keepSnapshots )
+      snapshots.begin( lockFd );
+   bool written = writeAccount( record );
+   if ( keepSnapshots )
+      snapshots.end( lockFd );
+   return written;
+} // end function write
+
+// blank the record of an account
+bool AccountFile::remove( int accountNumber )
+{
+   if ( writerFd < 0 )
+      return false;
+
+   if ( keepSnapshots )
+      snapshots.begin( lockFd );
+   bool removed = removeAccount( accountNumber );
+   if ( keepSnapshots )
+      snapshots.end( lockFd );
+   return removed;
+} // end function remove
+
+// write the record of an account as one update
+bool AccountFile::writeAccount( const ClientData &record )
+{
+   int accountNumber = record.getAccountNumber();
+   ClientData current;
+   bool found;
+   int slot = find( accountNumber, current, found );
+
+   if ( found || !hashed )
+      return slot != 0 && writeSlot( slot, record );
+
+   // a new account, the file is kept at most 3/4 full
+   if ( ( header.accountsInUse + 1 ) * 4 > slotCount * 3 )
+   {
+      if ( !grow() )
+         return false;
+      slot = find( accountNumber, current, found );
+   } // end if
+
+   if ( slot == 0 || !writeSlot( slot, record ) )
+      return false;
+   header.accountsInUse++;
+   return writeHeader();
+} // end function writeAccount
+
+// blank the record of an account as one update
+bool AccountFile::removeAccount( int accountNumber )
+{
+   ClientData current;
+   bool found;
+   int slot = find( accountNumber, current, found );
+   if ( !found )
+      return false;
+
+   ClientData blankClient; // constructor zeros out each data member
+   if ( !hashed )
+      return writeSlot( slot, blankClient );
+
+   // a lookup stops at the first free slot, so records later in the
+   // run that would be cut off from their home slot by the blank are
+   // moved back into it (backward shift deletion)
+   int gap = slot;
+   for ( int next = nextSlot( gap ); ; next = nextSlot( next ) )
+   {
+      ClientData moved;
+      if ( readSlots( next, 1, &moved ) != 1
+         || moved.getAccountNumber() == 0 )
+         break; // end of the run
+
+      // a record whose home lies after the gap, up to its
+      // own slot (going round the end of the file), stays
+      int home = homeSlot( moved.getAccountNumber() );
+      bool stays = ( gap < next ) ? ( home > gap && home <= next )
+                                  : ( home > gap || home <= next );
+      if ( stays )
+         continue;
+
+      if ( !writeSlot( gap, moved ) )
+         return false;
+      gap = next;
+   } // end for
+
+   if ( !writeSlot( gap, blankClient ) )
+      return false;
+   header.accountsInUse--;
+   return writeHeader();
+} // end function removeAccount
+
+// write a record to a slot and keep its checksum in step
+bool AccountFile::writeSlot( int slot, const ClientData &record )
+{
+   if ( keepSnapshots )
+      snapshots.preserve( lockFd, accountPosition( slot ),
+         sizeof( ClientData ) );
+   file.seekp( accountPosition( slot ) );
+   file.write( reinterpret_cast< const char * >( &record ),
+      sizeof( ClientData ) );
+   file.flush();
+
+   if ( keepChecksums )
+      checksums.write( slot, 1, &record );
+   return file.good();
+} // end function writeSlot
+
+// write the header with the current counts
+bool AccountFile::writeHeader()
+{
+   if ( keepSnapshots )
+      snapshots.preserve( lockFd, 0, sizeof( CreditFileHeader ) );
+   file.seekp( 0 );
+   file.write( reinterpret_cast< const char * >( &header ),
+      sizeof( CreditFileHeader ) );
+   file.flush();
+   return file.good();
+} // end function writeHeader
+
+// rehash the accounts into a file of twice the slots
+bool AccountFile::grow()
+{
+   if ( slotCount >= MAX_SLOTS )
+      return false;
+
+   // the new file is renamed over the old one when complete
+   string tempName = fileName + ".tmp";
+   if ( !copyAccounts( *this, tempName, slotCount * 2 ) )
+      return false;
+
+   // the lock moves to the new file as it takes the name, so no
+   // other writer can get in between
+   int lock = writerFd;
+   if ( !replaceCreditFile( tempName, fileName, lock ) )
+   {
+      ::remove( tempName.c_str() );
+      return false;
+   } // end if
+
+   string name = fileName, reason;
+   writerFd = -1; // closed by replaceCreditFile
+   close();
+   bool reopened = open( name, reason );
+   writerFd = lock;
+   return reopened && rebuildChecksums();
+} // end function grow
+
+// rewrite credit.crc for the records of the file, if it exists
+bool AccountFile::rebuildChecksums()
+{
+   // the checksums are optional
+   int sums = ::open( CREDIT_CHECKSUM_FILE, O_WRONLY | O_TRUNC );
+   if ( sums < 0 )
+      return errno == ENOENT;
+
+   // a blank record has no checksum, so the file is sized without
+   // writing any and only the runs of slots ever written get theirs:
+   // the file stays as sparse as the records file
+   bool written = ftruncate( sums,
+      static_cast< off_t >( slotCount ) * sizeof( uint32_t ) ) == 0;
+   vector< ClientData > batch( COPY_SLOTS );
+   vector< uint32_t > batchSums( COPY_SLOTS );
+   int64_t first = 1;
+   int64_t runEnd = 1;
+   while ( written )
+   {
+      if ( first >= runEnd && !findWrittenRecords( lockFd, first,
+         slotCount, first, runEnd ) )
+         break;
+      int slotsRead = readSlots( static_cast< int >( first ),
+         static_cast< int >( min< int64_t >( COPY_SLOTS, runEnd - first ) ),
+         &batch[ 0 ] );
+      if ( slotsRead == 0 )
+         break;
+      for ( int i = 0; i < slotsRead; i++ )
+         batchSums[ i ] = accountChecksum( batch[ i ] );
+      ssize_t bytes = slotsRead * sizeof( uint32_t );
+      written = pwrite( sums, &batchSums[ 0 ], bytes,
+         static_cast< off_t >( first - 1 ) * sizeof( uint32_t ) ) == bytes;
+      first += slotsRead;
+   } // end while
+
+   return ( ::close( sums ) == 0 ) && written;
+} // end function rebuildChecksums
+
+// create an empty hashed file of at least a number of slots
+bool AccountFile::create( const string &name, int minimumSlots )
+{
+   int slots = MIN_SLOTS;
+   while ( slots < minimumSlots && slots < MAX_SLOTS )
+      slots *= 2;
+
+   CreditFileHeader newHeader = makeCreditHeader( slots );
+   newHeader.version = CREDIT_HASHED_VERSION;
+
+   // the slots are blank without being written: the file is sparse
+   // until accounts are written into it
+   string reason;
+   return createCreditFile( name, newHeader, false, reason );
+} // end function create
+
+// copy the accounts of a file into a new hashed file
+bool AccountFile::copyAccounts( AccountFile &source, const string &name,
+   int minimumSlots )
+{
+   string reason;
+   AccountFile target;
+   if ( !create( name, minimumSlots ) || !target.open( name, reason )
+      || !target.lockWriter( reason ) )
+      return false;
+   // the checksums of credit.crc belong to the file being copied,
+   // and no snapshot can be pinned of a file not yet in place
+   target.keepChecksums = false;
+   target.keepSnapshots = false;
+
+   vector< ClientData > batch( COPY_SLOTS );
+   for ( int first = 1; first <= source.slotCount; first += COPY_SLOTS )
+   {
+      int slotsRead = source.readSlots( first,
+         min( COPY_SLOTS, source.slotCount - first + 1 ), &batch[ 0 ] );
+      for ( int i = 0; i < slotsRead; i++ )
+         if ( batch[ i ].getAccountNumber() != 0
+            && !target.write( batch[ i ] ) )
+            return false;
+   } // end for
+
+   return true;
+} // end function copyAccounts
+
+// copy the accounts of a direct file into a new hashed file
+bool AccountFile::convert( const string &directName,
+   const string &hashedName, int minimumSlots )
+{
+   string reason;
+   AccountFile source;
+   if ( !source.open( directName, reason ) || source.isHashed() )
+      return false;
+
+   // count the accounts, the new file is at most 3/4 full
+   int64_t accounts = 0;
+   vector< ClientData > batch( COPY_SLOTS );
+   for ( int first = 1; first <= source.slotCount; first += COPY_SLOTS )
+   {
+      int slotsRead = source.readSlots( first,
+         min( COPY_SLOTS, source.slotCount - first + 1 ), &batch[ 0 ] );
+      for ( int i = 0; i < slotsRead; i++ )
+         accounts += ( batch[ i ].getAccountNumber() != 0 );
+   } // end for
+
+   int slots = static_cast< int >(
+      min( static_cast< int64_t >( MAX_SLOTS ), accounts * 4 / 3 + 1 ) );
+   return copyAccounts( source, hashedName, max( minimumSlots, slots ) );
+} // end function convert
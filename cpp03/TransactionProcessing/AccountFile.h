@@ -0,0 +1,114 @@
+// AccountFile.h
+// Class AccountFile finds the account records of credit.dat.
+#ifndef ACCOUNTFILE_H
+#define ACCOUNTFILE_H
+
+#include <fstream>
+#include <string>
+#include "ClientData.h" // ClientData class definition
+#include "Snapshot.h" // SnapshotWriter class definition
+using namespace std;
+
+// largest account number of a hashed file (9 digits)
+const int MAX_ACCOUNT_NUMBER = 999999999;
+
+// AccountFile reads and writes the records of credit.dat by
+// account number, in either organization of the file:
+//
+// - direct (CREDIT_VERSION): account n is record n, so accounts
+//   run from 1 to the record count.
+// - hashed (CREDIT_HASHED_VERSION): the records form an open
+//   addressing hash table. an account is placed at the slot given
+//   by a hash of its number, or at the next free slot after it
+//   (linear probing). the file has a power of two slots and is kept
+//   at most 3/4 full, so an account is almost always within the 4 KiB
+//   read from its home slot: about one I/O per lookup, for any
+//   account number up to MAX_ACCOUNT_NUMBER. a full file is rehashed
+//   into one of twice the slots.
+//
+// slots are numbered from 1, like the records of a direct file, and
+// credit.crc holds one checksum per slot. each write or remove is one
+// update for the snapshots of the file (see Snapshot): pages are
+// copied on write for the snapshots pinned, and none can be pinned
+// while the update is in progress.
+//
+// only the program holding the writer lock of the file (see
+// lockCreditFile) writes to it: several programs updating a hashed
+// file at once would place accounts by counts and slots the others
+// have changed. write and remove are refused until lockWriter()
+// takes the lock, which is held until the file is closed and moves
+// with the file when it grows into a new one.
+class AccountFile
+{
+public:
+   AccountFile();
+   ~AccountFile();
+
+   // open a credit.dat of either organization, with the reason
+   // in the string on failure
+   bool open( const string &, string & );
+   void close();
+
+   // take the writer lock, with the reason in the string if another
+   // program holds it; the file is read again under the lock
+   bool lockWriter( string & );
+   bool isWriter() const { return writerFd >= 0; }
+
+   bool isHashed() const { return hashed; }
+   const string &getFileName() const { return fileName; }
+   // record slots in the file
+   int getSlotCount() const { return slotCount; }
+   // largest account number the file can hold
+   int getMaxAccount() const;
+
+   // read the record of an account, false if there is none
+   bool read( int, ClientData & );
+   // write the record of an account, adding the account if new
+   bool write( const ClientData & );
+   // blank the record of an account, false if there is none
+   bool remove( int );
+
+   // read a run of slots into an array, return slots read
+   int readSlots( int, int, ClientData * );
+   // rewrite credit.crc for the records of the file, if it exists
+   bool rebuildChecksums();
+
+   // create an empty hashed file of at least a number of slots
+   static bool create( const string &, int );
+   // copy the accounts of a direct file into a new hashed file
+   static bool convert( const string &, const string &, int );
+
+private:
+   // write or remove an account, as one update of the file
+   bool writeAccount( const ClientData & );
+   bool removeAccount( int );
+   // slot holding an account, or the free slot it would take
+   int find( int, ClientData &, bool & );
+   // home slot of an account in a hashed file
+   int homeSlot( int ) const;
+   // slot after a slot, wrapping at the end of the file
+   int nextSlot( int slot ) const { return slot < slotCount ? slot + 1 : 1; }
+   // write a record to a slot and keep its checksum in step
+   bool writeSlot( int, const ClientData & );
+   // write the header with the current counts
+   bool writeHeader();
+   // rehash the accounts into a file of twice the slots
+   bool grow();
+   // copy the accounts of a file into a new hashed file
+   static bool copyAccounts( AccountFile &, const string &, int );
+
+   fstream file;
+   string fileName;
+   CreditFileHeader header;
+   bool hashed;
+   int slotCount;
+   int hashBits; // slotCount is 2 to this power
+   bool keepChecksums; // credit.crc describes this file
+   AccountChecksums checksums; // credit.crc, held open
+   int lockFd; // descriptor of the file for record locks
+   int writerFd; // holds the writer lock, -1 without it
+   SnapshotWriter snapshots;
+   bool keepSnapshots; // snapshots may be pinned of this file
+}; // end class AccountFile
+
+#endif
@@ -0,0 +1,40 @@
+// AccountOps.cpp
+// The record operations of TransactionProcessing, without prompts.
+#include <limits> // numeric_limits
+#include "AccountOps.h"
+using namespace std;
+
+// add a charge or payment to the balance of an account
+AccountResult updateAccount( AccountCache &accounts, int accountNumber,
+   int64_t cents, ClientData &record )
+{
+   if ( !accounts.read( accountNumber, record ) )
+      return ACCOUNT_MISSING;
+
+   // the balance is updated in whole cents, so repeated transactions
+   // do not drift
+   int64_t balance = record.getBalanceCents();
+   if ( ( cents > 0 && balance > numeric_limits< int64_t >::max() - cents )
+      || ( cents < 0 && balance < numeric_limits< int64_t >::min() - cents ) )
+      return ACCOUNT_OVERFLOW;
+   record.setBalanceCents( balance + cents );
+
+   // the file is updated when the cache writes the record back
+   return accounts.write( record ) ? ACCOUNT_DONE : ACCOUNT_FAILED;
+} // end function updateAccount
+
+// add an account that has no record yet
+AccountResult addAccount( AccountCache &accounts, const ClientData &record )
+{
+   ClientData existing;
+   if ( accounts.read( record.getAccountNumber(), existing ) )
+      return ACCOUNT_EXISTS;
+   return accounts.write( record ) ? ACCOUNT_DONE : ACCOUNT_FAILED;
+} // end function addAccount
+
+// delete the record of an account
+AccountResult deleteAccount( AccountCache &accounts, int accountNumber )
+{
+   // the record is replaced with a blank one
+   return accounts.remove( accountNumber ) ? ACCOUNT_DONE : ACCOUNT_MISSING;
+} // end function deleteAccount
@@ -0,0 +1,31 @@
+// AccountOps.h
+// The record operations of TransactionProcessing, without prompts:
+// they are driven by the menu, by the account server and by
+// OpBench.
+#ifndef ACCOUNTOPS_H
+#define ACCOUNTOPS_H
+
+#include <stdint.h> // int64_t
+#include "ClientData.h" // ClientData class definition
+#include "AccountCache.h" // AccountCache class definition
+using namespace std;
+
+// outcome of an operation on an account
+enum AccountResult
+{
+   ACCOUNT_DONE, // the account was changed
+   ACCOUNT_MISSING, // the account has no record
+   ACCOUNT_EXISTS, // the account already has a record
+   ACCOUNT_OVERFLOW, // the balance would leave the range of cents
+   ACCOUNT_FAILED // the record could not be written
+}; // end enum AccountResult
+
+// add a charge (+) or payment (-) in cents to the balance of an
+// account, leaving the new record in the last argument
+AccountResult updateAccount( AccountCache &, int, int64_t, ClientData & );
+// add an account that has no record yet
+AccountResult addAccount( AccountCache &, const ClientData & );
+// delete the record of an account
+AccountResult deleteAccount( AccountCache &, int );
+
+#endif
@@ -0,0 +1,328 @@
+// AccountServer.cpp
+// Serve the accounts of credit.dat to tellers over a Unix domain
+// socket. requests that arrive together from any number of tellers
+// are carried out as one batch, and their changes written to the
+// file at once before they are answered. print.txt is written by a
+// child process while the other requests go on being answered.
+#include <iostream>
+#include <map>
+#include <vector>
+#include <algorithm> // find
+#include <cstdio> // remove
+#include <cstdlib> // exit
+#include <cstring> // memset, strncpy
+#include <cerrno> // errno
+#include <csignal> // sig_atomic_t
+#include <fcntl.h> // fcntl
+#include <unistd.h> // read, write, close
+#include <signal.h> // sigaction
+#include <sys/epoll.h> // epoll_create, epoll_ctl, epoll_wait
+#include <sys/socket.h> // socket, bind, listen, accept
+#include <sys/un.h> // sockaddr_un
+#include "AccountFile.h" // AccountFile class definition
+#include "AccountCache.h" // AccountCache class definition
+#include "AccountService.h" // AccountService class definition
+using namespace std;
+
+// accounts kept in memory
+const int CACHE_ACCOUNTS = 65536;
+// events taken from epoll at a time
+const int MAX_EVENTS = 256;
+// longest request line a teller may send
+const size_t MAX_REQUEST = 4096;
+
+// a connected teller
+struct Teller
+{
+   string input; // bytes received, up to an incomplete line
+   string output; // replies not yet sent
+   bool closing; // the teller closed its end, or sent garbage
+   bool printing; // its print request is not answered yet
+}; // end struct Teller
+
+// set when the server is asked to stop
+volatile sig_atomic_t stopping = 0;
+
+void stop( int );
+int listenService();
+void setNonBlocking( int );
+bool receiveRequests( int, Teller & );
+bool sendReplies( int, Teller & );
+
+int main()
+{
+   // the server owns the file: it is opened once, locked for writing
+   // and cached here, and tellers see every change as soon as it is
+   // answered
+   AccountFile creditFile;
+   string reason;
+   if ( !creditFile.open( "credit.dat", reason )
+      || !creditFile.lockWriter( reason ) )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+
+   int listener = listenService();
+   int events = epoll_create( MAX_EVENTS );
+   if ( listener < 0 || events < 0 )
+   {
+      cerr << CREDIT_SOCKET_FILE << ": the server could not listen, "
+         << ( errno == EADDRINUSE ? "it is already running"
+            : strerror( errno ) ) << '.' << endl;
+      exit( 1 );
+   } // end if
+
+   // stop on an interrupt or termination, after the batch at hand
+   struct sigaction action;
+   memset( &action, 0, sizeof( action ) );
+   action.sa_handler = stop;
+   sigaction( SIGINT, &action, 0 );
+   sigaction( SIGTERM, &action, 0 );
+   // a teller that went away is seen by sendReplies()
+   action.sa_handler = SIG_IGN;
+   sigaction( SIGPIPE, &action, 0 );
+
+   epoll_event event;
+   memset( &event, 0, sizeof( event ) );
+   event.events = EPOLLIN;
+   event.data.fd = listener;
+   epoll_ctl( events, EPOLL_CTL_ADD, listener, &event );
+
+   // changes are written back by the batches, not periodically
+   AccountCache cache( creditFile, CACHE_ACCOUNTS, 0 );
+   AccountService service( cache );
+   map< int, Teller > tellers;
+   int printTeller = -1; // teller of the print in progress
+   long requests = 0;
+   long batches = 0;
+   cout << "Serving credit.dat on " << CREDIT_SOCKET_FILE << '.' << endl;
+
+   epoll_event ready[ MAX_EVENTS ];
+   while ( !stopping )
+   {
+      int count = epoll_wait( events, ready, MAX_EVENTS, -1 );
+      if ( count < 0 )
+         continue; // interrupted by a signal
+
+      // take in what every ready teller sent
+      vector< int > batch; // tellers in the order they became ready
+      for ( int i = 0; i < count; i++ )
+      {
+         int fd = ready[ i ].data.fd;
+         if ( fd == listener ) // new tellers
+         {
+            int teller;
+            while ( ( teller = accept( listener, 0, 0 ) ) >= 0 )
+            {
+               setNonBlocking( teller );
+               tellers[ teller ] = Teller();
+               tellers[ teller ].closing = false;
+               tellers[ teller ].printing = false;
+               event.events = EPOLLIN;
+               event.data.fd = teller;
+               epoll_ctl( events, EPOLL_CTL_ADD, teller, &event );
+            } // end while
+         } // end if
+         else if ( fd == service.getPrintDoneFd() ) // print.txt is done
+         {
+            epoll_ctl( events, EPOLL_CTL_DEL, fd, &event );
+            string reply; // of a teller that went away
+            map< int, Teller >::iterator teller = tellers.find( printTeller );
+            service.finishPrint( teller != tellers.end()
+               ? teller->second.output : reply );
+            if ( teller != tellers.end() )
+               teller->second.printing = false;
+            printTeller = -1;
+
+            // take up the tellers whose requests waited for the print
+            for ( teller = tellers.begin(); teller != tellers.end(); ++teller )
+               if ( ( !teller->second.output.empty()
+                  || teller->second.input.find( '\n' ) != string::npos )
+                  && find( batch.begin(), batch.end(), teller->first )
+                     == batch.end() )
+                  batch.push_back( teller->first );
+         } // end else if
+         else if ( ready[ i ].events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) )
+         {
+            receiveRequests( fd, tellers[ fd ] );
+            batch.push_back( fd );
+         } // end else if
+         else if ( ready[ i ].events & EPOLLOUT )
+            batch.push_back( fd );
+      } // end for
+
+      // carry out the complete lines of the batch in order, one line
+      // of each teller in turn so none waits for another's backlog
+      bool changed = false;
+      bool more = true;
+      while ( more )
+      {
+         more = false;
+         for ( size_t i = 0; i < batch.size(); i++ )
+         {
+            // the requests after a print wait for its reply, so the
+            // replies stay in order
+            Teller &teller = tellers[ batch[ i ] ];
+            string::size_type end = teller.input.find( '\n' );
+            if ( teller.printing || end == string::npos )
+               continue;
+            string request = teller.input.substr( 0, end );
+            // a print waits for the one in progress
+            if ( service.waitsForPrint( request ) )
+               continue;
+            teller.input.erase( 0, end + 1 );
+            bool printing = service.isPrinting();
+            if ( service.execute( request, teller.output ) )
+               changed = true;
+            requests++;
+            more = true;
+
+            // the print started is answered when it is done
+            if ( !printing && service.isPrinting() )
+            {
+               teller.printing = true;
+               printTeller = batch[ i ];
+               event.events = EPOLLIN;
+               event.data.fd = service.getPrintDoneFd();
+               epoll_ctl( events, EPOLL_CTL_ADD, event.data.fd, &event );
+            } // end if
+         } // end for
+      } // end while
+
+      // one write-back for all the changes of the batch, before any
+      // of them is answered
+      if ( changed && !service.commit() )
+         cerr << "Changes could not be written, they will be retried."
+            << endl;
+      batches++;
+
+      // answer, and let go of tellers that are done
+      for ( size_t i = 0; i < batch.size(); i++ )
+      {
+         int fd = batch[ i ];
+         map< int, Teller >::iterator teller = tellers.find( fd );
+         if ( teller == tellers.end() )
+            continue; // closed already
+         bool sent = sendReplies( fd, teller->second );
+         bool waiting = teller->second.printing
+            || teller->second.input.find( '\n' ) != string::npos;
+         if ( !sent || ( teller->second.closing && !waiting
+            && teller->second.output.empty() ) )
+         {
+            close( fd ); // also takes it out of epoll
+            tellers.erase( teller );
+            if ( fd == printTeller )
+               printTeller = -1; // its reply is dropped
+            continue;
+         } // end if
+
+         // a teller that hung up would be ready again at once, it is
+         // only taken up again when the print it waits for is done
+         event.data.fd = fd;
+         if ( teller->second.closing && waiting )
+         {
+            epoll_ctl( events, EPOLL_CTL_DEL, fd, &event );
+            continue;
+         } // end if
+
+         // wait for room to send the rest of the replies
+         event.events = EPOLLIN;
+         if ( !teller->second.output.empty() )
+            event.events |= EPOLLOUT;
+         if ( epoll_ctl( events, EPOLL_CTL_MOD, fd, &event ) < 0 )
+            epoll_ctl( events, EPOLL_CTL_ADD, fd, &event );
+      } // end for
+   } // end while
+
+   for ( map< int, Teller >::iterator teller = tellers.begin();
+      teller != tellers.end(); ++teller )
+      close( teller->first );
+   close( listener );
+   close( events );
+   remove( CREDIT_SOCKET_FILE );
+
+   cout << requests << " request(s) in " << batches << " batch(es)."
+      << endl;
+   return 0; // the cache writes back what is left
+} // end main
+
+// ask the server to stop
+void stop( int )
+{
+   stopping = 1;
+} // end function stop
+
+// listen on the socket of the server, -1 if it cannot, or if another
+// server is answering on it (errno is EADDRINUSE)
+int listenService()
+{
+   int running = connectService();
+   if ( running >= 0 )
+   {
+      close( running );
+      errno = EADDRINUSE;
+      return -1;
+   } // end if
+   remove( CREDIT_SOCKET_FILE ); // left by a server that ended
+
+   sockaddr_un address;
+   memset( &address, 0, sizeof( address ) );
+   address.sun_family = AF_UNIX;
+   strncpy( address.sun_path, CREDIT_SOCKET_FILE,
+      sizeof( address.sun_path ) - 1 );
+
+   int listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+   if ( listener < 0 || bind( listener,
+      reinterpret_cast< sockaddr * >( &address ), sizeof( address ) ) < 0
+      || listen( listener, SOMAXCONN ) < 0 )
+   {
+      if ( listener >= 0 )
+         close( listener );
+      return -1;
+   } // end if
+   setNonBlocking( listener );
+   return listener;
+} // end function listenService
+
+// make reads and writes of a descriptor return instead of waiting
+void setNonBlocking( int fd )
+{
+   fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+} // end function setNonBlocking
+
+// read what a teller sent, false once it is closing
+bool receiveRequests( int fd, Teller &teller )
+{
+   char buffer[ 65536 ];
+   ssize_t bytes;
+   while ( ( bytes = read( fd, buffer, sizeof( buffer ) ) ) > 0 )
+      teller.input.append( buffer, bytes );
+   if ( bytes == 0 || ( errno != EAGAIN && errno != EINTR ) )
+      teller.closing = true; // the requests sent are still answered
+
+   // a line this long is not a request
+   string::size_type end = teller.input.rfind( '\n' );
+   if ( teller.input.size() - ( end == string::npos ? 0 : end + 1 )
+      > MAX_REQUEST )
+   {
+      teller.input.erase( end == string::npos ? 0 : end + 1 );
+      teller.output += "error\trequest too long\n";
+      teller.closing = true;
+   } // end if
+   return !teller.closing;
+} // end function receiveRequests
+
+// send the replies waiting for a teller, false if it went away
+bool sendReplies( int fd, Teller &teller )
+{
+   while ( !teller.output.empty() )
+   {
+      ssize_t bytes = write( fd, teller.output.data(),
+         teller.output.size() );
+      if ( bytes < 0 )
+         return errno == EAGAIN || errno == EINTR;
+      teller.output.erase( 0, bytes );
+   } // end while
+   return true;
+} // end function sendReplies
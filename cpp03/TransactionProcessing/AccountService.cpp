@@ -0,0 +1,200 @@
+// AccountService.cpp
+// Member-function definitions for class AccountService, and the
+// fields of its requests and replies.
+#include <cstdio> // snprintf
+#include <cstdlib> // strtoll
+#include <cstring> // memset, strncpy
+#include <cerrno> // errno
+#include <unistd.h> // close
+#include <sys/socket.h> // socket, connect
+#include <sys/un.h> // sockaddr_un
+#include "AccountService.h"
+#include "AccountOps.h" // updateAccount, addAccount, deleteAccount
+using namespace std;
+
+// a whole decimal number, false if the field is anything else
+static bool parseNumber( const string &field, int64_t &value )
+{
+   if ( field.empty() )
+      return false;
+   char *end;
+   errno = 0;
+   long long number = strtoll( field.c_str(), &end, 10 );
+   if ( errno != 0 || *end != '\0' )
+      return false;
+   value = number;
+   return true;
+} // end function parseNumber
+
+// a number in decimal, as a field
+string numberText( int64_t value )
+{
+   char text[ 24 ];
+   snprintf( text, sizeof( text ), "%lld", static_cast< long long >( value ) );
+   return text;
+} // end function numberText
+
+// the fields of a line separated by tabs
+vector< string > splitFields( const string &line )
+{
+   vector< string > fields;
+   string::size_type start = 0;
+   string::size_type tab;
+   while ( ( tab = line.find( '\t', start ) ) != string::npos )
+   {
+      fields.push_back( line.substr( start, tab - start ) );
+      start = tab + 1;
+   } // end while
+   fields.push_back( line.substr( start ) );
+   return fields;
+} // end function splitFields
+
+// the fields of a record, separated by tabs
+string recordFields( const ClientData &record )
+{
+   return numberText( record.getAccountNumber() ) + '\t'
+      + record.getLastName() + '\t' + record.getFirstName() + '\t'
+      + numberText( record.getBalanceCents() );
+} // end function recordFields
+
+// a record from four fields starting at an index
+bool parseRecord( const vector< string > &fields, size_t first,
+   ClientData &record )
+{
+   int64_t account;
+   int64_t balance;
+   if ( fields.size() < first + 4 || !parseNumber( fields[ first ], account )
+      || account < 1 || account > MAX_ACCOUNT_NUMBER
+      || !parseNumber( fields[ first + 3 ], balance ) )
+      return false;
+
+   record.setAccountNumber( static_cast< int >( account ) );
+   record.setLastName( fields[ first + 1 ] );
+   record.setFirstName( fields[ first + 2 ] );
+   record.setBalanceCents( balance );
+   return true;
+} // end function parseRecord
+
+// connect to the server of the current directory
+int connectService()
+{
+   sockaddr_un address;
+   memset( &address, 0, sizeof( address ) );
+   address.sun_family = AF_UNIX;
+   strncpy( address.sun_path, CREDIT_SOCKET_FILE,
+      sizeof( address.sun_path ) - 1 );
+
+   int service = socket( AF_UNIX, SOCK_STREAM, 0 );
+   if ( service >= 0 && connect( service,
+      reinterpret_cast< sockaddr * >( &address ), sizeof( address ) ) < 0 )
+   {
+      close( service );
+      service = -1;
+   } // end if
+   return service;
+} // end function connectService
+
+// answer requests through the cache of the server
+AccountService::AccountService( AccountCache &accounts )
+   : cache( accounts )
+{
+} // end AccountService constructor
+
+// carry out a request line and append the reply line
+bool AccountService::execute( const string &request, string &reply )
+{
+   vector< string > fields = splitFields( request );
+   const string &command = fields[ 0 ];
+   int64_t account = 0;
+   int64_t amount = 0;
+   ClientData client;
+   bool changed = false;
+
+   // every request but max and print names an account
+   bool accountValid = fields.size() > 1
+      && parseNumber( fields[ 1 ], account )
+      && account >= 1 && account <= cache.getMaxAccount();
+
+   if ( command == "max" && fields.size() == 1 )
+      reply += "ok\t" + numberText( cache.getMaxAccount() );
+   else if ( command == "print" && fields.size() == 1 )
+   {
+      // print.txt is written from a snapshot of the file, pinned once
+      // the changes of the cache are in it, and the reply waits for
+      // finishPrint()
+      if ( printer.isRunning() )
+         reply += "error\tprint.txt is being written";
+      else if ( !cache.flush()
+         || !printer.start( cache.getFileName(), "print.txt" ) )
+         reply += "error\tprint.txt could not be created";
+      else
+         return false;
+   } // end else if
+   else if ( command == "read" && fields.size() == 2 && accountValid )
+   {
+      if ( cache.read( account, client ) )
+         reply += "ok\t" + recordFields( client );
+      else
+         reply += "none";
+   } // end else if
+   else if ( command == "update" && fields.size() == 3 && accountValid
+      && parseNumber( fields[ 2 ], amount ) )
+   {
+      AccountResult result = updateAccount( cache, account, amount, client );
+      changed = ( result == ACCOUNT_DONE );
+      if ( changed )
+         reply += "ok\t" + recordFields( client );
+      else if ( result == ACCOUNT_MISSING )
+         reply += "none";
+      else if ( result == ACCOUNT_OVERFLOW )
+         reply += "error\tthe balance would overflow";
+      else
+         reply += "error\tthe account could not be written";
+   } // end else if
+   else if ( command == "new" && accountValid
+      && parseRecord( fields, 1, client ) && fields.size() == 5 )
+   {
+      AccountResult result = addAccount( cache, client );
+      changed = ( result == ACCOUNT_DONE );
+      if ( changed )
+         reply += "ok";
+      else if ( result == ACCOUNT_EXISTS )
+         reply += "exists";
+      else
+         reply += "error\tthe account could not be written";
+   } // end else if
+   else if ( command == "delete" && fields.size() == 2 && accountValid )
+   {
+      changed = ( deleteAccount( cache, account ) == ACCOUNT_DONE );
+      reply += changed ? "ok" : "none";
+   } // end else if
+   else if ( fields.size() > 1 && !accountValid )
+      reply += "error\taccount must be 1 to "
+         + numberText( cache.getMaxAccount() );
+   else
+      reply += "error\tmalformed request";
+
+   reply += '\n';
+   return changed;
+} // end function execute
+
+// write the changes of the requests carried out to the file
+bool AccountService::commit()
+{
+   return cache.flush();
+} // end function commit
+
+// true for a print request while print.txt is being written
+bool AccountService::waitsForPrint( const string &request ) const
+{
+   return printer.isRunning() && splitFields( request )[ 0 ] == "print";
+} // end function waitsForPrint
+
+// append the reply of the print in progress once it is done
+void AccountService::finishPrint( string &reply )
+{
+   if ( printer.finish() )
+      reply += "ok\n";
+   else
+      reply += "error\tprint.txt could not be created\n";
+} // end function finishPrint
@@ -0,0 +1,78 @@
+// AccountService.h
+// Class AccountService carries out the requests tellers send to the
+// account server, which owns credit.dat.
+#ifndef ACCOUNTSERVICE_H
+#define ACCOUNTSERVICE_H
+
+#include <string>
+#include <vector>
+#include "ClientData.h" // ClientData class definition
+#include "AccountCache.h" // AccountCache class definition
+#include "PrintFile.h" // PrintProcess class definition
+using namespace std;
+
+// Unix domain socket the server listens on, next to credit.dat
+const char CREDIT_SOCKET_FILE[] = "credit.sock";
+
+// a request and its reply are each a line of fields separated by
+// tabs. balances and amounts are whole cents, a record is the
+// fields account, last name, first name and balance:
+//
+//   max                              ok, largest account number
+//   read account                     ok and the record, or none
+//   update account amount            ok and the new record, or none
+//   new account last first balance   ok, or exists
+//   delete account                   ok, or none
+//   print                            ok, print.txt was written
+//
+// a request that cannot be carried out is answered with error and
+// the reason.
+
+// a number in decimal, as a field
+string numberText( int64_t );
+// the fields of a line separated by tabs
+vector< string > splitFields( const string & );
+// the fields of a record, separated by tabs
+string recordFields( const ClientData & );
+// a record from four fields starting at an index, false if they
+// are not a record
+bool parseRecord( const vector< string > &, size_t, ClientData & );
+// connect to the server of the current directory, the descriptor
+// of the connection or -1 if no server answers
+int connectService();
+
+// AccountService answers requests through the cache of the server.
+// changes stay in the cache until commit(), which the server calls
+// once for all the requests of a batch before it replies to them.
+//
+// print.txt is written by a child process, one print at a time, and
+// the server goes on answering meanwhile. execute() appends no reply
+// to a print request it starts: the server appends it with
+// finishPrint() once the descriptor of getPrintDoneFd() is readable.
+class AccountService
+{
+public:
+   AccountService( AccountCache & );
+
+   // carry out a request line and append the reply line to a
+   // string; true if the request changed an account
+   bool execute( const string &, string & );
+   // write the changes of the requests carried out to the file
+   bool commit();
+
+   // whether print.txt is being written
+   bool isPrinting() const { return printer.isRunning(); }
+   // true for a request that must wait for the print in progress
+   bool waitsForPrint( const string & ) const;
+   // descriptor that becomes readable when print.txt is written,
+   // -1 when no print is in progress
+   int getPrintDoneFd() const { return printer.getDoneFd(); }
+   // append the reply of the print in progress once it is done
+   void finishPrint( string & );
+
+private:
+   AccountCache &cache;
+   PrintProcess printer;
+}; // end class AccountService
+
+#endif
@@ -0,0 +1,144 @@
+// CentsRAFile.cpp
+// Convert the balances of a credit.dat written with double dollar
+// balances into whole cents, adding the header to a file written
+// before it had one.
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdio> // remove
+#include <cstdlib> // exit
+#include <cstring> // memcpy
+#include <climits> // INT_MAX
+#include "ClientData.h" // ClientData class definition
+#include "AccountFile.h" // AccountFile class definition
+using namespace std;
+
+// slots converted at a time (about 1 MiB)
+const int CONVERT_SLOTS = ( 1 << 20 ) / sizeof( ClientData );
+
+int main()
+{
+   // no other program writes the file while it is converted
+   string reason;
+   int lock = lockCreditFile( "credit.dat", reason );
+   if ( lock < 0 )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+
+   ifstream oldFile( "credit.dat", ios::in | ios::binary );
+   if ( !oldFile )
+   {
+      cerr << "File could not be opened." << endl;
+      exit( 1 );
+   } // end if
+
+   // a file from before the header is bare records of double
+   // balances; of the files with one, only a file refused for its
+   // double balances is converted
+   CreditFileHeader header;
+   streamoff recordsStart = accountPosition( 1 );
+   if ( !hasCreditHeader( oldFile ) )
+   {
+      oldFile.seekg( 0, ios::end );
+      int64_t size = oldFile.tellg();
+      if ( size <= 0 || size % sizeof( ClientData ) != 0
+         || size / sizeof( ClientData ) > INT_MAX )
+      {
+         cerr << "credit.dat is not a file of account records." << endl;
+         exit( 1 );
+      } // end if
+      header = makeCreditHeader(
+         static_cast< int >( size / sizeof( ClientData ) ) );
+      recordsStart = 0;
+   } // end if
+   else if ( readCreditHeader( oldFile, header, reason, true ) )
+   {
+      cout << "credit.dat already holds balances in cents." << endl;
+      return 0;
+   } // end else if
+   else if ( header.layoutHash != ClientData::doubleLayoutHash() )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end else if
+
+   // the new file is renamed over the old one when complete
+   header.layoutHash = ClientData::layoutHash();
+   ofstream newFile( "credit.dat.tmp", ios::out | ios::binary );
+   newFile.write( reinterpret_cast< const char * >( &header ),
+      sizeof( CreditFileHeader ) );
+
+   vector< ClientData > batch( CONVERT_SLOTS );
+   int64_t converted = 0;
+   int64_t rounded = 0; // balances that were not a whole cent
+   bool valid = true;
+   oldFile.seekg( recordsStart );
+   for ( int64_t first = 1; valid && first <= header.recordCount;
+      first += CONVERT_SLOTS )
+   {
+      int count = static_cast< int >(
+         min< int64_t >( CONVERT_SLOTS, header.recordCount - first + 1 ) );
+      oldFile.read( reinterpret_cast< char * >( &batch[ 0 ] ),
+         count * sizeof( ClientData ) );
+      if ( !oldFile )
+      {
+         cerr << "credit.dat is shorter than its header says." << endl;
+         valid = false;
+         break;
+      } // end if
+
+      for ( int i = 0; i < count; i++ )
+      {
+         // the bits of the old double lie where the cents go
+         int64_t bits = batch[ i ].getBalanceCents();
+         double balance;
+         memcpy( &balance, &bits, sizeof( balance ) );
+
+         int accountNumber = batch[ i ].getAccountNumber();
+         if ( accountNumber == 0 ) // empty record
+         {
+            batch[ i ] = ClientData();
+            continue;
+         } // end if
+         if ( balance - balance != 0 ) // infinity or NaN
+         {
+            cerr << "Account #" << accountNumber
+               << " has no valid balance." << endl;
+            valid = false;
+         } // end if
+
+         // built afresh, so the padding a file from before the header
+         // holds where the reserved bytes are is zero
+         batch[ i ] = ClientData( accountNumber, batch[ i ].getLastName(),
+            batch[ i ].getFirstName(), balance );
+         converted++;
+         rounded += ( batch[ i ].getBalance() != balance );
+      } // end for
+
+      newFile.write( reinterpret_cast< const char * >( &batch[ 0 ] ),
+         count * sizeof( ClientData ) );
+   } // end for
+   newFile.close();
+
+   if ( !valid || newFile.fail()
+      || !replaceCreditFile( "credit.dat.tmp", "credit.dat", lock ) )
+   {
+      cerr << "credit.dat could not be converted." << endl;
+      remove( "credit.dat.tmp" );
+      exit( 1 );
+   } // end if
+
+   // the records changed, so do their checksums
+   AccountFile accounts;
+   if ( !accounts.open( "credit.dat", reason )
+      || !accounts.rebuildChecksums() )
+   {
+      cerr << "credit.crc could not be rewritten." << endl;
+      exit( 1 );
+   } // end if
+
+   cout << "Converted " << converted << " balance(s) of credit.dat to cents, "
+      << rounded << " rounded to the nearest cent." << endl;
+} // end main
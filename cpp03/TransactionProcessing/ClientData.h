@@ -1,37 +1,171 @@
-// ClientData.h
-// Class ClientData definition used in Fig. 17.12-Fig. 17.15.
-#ifndef CLIENTDATA_H
-#define CLIENTDATA_H
-
-#include <string>
-using namespace std;
-
-class ClientData 
-{
-public:
-   // default ClientData constructor
-   ClientData( int = 0, string = "", string = "", double = 0.0 );
-
-   // accessor functions for accountNumber
-   void setAccountNumber( int );
-   int getAccountNumber() const;
-
-   // accessor functions for lastName
-   void setLastName( string );
-   string getLastName() const;
-
-   // accessor functions for firstName
-   void setFirstName( string );
-   string getFirstName() const;
-
-   // accessor functions for balance
-   void setBalance( double );
-   double getBalance() const;
-private:
-   int accountNumber;
-   char lastName[ 15 ];
-   char firstName[ 10 ];
-   double balance;
-}; // end class ClientData
-
-#endif
+// ClientData.h
+// Class ClientData definition used in Fig. 17.12-Fig. 17.15.
+#ifndef CLIENTDATA_H
+#define CLIENTDATA_H
+
+#include <iostream>
+#include <string>
+#include <stdint.h> // fixed size integers of the file header
+using namespace std;
+
+// bytes before the first account record of credit.dat
+const int CREDIT_HEADER_SIZE = 64;
+// version of the credit.dat format, the record of an account
+// is found by its account number (1 to the record count)
+const uint32_t CREDIT_VERSION = 1;
+// version of a credit.dat whose records are placed by a hash of
+// the account number (see AccountFile in TransactionProcessing)
+const uint32_t CREDIT_HASHED_VERSION = 2;
+// stored as written by the host, reads back swapped on a host
+// of the other byte order
+const uint32_t CREDIT_BYTE_ORDER = 0x01020304;
+// optional file of one checksum per account record of credit.dat,
+// records are checked against it while it exists
+const char CREDIT_CHECKSUM_FILE[] = "credit.crc";
+
+// header at the start of credit.dat, it describes the account
+// records that follow and holds how many there are
+struct CreditFileHeader
+{
+   char magic[ 8 ]; // "CREDITDB"
+   uint32_t version; // CREDIT_VERSION
+   uint32_t headerSize; // CREDIT_HEADER_SIZE
+   uint32_t recordSize; // sizeof( ClientData )
+   uint32_t byteOrder; // CREDIT_BYTE_ORDER
+   uint32_t layoutHash; // ClientData::layoutHash()
+   uint32_t reserved;
+   int64_t recordCount; // account records in the file
+   int64_t accountsInUse; // records holding an account, hashed files
+   char unused[ CREDIT_HEADER_SIZE - 48 ];
+}; // end struct CreditFileHeader
+
+class ClientData 
+{
+public:
+   // default ClientData constructor
+   ClientData( int = 0, string = "", string = "", double = 0.0 );
+
+   // accessor functions for accountNumber
+   void setAccountNumber( int );
+   int getAccountNumber() const;
+
+   // accessor functions for lastName
+   void setLastName( string );
+   string getLastName() const;
+
+   // accessor functions for firstName
+   void setFirstName( string );
+   string getFirstName() const;
+
+   // accessor functions for balance in dollars, set to the
+   // nearest cent
+   void setBalance( double );
+   double getBalance() const;
+
+   // accessor functions for balance in cents, exact
+   void setBalanceCents( int64_t );
+   int64_t getBalanceCents() const;
+
+   // hash of the field offsets and sizes, stored in the file header
+   static uint32_t layoutHash();
+   // hash of the layout of files whose balance is a double
+   // in dollars, which CentsRAFile converts
+   static uint32_t doubleLayoutHash();
+private:
+   // hash of the layout with the balance field of a name
+   static uint32_t hashLayout( const char * );
+
+   // the record as laid out in the file, padding is an explicit field
+   int32_t accountNumber;
+   char lastName[ 15 ];
+   char firstName[ 10 ];
+   char reserved[ 3 ]; // always zero
+   int64_t balanceCents;
+}; // end class ClientData
+
+// characters formatCents() may write, with the null character
+const int CENTS_TEXT_LENGTH = 24;
+
+// dollars rounded to the nearest cent, halves away from zero
+// (0 for a NaN, the nearest limit beyond 2^63 cents)
+int64_t dollarsToCents( double );
+// write cents as dollars with two decimals ("-12.05"), return the
+// length
+int formatCents( char *, int64_t );
+// read dollars with at most two decimals as exact cents, return the
+// characters read or 0 if the text does not start with an amount
+int parseCents( const char *, int64_t & );
+
+// header for a credit.dat of a number of account records
+CreditFileHeader makeCreditHeader( int );
+// read the header of credit.dat and check it describes records of
+// this program, with the reason in the string if it does not. a
+// hashed file is only accepted if the last argument is true
+bool readCreditHeader( istream &, CreditFileHeader &, string &, 
+   bool = false );
+// true if credit.dat starts with a header; a file written before
+// the header holds bare records with the balance a double in dollars
+bool hasCreditHeader( istream & );
+// byte offset of an account record in credit.dat
+streamoff accountPosition( int );
+// create a records file of the header's blank records without
+// writing them, with the reason in the string on failure. a blank
+// record is all zero bytes, which is what the unwritten regions of
+// a sparse file read as; the blocks of the records are reserved
+// first (posix_fallocate) if the bool is true
+bool createCreditFile( const string &, const CreditFileHeader &, bool,
+   string & );
+// the next run [ first, end ) of records of a records file open on a
+// descriptor, from a record number up to a last one, that holds
+// written bytes; the records around the runs were never written and
+// are blank. false if none is left. where the system cannot tell
+// unwritten regions apart, every record is in a run
+bool findWrittenRecords( int, int64_t, int64_t, int64_t &, int64_t & );
+// take the writer lock of a records file, an exclusive lock (flock)
+// that every program writing credit.dat holds while it writes, so
+// one writes at a time. return a descriptor to close to release it,
+// or -1 with the reason in the string, as when another program
+// holds it
+int lockCreditFile( const string &, string & );
+// rename a new records file over one locked with the descriptor; the
+// new file is locked first, so the file of the name stays locked
+// throughout, and the descriptor becomes the one of its lock
+bool replaceCreditFile( const string &, const string &, int & );
+
+// CRC32C of an account record, never zero (zero marks a record
+// without a checksum in credit.crc)
+uint32_t accountChecksum( const ClientData & );
+
+// AccountChecksums holds credit.crc open while a records file is
+// in use, so the checksums of a run of records are read or written
+// with one call instead of an open of the file per record. while
+// there is no credit.crc there is nothing to check or keep
+class AccountChecksums
+{
+public:
+   AccountChecksums();
+   ~AccountChecksums();
+
+   // open credit.crc, false if it does not exist
+   bool open();
+   void close();
+   bool isOpen() const { return fd >= 0; }
+
+   // read the checksums of a run of records from a record number,
+   // 0 for a record without one
+   void read( int, int, uint32_t * );
+   // store the checksums of a run of records from a record number
+   bool write( int, int, const ClientData * );
+   // check a run of records from a record number against their
+   // checksums, warning about each damaged one; false if any fails
+   bool verify( int, int, const ClientData * );
+
+private:
+   // the descriptor has a single owner
+   AccountChecksums( const AccountChecksums & );
+   AccountChecksums &operator=( const AccountChecksums & );
+
+   int fd; // credit.crc, -1 if there is none
+}; // end class AccountChecksums
+
+#endif
@@ -0,0 +1,67 @@
+// HashRAFile.cpp
+// Reorganize credit.dat so its records are placed by a hash of the
+// account number, or create an empty hashed credit.dat.
+#include <iostream>
+#include <fstream>
+#include <cstdio> // remove
+#include <cstdlib> // exit, atoi
+#include "ClientData.h" // ClientData class definition
+#include "AccountFile.h" // AccountFile class definition
+using namespace std;
+
+int main( int argc, char *argv[] )
+{
+   // slots of the new file, rounded up to a power of two
+   int slots = ( argc > 1 ? atoi( argv[ 1 ] ) : 0 );
+   string reason;
+
+   ifstream existing( "credit.dat", ios::in | ios::binary );
+   if ( !existing ) // no file yet, create an empty one
+   {
+      if ( !AccountFile::create( "credit.dat", slots ) )
+      {
+         cerr << "File could not be created." << endl;
+         exit( 1 );
+      } // end if
+      cout << "Created an empty hashed credit.dat." << endl;
+      return 0;
+   } // end if
+   existing.close();
+
+   // no other program writes the file while it is converted
+   int lock = lockCreditFile( "credit.dat", reason );
+   AccountFile accounts;
+   if ( lock < 0 || !accounts.open( "credit.dat", reason ) )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+   if ( accounts.isHashed() )
+   {
+      cout << "credit.dat is already hashed, " << accounts.getSlotCount()
+         << " slots." << endl;
+      return 0;
+   } // end if
+   accounts.close();
+
+   // the new file is renamed over the old one when complete
+   if ( !AccountFile::convert( "credit.dat", "credit.dat.tmp", slots )
+      || !replaceCreditFile( "credit.dat.tmp", "credit.dat", lock ) )
+   {
+      cerr << "credit.dat could not be converted." << endl;
+      remove( "credit.dat.tmp" );
+      exit( 1 );
+   } // end if
+
+   // the records moved, so do their checksums
+   if ( !accounts.open( "credit.dat", reason )
+      || !accounts.rebuildChecksums() )
+   {
+      cerr << "credit.crc could not be rewritten." << endl;
+      exit( 1 );
+   } // end if
+
+   cout << "credit.dat hashed into " << accounts.getSlotCount()
+      << " slots, accounts 1 - " << MAX_ACCOUNT_NUMBER
+      << " may be used." << endl;
+} // end main
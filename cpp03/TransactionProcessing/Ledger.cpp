@@ -0,0 +1,187 @@
+// Ledger.cpp
+// Functions that total the balances of account records.
+#include <cstring> // memcpy
+// the SSE4.2 kernel is compiled in whatever the flags of the build,
+// and used if the processor has SSE4.2
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define LEDGER_SSE42
+#include <nmmintrin.h> // 64-bit compares
+#endif
+#include "Ledger.h"
+using namespace std;
+
+// where the account number and the balance in cents lie in a
+// record; checked against ClientData before they are used
+static const size_t ACCOUNT_OFFSET = 0;
+static const size_t BALANCE_OFFSET = 32;
+
+// true if the fields lie at the offsets above
+static bool layoutMatches()
+{
+   ClientData probe( 0x01020304 );
+   probe.setBalanceCents( 0x0102030405060708LL );
+   const char *bytes = reinterpret_cast< const char * >( &probe );
+   int32_t account;
+   int64_t balance;
+   memcpy( &account, bytes + ACCOUNT_OFFSET, sizeof( account ) );
+   memcpy( &balance, bytes + BALANCE_OFFSET, sizeof( balance ) );
+   return account == probe.getAccountNumber()
+      && balance == probe.getBalanceCents();
+} // end function layoutMatches
+
+// add an amount to a sum as unsigned, so a sum leaving the range of
+// int64_t wraps instead of overflowing (undefined behavior); it
+// wrapped if a negative amount did not lower it or a positive one did
+static inline void addAmount( int64_t &sum, int64_t amount,
+   bool &overflowed )
+{
+   int64_t added = static_cast< int64_t >(
+      static_cast< uint64_t >( sum ) + static_cast< uint64_t >( amount ) );
+   overflowed |= ( amount < 0 ) != ( added < sum );
+   sum = added;
+} // end function addAmount
+
+#ifdef LEDGER_SSE42
+// add the balances of the records to totals two at a time with
+// SSE4.2, return the records added (an even number)
+__attribute__(( target( "sse4.2" ) ))
+static size_t addTotalsSse42( const char *bytes, size_t count,
+   LedgerTotals &totals )
+{
+   size_t i = 0;
+
+   // two records at a time: each 64-bit lane holds the balance of
+   // a record, or zero if it is empty, and all bits of a mask lane
+   // are set where the compare holds
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i accountBits = _mm_set1_epi64x( 0xffffffffLL );
+   __m128i used = zero; // minus the number of accounts
+   __m128i credits = zero;
+   __m128i debits = zero;
+   __m128i zeros = zero; // minus the number of zero balances
+   __m128i wrapped = zero; // lanes whose sums left the range
+
+   for ( ; i + 2 <= count; i += 2 )
+   {
+      const char *first = bytes + i * sizeof( ClientData );
+      const char *second = first + sizeof( ClientData );
+
+      __m128i account = _mm_and_si128( accountBits, _mm_unpacklo_epi64(
+         _mm_loadl_epi64( reinterpret_cast< const __m128i * >(
+            first + ACCOUNT_OFFSET ) ),
+         _mm_loadl_epi64( reinterpret_cast< const __m128i * >(
+            second + ACCOUNT_OFFSET ) ) ) );
+      __m128i isUsed = _mm_xor_si128( _mm_cmpeq_epi64( account, zero ),
+         _mm_set1_epi64x( -1 ) );
+      __m128i balance = _mm_and_si128( isUsed, _mm_unpacklo_epi64(
+         _mm_loadl_epi64( reinterpret_cast< const __m128i * >(
+            first + BALANCE_OFFSET ) ),
+         _mm_loadl_epi64( reinterpret_cast< const __m128i * >(
+            second + BALANCE_OFFSET ) ) ) );
+
+      __m128i negative = _mm_cmpgt_epi64( zero, balance );
+      __m128i positive = _mm_cmpgt_epi64( balance, zero );
+      used = _mm_add_epi64( used, isUsed );
+      // the adds wrap, a sum of credits that grew or of debits
+      // that shrank left the range
+      __m128i newCredits = _mm_add_epi64( credits,
+         _mm_and_si128( negative, balance ) );
+      __m128i newDebits = _mm_add_epi64( debits,
+         _mm_and_si128( positive, balance ) );
+      wrapped = _mm_or_si128( wrapped, _mm_or_si128(
+         _mm_cmpgt_epi64( newCredits, credits ),
+         _mm_cmpgt_epi64( debits, newDebits ) ) );
+      credits = newCredits;
+      debits = newDebits;
+      zeros = _mm_add_epi64( zeros, _mm_andnot_si128(
+         _mm_or_si128( negative, positive ), isUsed ) );
+   } // end for
+
+   // add up the lanes
+   int64_t lanes[ 2 ];
+   _mm_storeu_si128( reinterpret_cast< __m128i * >( lanes ), used );
+   totals.accounts -= lanes[ 0 ] + lanes[ 1 ];
+   _mm_storeu_si128( reinterpret_cast< __m128i * >( lanes ), credits );
+   addAmount( totals.credits, lanes[ 0 ], totals.overflowed );
+   addAmount( totals.credits, lanes[ 1 ], totals.overflowed );
+   _mm_storeu_si128( reinterpret_cast< __m128i * >( lanes ), debits );
+   addAmount( totals.debits, lanes[ 0 ], totals.overflowed );
+   addAmount( totals.debits, lanes[ 1 ], totals.overflowed );
+   _mm_storeu_si128( reinterpret_cast< __m128i * >( lanes ), zeros );
+   totals.zeroBalances -= lanes[ 0 ] + lanes[ 1 ];
+   _mm_storeu_si128( reinterpret_cast< __m128i * >( lanes ), wrapped );
+   totals.overflowed |= ( lanes[ 0 ] | lanes[ 1 ] ) != 0;
+   return i;
+} // end function addTotalsSse42
+
+// whether the processor has SSE4.2
+static bool hasSse42Instructions()
+{
+   __builtin_cpu_init(); // the check may run before main
+   return __builtin_cpu_supports( "sse4.2" );
+} // end function hasSse42Instructions
+
+// checked before main, so threads can share it
+static const bool hasSse42 = hasSse42Instructions();
+#endif
+
+// totals with every count and sum zero
+LedgerTotals makeLedgerTotals()
+{
+   LedgerTotals totals;
+   totals.accounts = 0;
+   totals.credits = 0;
+   totals.debits = 0;
+   totals.zeroBalances = 0;
+   totals.overflowed = false;
+   return totals;
+} // end function makeLedgerTotals
+
+// add the balances of an array of records to totals
+void addLedgerTotals( const ClientData *records, size_t count,
+   LedgerTotals &totals )
+{
+   static const bool direct = layoutMatches();
+   if ( !direct ) // through the accessors, one record at a time
+   {
+      for ( size_t i = 0; i < count; i++ )
+         if ( records[ i ].getAccountNumber() != 0 )
+         {
+            int64_t balance = records[ i ].getBalanceCents();
+            totals.accounts++;
+            addAmount( totals.credits, ( balance < 0 ? balance : 0 ),
+               totals.overflowed );
+            addAmount( totals.debits, ( balance > 0 ? balance : 0 ),
+               totals.overflowed );
+            totals.zeroBalances += ( balance == 0 );
+         } // end if
+      return;
+   } // end if
+
+   const char *bytes = reinterpret_cast< const char * >( records );
+   size_t i = 0;
+
+#ifdef LEDGER_SSE42
+   if ( hasSse42 )
+      i = addTotalsSse42( bytes, count, totals );
+#endif
+
+   // the records left, without branches
+   for ( ; i < count; i++ )
+   {
+      const char *record = bytes + i * sizeof( ClientData );
+      int32_t account;
+      int64_t balance;
+      memcpy( &account, record + ACCOUNT_OFFSET, sizeof( account ) );
+      memcpy( &balance, record + BALANCE_OFFSET, sizeof( balance ) );
+
+      int64_t isUsed = ( account != 0 );
+      balance &= -isUsed;
+      totals.accounts += isUsed;
+      addAmount( totals.credits,
+         balance & -static_cast< int64_t >( balance < 0 ), totals.overflowed );
+      addAmount( totals.debits,
+         balance & -static_cast< int64_t >( balance > 0 ), totals.overflowed );
+      totals.zeroBalances += isUsed & ( balance == 0 );
+   } // end for
+} // end function addLedgerTotals
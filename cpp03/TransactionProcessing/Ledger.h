@@ -0,0 +1,29 @@
+// Ledger.h
+// Totals of the balances of account records.
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include <cstddef> // size_t
+#include <stdint.h> // int64_t
+#include "ClientData.h" // ClientData class definition
+using namespace std;
+
+// totals over the accounts of credit.dat, exact in cents. a sum
+// beyond the range of int64_t is not kept, overflowed is set instead
+struct LedgerTotals
+{
+   int64_t accounts; // records holding an account
+   int64_t credits; // sum of the credit (negative) balances
+   int64_t debits; // sum of the debit (positive) balances
+   int64_t zeroBalances; // accounts with a zero balance
+   bool overflowed; // true if credits or debits left the range
+}; // end struct LedgerTotals
+
+// totals with every count and sum zero
+LedgerTotals makeLedgerTotals();
+
+// add the balances of an array of records to totals; empty
+// records (account number 0) are skipped
+void addLedgerTotals( const ClientData *, size_t, LedgerTotals & );
+
+#endif
@@ -0,0 +1,81 @@
+// LedgerTotals.cpp
+// Total the credit and debit balances of credit.dat and count the
+// accounts with a zero balance.
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib> // exit
+#include <sys/time.h> // gettimeofday
+#include "ClientData.h" // ClientData class definition
+#include "AccountFile.h" // AccountFile class definition
+#include "Ledger.h" // LedgerTotals, addLedgerTotals
+using namespace std;
+
+// slots read at a time (about 4 MiB)
+const int TOTAL_SLOTS = ( 4 << 20 ) / sizeof( ClientData );
+
+// seconds since the epoch, with microseconds
+double now()
+{
+   timeval time;
+   gettimeofday( &time, 0 );
+   return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+// dollars and cents of an amount
+string dollars( int64_t cents )
+{
+   char text[ CENTS_TEXT_LENGTH ];
+   formatCents( text, cents );
+   return text;
+} // end function dollars
+
+int main()
+{
+   AccountFile accounts;
+   string reason;
+   if ( !accounts.open( "credit.dat", reason ) )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+
+   // read the file in large batches, timing the totals apart
+   // from the reads
+   vector< ClientData > batch( TOTAL_SLOTS );
+   LedgerTotals totals = makeLedgerTotals();
+   double adding = 0;
+   double start = now();
+   int slotCount = accounts.getSlotCount();
+   for ( int first = 1; first <= slotCount; first += TOTAL_SLOTS )
+   {
+      int slotsRead = accounts.readSlots( first,
+         min( TOTAL_SLOTS, slotCount - first + 1 ), &batch[ 0 ] );
+      double added = now();
+      addLedgerTotals( &batch[ 0 ], slotsRead, totals );
+      adding += now() - added;
+   } // end for
+   double total = now() - start;
+   double megabytes = 
+      static_cast< double >( slotCount ) * sizeof( ClientData ) / 1e6;
+
+   if ( totals.overflowed )
+   {
+      cerr << "credit.dat: the balances add up beyond the range "
+         << "of the totals." << endl;
+      exit( 1 );
+   } // end if
+
+   cout << "accounts        : " << totals.accounts << '\n'
+      << "credit balances : " << setw( 20 ) << dollars( totals.credits )
+      << '\n'
+      << "debit balances  : " << setw( 20 ) << dollars( totals.debits )
+      << '\n'
+      << "zero balances   : " << totals.zeroBalances << '\n'
+      << fixed << setprecision( 3 )
+      << "totals          : " << adding << " s";
+   // an empty file, or one too small to time, has no rate
+   if ( adding > 0 )
+      cout << " (" << setprecision( 0 ) << megabytes / adding << " MB/s)";
+   cout << ", " << setprecision( 3 ) << total << " s with reads" << endl;
+} // end main
@@ -0,0 +1,297 @@
+// OpBench.cpp
+// Time the record operations of TransactionProcessing on a random
+// mix of updates, new accounts, deletes and prints over credit.dat,
+// and write the latencies of each kind of operation to CSV files:
+// percentiles to name.csv, histograms to name_hist.csv.
+// the accounts of credit.dat are changed: run it on a copy.
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <algorithm> // min, max
+#include <cstdio> // sscanf
+#include <cstdlib> // exit, atoi, atol
+#include <ctime> // clock_gettime
+#include "ClientData.h" // ClientData class definition
+#include "AccountFile.h" // AccountFile class definition
+#include "AccountCache.h" // AccountCache class definition
+#include "AccountOps.h" // updateAccount, addAccount, deleteAccount
+#include "PrintFile.h" // writePrintFile
+using namespace std;
+
+// slots read at a time when the accounts are listed
+const int LIST_SLOTS = 65536;
+// latencies are counted in buckets of 1/32 of a power of two
+const int SUB_BUCKETS = 32;
+const int BUCKETS = 64 * SUB_BUCKETS;
+
+enum Operations { UPDATE, NEW, DELETE, PRINT, OPERATIONS };
+const char * const OPERATION_NAMES[ OPERATIONS ] =
+   { "update", "new", "delete", "print" };
+
+// latencies of one kind of operation
+struct Latencies
+{
+   long count; // operations timed
+   long done; // operations that changed an account or wrote print.txt
+   int64_t total; // nanoseconds of all of them
+   int64_t largest;
+   vector< long > buckets; // operations by latency bucket
+}; // end struct Latencies
+
+// nanoseconds of a steady clock
+int64_t nanoseconds()
+{
+   timespec time;
+   clock_gettime( CLOCK_MONOTONIC, &time );
+   return static_cast< int64_t >( time.tv_sec ) * 1000000000 + time.tv_nsec;
+} // end function nanoseconds
+
+// next number of a xorshift generator, the same on every system
+uint64_t nextRandom( uint64_t &state )
+{
+   state ^= state << 13;
+   state ^= state >> 7;
+   state ^= state << 17;
+   return state;
+} // end function nextRandom
+
+// bucket of a latency: the power of two below it and the next five
+// bits, so a bucket is at most 1/32 of the latencies in it wide
+int bucketOf( int64_t latency )
+{
+   uint64_t value = ( latency > 0 ? latency : 0 );
+   if ( value < SUB_BUCKETS )
+      return static_cast< int >( value );
+   int power = 63;
+   while ( !( value >> power ) )
+      power--;
+   int shift = power - 5;
+   return ( shift + 1 ) * SUB_BUCKETS
+      + static_cast< int >( ( value >> shift ) - SUB_BUCKETS );
+} // end function bucketOf
+
+// the largest latency of a bucket
+int64_t bucketLimit( int bucket )
+{
+   if ( bucket < SUB_BUCKETS )
+      return bucket;
+   int shift = bucket / SUB_BUCKETS - 1;
+   int64_t first = static_cast< int64_t >( SUB_BUCKETS + bucket % SUB_BUCKETS )
+      << shift;
+   return first + ( static_cast< int64_t >( 1 ) << shift ) - 1;
+} // end function bucketLimit
+
+// latency below which a fraction of the operations fall, as the
+// limit of its bucket
+int64_t percentile( const Latencies &latencies, double fraction )
+{
+   long rank = static_cast< long >( fraction * latencies.count + 0.5 );
+   rank = ( rank < 1 ? 1 : rank );
+   long seen = 0;
+   for ( int bucket = 0; bucket < BUCKETS; bucket++ )
+   {
+      seen += latencies.buckets[ bucket ];
+      if ( seen >= rank )
+         return min( bucketLimit( bucket ), latencies.largest );
+   } // end for
+   return latencies.largest;
+} // end function percentile
+
+// microseconds of nanoseconds, for the reports
+double micro( int64_t latency )
+{
+   return latency / 1000.0;
+} // end function micro
+
+int main( int argc, char *argv[] )
+{
+   long operations = ( argc > 1 ? atol( argv[ 1 ] ) : 1000000 );
+   int mix[ OPERATIONS ] = { 80, 10, 10, 0 }; // percent of each
+   if ( argc > 2 && sscanf( argv[ 2 ], "%d,%d,%d,%d", &mix[ UPDATE ],
+      &mix[ NEW ], &mix[ DELETE ], &mix[ PRINT ] ) != OPERATIONS )
+   {
+      cerr << "usage: " << argv[ 0 ]
+         << " [operations] [update,new,delete,print] [cache accounts]"
+         << " [name]" << endl;
+      exit( 1 );
+   } // end if
+   int cacheAccounts = ( argc > 3 ? atoi( argv[ 3 ] ) : 4096 );
+   string name = ( argc > 4 ? argv[ 4 ] : "opbench" );
+
+   // a negative share would let the pick of an operation run past
+   // the end of the mix
+   int mixTotal = 0;
+   for ( int kind = 0; kind < OPERATIONS; kind++ )
+   {
+      if ( mix[ kind ] < 0 )
+      {
+         cerr << "The shares of the mix cannot be negative." << endl;
+         exit( 1 );
+      } // end if
+      mixTotal += mix[ kind ];
+   } // end for
+   if ( operations <= 0 || mixTotal <= 0 )
+   {
+      cerr << "Nothing to do." << endl;
+      exit( 1 );
+   } // end if
+
+   AccountFile creditFile;
+   string reason;
+   if ( !creditFile.open( "credit.dat", reason )
+      || !creditFile.lockWriter( reason ) )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+
+   // the accounts in the file, so updates and deletes find one
+   vector< int > accounts;
+   vector< ClientData > slots( LIST_SLOTS );
+   int slotsRead;
+   for ( int first = 1; ( slotsRead = creditFile.readSlots( first,
+      LIST_SLOTS, &slots[ 0 ] ) ) > 0; first += slotsRead )
+      for ( int i = 0; i < slotsRead; i++ )
+         if ( slots[ i ].getAccountNumber() != 0 )
+            accounts.push_back( slots[ i ].getAccountNumber() );
+   vector< ClientData >().swap( slots );
+   cout << "credit.dat : " << creditFile.getSlotCount() << " slot(s), "
+      << accounts.size() << " account(s)" << endl;
+
+   // the operations go through the cache, as TransactionProcessing's
+   // do, with changes written back every 5 seconds
+   AccountCache cache( creditFile, cacheAccounts, 5 );
+   int maxAccount = cache.getMaxAccount();
+
+   vector< Latencies > latencies( OPERATIONS );
+   for ( int kind = 0; kind < OPERATIONS; kind++ )
+   {
+      latencies[ kind ].count = 0;
+      latencies[ kind ].done = 0;
+      latencies[ kind ].total = 0;
+      latencies[ kind ].largest = 0;
+      latencies[ kind ].buckets.assign( BUCKETS, 0 );
+   } // end for
+
+   uint64_t state = 88172645463325252ULL;
+   int64_t start = nanoseconds();
+   for ( long operation = 0; operation < operations; operation++ )
+   {
+      // the kind of operation, by the mix
+      int pick = static_cast< int >( nextRandom( state ) % mixTotal );
+      int kind = 0;
+      while ( pick >= mix[ kind ] )
+         pick -= mix[ kind++ ];
+
+      // an account of the file for updates and deletes, any account
+      // number for new accounts (which may be taken)
+      size_t index = 0;
+      int accountNumber = static_cast< int >(
+         nextRandom( state ) % maxAccount ) + 1;
+      if ( ( kind == UPDATE || kind == DELETE ) && !accounts.empty() )
+      {
+         index = nextRandom( state ) % accounts.size();
+         accountNumber = accounts[ index ];
+      } // end if
+      int64_t cents = static_cast< int64_t >( nextRandom( state ) % 20001 )
+         - 10000;
+
+      ClientData client;
+      bool done = false;
+      int64_t before = nanoseconds();
+      switch ( kind )
+      {
+         case UPDATE:
+            done = ( updateAccount( cache, accountNumber, cents, client )
+               == ACCOUNT_DONE );
+            break;
+         case NEW:
+            client = ClientData( accountNumber, "Bench", "Op", 0.0 );
+            client.setBalanceCents( cents );
+            done = ( addAccount( cache, client ) == ACCOUNT_DONE );
+            break;
+         case DELETE:
+            done = ( deleteAccount( cache, accountNumber ) == ACCOUNT_DONE );
+            break;
+         case PRINT:
+            done = cache.flush()
+               && writePrintFile( cache.getFileName(), "print.txt", 0 );
+            break;
+      } // end switch
+      int64_t latency = nanoseconds() - before;
+
+      Latencies &timed = latencies[ kind ];
+      timed.count++;
+      timed.done += done;
+      timed.total += latency;
+      timed.largest = max( timed.largest, latency );
+      timed.buckets[ bucketOf( latency ) ]++;
+
+      // keep the list of accounts in step with the file
+      if ( done && kind == NEW )
+         accounts.push_back( accountNumber );
+      else if ( done && kind == DELETE )
+      {
+         accounts[ index ] = accounts.back();
+         accounts.pop_back();
+      } // end else if
+   } // end for
+   double seconds = ( nanoseconds() - start ) / 1e9;
+
+   // the changes still in the cache
+   int64_t before = nanoseconds();
+   cache.flush();
+   double flushSeconds = ( nanoseconds() - before ) / 1e9;
+
+   ofstream csv( ( name + ".csv" ).c_str(), ios::out );
+   ofstream histogram( ( name + "_hist.csv" ).c_str(), ios::out );
+   histogram << "operation,up_to_us,count\n" << fixed << setprecision( 3 );
+   csv << "operation,count,done,ops_per_sec,mean_us,p50_us,p90_us,"
+      << "p99_us,p999_us,max_us\n" << fixed << setprecision( 3 );
+   cout << fixed << setprecision( 1 ) << left << setw( 8 ) << "op"
+      << right << setw( 10 ) << "count" << setw( 12 ) << "ops/s"
+      << setw( 10 ) << "p50 us" << setw( 10 ) << "p90 us"
+      << setw( 10 ) << "p99 us" << setw( 10 ) << "p999 us"
+      << setw( 12 ) << "max us" << '\n';
+   for ( int kind = 0; kind < OPERATIONS; kind++ )
+   {
+      const Latencies &timed = latencies[ kind ];
+      if ( timed.count == 0 )
+         continue;
+
+      // operations per second of the time spent in this kind
+      double rate = timed.count / ( timed.total / 1e9 );
+      int64_t points[] = { percentile( timed, 0.50 ),
+         percentile( timed, 0.90 ), percentile( timed, 0.99 ),
+         percentile( timed, 0.999 ) };
+
+      csv << OPERATION_NAMES[ kind ] << ',' << timed.count << ','
+         << timed.done << ',' << rate << ','
+         << micro( timed.total ) / timed.count;
+      cout << left << setw( 8 ) << OPERATION_NAMES[ kind ] << right
+         << setw( 10 ) << timed.count << setw( 12 ) << rate;
+      for ( int point = 0; point < 4; point++ )
+      {
+         csv << ',' << micro( points[ point ] );
+         cout << setw( 10 ) << micro( points[ point ] );
+      } // end for
+      csv << ',' << micro( timed.largest ) << '\n';
+      cout << setw( 12 ) << micro( timed.largest ) << '\n';
+
+      for ( int bucket = 0; bucket < BUCKETS; bucket++ )
+         if ( timed.buckets[ bucket ] != 0 )
+            histogram << OPERATION_NAMES[ kind ] << ','
+               << micro( bucketLimit( bucket ) ) << ','
+               << timed.buckets[ bucket ] << '\n';
+   } // end for
+
+   cout << "all     " << setw( 10 ) << operations << setw( 12 )
+      << operations / seconds << " in " << setprecision( 3 ) << seconds
+      << " s, final flush " << flushSeconds << " s\n"
+      << "cache   : " << cache.getHits() << " hit(s), "
+      << cache.getMisses() << " miss(es)\n"
+      << "results written to " << name << ".csv and " << name
+      << "_hist.csv" << endl;
+   return ( csv && histogram ) ? 0 : 1;
+} // end main
@@ -0,0 +1,77 @@
+// PrintBench.cpp
+// Time print.txt written one record at a time with outputLine()
+// against writePrintFile(), and check the two files are the same.
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <iterator>
+#include <cstdlib> // exit, atoi
+#include <sys/time.h> // gettimeofday
+#include "ClientData.h" // ClientData class definition
+#include "AccountFile.h" // AccountFile class definition
+#include "PrintFile.h" // outputLine, writePrintFile
+using namespace std;
+
+// seconds since the epoch, with microseconds
+double now()
+{
+   timeval time;
+   gettimeofday( &time, 0 );
+   return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+// contents of a file
+string readFile( const char *fileName )
+{
+   ifstream inFile( fileName, ios::in | ios::binary );
+   return string( istreambuf_iterator< char >( inFile ),
+      istreambuf_iterator< char >() );
+} // end function readFile
+
+int main( int argc, char *argv[] )
+{
+   int threads = ( argc > 1 ? atoi( argv[ 1 ] ) : 0 );
+
+   AccountFile accounts;
+   string reason;
+   if ( !accounts.open( "credit.dat", reason ) )
+   {
+      cerr << "credit.dat: " << reason << endl;
+      exit( 1 );
+   } // end if
+
+   // the loop createTextFile() ran: a read and a chain of
+   // stream manipulators per record
+   double start = now();
+   ofstream outPrintFile( "print.seq.txt", ios::out );
+   outPrintFile << left << setw( 10 ) << "Account" << setw( 16 )
+      << "Last Name" << setw( 11 ) << "First Name" << right
+      << setw( 10 ) << "Balance" << endl;
+   ClientData client;
+   for ( int slot = 1; accounts.readSlots( slot, 1, &client ) == 1; slot++ )
+      if ( client.getAccountNumber() != 0 )
+         outputLine( outPrintFile, client );
+   outPrintFile.close();
+   double sequential = now() - start;
+
+   start = now();
+   if ( !writePrintFile( "credit.dat", "print.txt", threads ) )
+   {
+      cerr << "print.txt could not be written." << endl;
+      exit( 1 );
+   } // end if
+   double parallel = now() - start;
+
+   string expected = readFile( "print.seq.txt" );
+   bool same = ( expected == readFile( "print.txt" ) );
+
+   cout << fixed << setprecision( 3 )
+      << "credit.dat     : " << accounts.getSlotCount() << " slot(s), "
+      << expected.size() << " byte(s) of text\n"
+      << "outputLine     : " << setw( 8 ) << sequential << " s\n"
+      << "writePrintFile : " << setw( 8 ) << parallel << " s ("
+      << setprecision( 1 ) << sequential / parallel << "x)\n"
+      << "print.txt " << ( same ? "matches" : "DIFFERS FROM" )
+      << " print.seq.txt" << endl;
+   return same ? 0 : 1;
+} // end main
@@ -0,0 +1,315 @@
+// PrintFile.cpp
+// Functions that format account records as lines of print.txt.
+#include <iomanip>
+#include <fstream>
+#include <cstdio> // snprintf
+#include <algorithm> // min
+#include <cerrno> // errno
+#include <unistd.h> // sysconf, pipe, fork, read, write, close, _exit
+#include <pthread.h>
+#include <sys/wait.h> // waitpid
+#include "PrintFile.h"
+using namespace std;
+
+// account slots formatted by a thread at a time
+static const int PRINT_CHUNK_SLOTS = 65536;
+
+// display single record
+void outputLine( ostream &output, const ClientData &record )
+{
+   output << left << setw( 10 ) << record.getAccountNumber()
+      << setw( 16 ) << record.getLastName()
+      << setw( 11 ) << record.getFirstName()
+      << setw( 10 ) << setprecision( 2 ) << right << fixed
+      << showpoint << record.getBalance() << endl;
+} // end function outputLine
+
+// write an integer in decimal, return its length
+static int formatInteger( char *text, int value )
+{
+   char digits[ 12 ];
+   int count = 0;
+   unsigned int magnitude = ( value < 0 )
+      ? 0u - static_cast< unsigned int >( value )
+      : static_cast< unsigned int >( value );
+   do
+   {
+      digits[ count++ ] = '0' + magnitude % 10;
+      magnitude /= 10;
+   } while ( magnitude > 0 );
+
+   int length = 0;
+   if ( value < 0 )
+      text[ length++ ] = '-';
+   while ( count > 0 )
+      text[ length++ ] = digits[ --count ];
+   return length;
+} // end function formatInteger
+
+// append characters left aligned in a field of a width
+static void appendLeft( vector< char > &text, const char *value,
+   size_t length, size_t width )
+{
+   text.insert( text.end(), value, value + length );
+   if ( length < width )
+      text.insert( text.end(), width - length, ' ' );
+} // end function appendLeft
+
+// append the line of a record to a buffer
+void appendAccountLine( vector< char > &text, const ClientData &record )
+{
+   char number[ CENTS_TEXT_LENGTH ];
+
+   int length = formatInteger( number, record.getAccountNumber() );
+   appendLeft( text, number, length, 10 );
+
+   string name = record.getLastName();
+   appendLeft( text, name.data(), name.size(), 16 );
+   name = record.getFirstName();
+   appendLeft( text, name.data(), name.size(), 11 );
+
+   // the balance is right aligned, written from its exact cents
+   length = formatCents( number, record.getBalanceCents() );
+   if ( length < 10 )
+      text.insert( text.end(), 10 - length, ' ' );
+   text.insert( text.end(), number, number + length );
+   text.push_back( '\n' );
+} // end function appendAccountLine
+
+// a chunk of slots formatted by a thread
+struct PrintChunk
+{
+   bool ready; // formatted, waiting to be written
+   vector< char > text; // lines of the accounts in the chunk
+   string warnings; // damaged records of the chunk
+}; // end struct PrintChunk
+
+// the work shared by the formatting threads
+struct PrintJob
+{
+   Snapshot *snapshot; // the version of credit.dat printed
+   int slotCount;
+   int chunkCount;
+   int nextChunk; // next chunk to format
+   int writtenChunks; // chunks written to the text file
+   vector< PrintChunk > chunks; // chunk n is formatted in chunks[ n % size ]
+   pthread_mutex_t mutex;
+   pthread_cond_t formatted; // a chunk is ready
+   pthread_cond_t written; // a chunk was written, its buffer is free
+}; // end struct PrintJob
+
+// format one chunk of slots into its buffer
+static void formatChunk( PrintJob &job, int chunkNumber,
+   vector< ClientData > &records, vector< uint32_t > &sums,
+   PrintChunk &chunk )
+{
+   int first = chunkNumber * PRINT_CHUNK_SLOTS + 1;
+   int count = min( PRINT_CHUNK_SLOTS, job.slotCount - first + 1 );
+
+   // a slot changed since the snapshot was pinned has no checksum
+   int slotsRead = job.snapshot->readSlots( first, count, &records[ 0 ],
+      &sums[ 0 ] );
+
+   chunk.text.clear(); // keeps the buffer allocated
+   chunk.warnings.clear();
+   for ( int i = 0; i < slotsRead; i++ )
+   {
+      // warn about a damaged record
+      if ( sums[ i ] != 0
+         && sums[ i ] != accountChecksum( records[ i ] ) )
+      {
+         char warning[ 80 ];
+         snprintf( warning, sizeof( warning ),
+            "Account #%d fails its checksum, the record is damaged.\n",
+            first + i );
+         chunk.warnings += warning;
+      } // end if
+
+      if ( records[ i ].getAccountNumber() != 0 ) // skip empty records
+         appendAccountLine( chunk.text, records[ i ] );
+   } // end for
+} // end function formatChunk
+
+// body of a formatting thread: take chunks until none is left
+static void *formatChunks( void *argument )
+{
+   PrintJob &job = *static_cast< PrintJob * >( argument );
+   vector< ClientData > records( PRINT_CHUNK_SLOTS );
+   vector< uint32_t > sums( PRINT_CHUNK_SLOTS );
+   int bufferCount = job.chunks.size();
+
+   pthread_mutex_lock( &job.mutex );
+   while ( true )
+   {
+      // stay at most one round of buffers ahead of the writer
+      while ( job.nextChunk < job.chunkCount
+         && job.nextChunk >= job.writtenChunks + bufferCount )
+         pthread_cond_wait( &job.written, &job.mutex );
+      if ( job.nextChunk >= job.chunkCount )
+         break;
+
+      int chunkNumber = job.nextChunk++;
+      PrintChunk &chunk = job.chunks[ chunkNumber % bufferCount ];
+      pthread_mutex_unlock( &job.mutex );
+
+      formatChunk( job, chunkNumber, records, sums, chunk );
+
+      pthread_mutex_lock( &job.mutex );
+      chunk.ready = true;
+      pthread_cond_broadcast( &job.formatted );
+   } // end while
+   pthread_mutex_unlock( &job.mutex );
+   return 0;
+} // end function formatChunks
+
+// write the accounts of a records file to a text file
+bool writePrintFile( const string &dataName, const string &printName,
+   int threadCount )
+{
+   // the accounts are printed as they were when the snapshot was
+   // pinned, while the file goes on being updated
+   Snapshot snapshot;
+   string reason;
+   if ( !snapshot.pin( dataName, reason ) )
+      return false;
+   return writePrintFile( snapshot, printName, threadCount );
+} // end function writePrintFile
+
+// write the accounts of a pinned snapshot to a text file
+bool writePrintFile( Snapshot &snapshot, const string &printName,
+   int threadCount )
+{
+   if ( threadCount <= 0 )
+      threadCount = max( 1L, sysconf( _SC_NPROCESSORS_ONLN ) );
+
+   ofstream outPrintFile( printName.c_str(), ios::out );
+   if ( !outPrintFile )
+      return false;
+
+   outPrintFile << left << setw( 10 ) << "Account" << setw( 16 )
+      << "Last Name" << setw( 11 ) << "First Name" << right
+      << setw( 10 ) << "Balance" << endl;
+
+   PrintJob job;
+   job.snapshot = &snapshot;
+   job.slotCount = snapshot.getSlotCount();
+   job.chunkCount = ( job.slotCount + PRINT_CHUNK_SLOTS - 1 )
+      / PRINT_CHUNK_SLOTS;
+   job.nextChunk = 0;
+   job.writtenChunks = 0;
+   job.chunks.resize( 2 * threadCount );
+   for ( size_t i = 0; i < job.chunks.size(); i++ )
+   {
+      job.chunks[ i ].ready = false;
+      job.chunks[ i ].text.reserve( PRINT_CHUNK_SLOTS * 48 );
+   } // end for
+   pthread_mutex_init( &job.mutex, 0 );
+   pthread_cond_init( &job.formatted, 0 );
+   pthread_cond_init( &job.written, 0 );
+
+   // the checksum table is built before the threads share it
+   accountChecksum( ClientData() );
+
+   vector< pthread_t > threads( threadCount );
+   for ( int i = 0; i < threadCount; i++ )
+      pthread_create( &threads[ i ], 0, formatChunks, &job );
+
+   // write the chunks in file order as they are formatted
+   for ( int chunkNumber = 0; chunkNumber < job.chunkCount; chunkNumber++ )
+   {
+      PrintChunk &chunk = job.chunks[ chunkNumber % job.chunks.size() ];
+      pthread_mutex_lock( &job.mutex );
+      while ( !chunk.ready )
+         pthread_cond_wait( &job.formatted, &job.mutex );
+      pthread_mutex_unlock( &job.mutex );
+
+      if ( !chunk.text.empty() )
+         outPrintFile.write( &chunk.text[ 0 ], chunk.text.size() );
+      cerr << chunk.warnings;
+
+      pthread_mutex_lock( &job.mutex );
+      chunk.ready = false;
+      job.writtenChunks++;
+      pthread_cond_broadcast( &job.written );
+      pthread_mutex_unlock( &job.mutex );
+   } // end for
+
+   for ( int i = 0; i < threadCount; i++ )
+      pthread_join( threads[ i ], 0 );
+   pthread_cond_destroy( &job.written );
+   pthread_cond_destroy( &job.formatted );
+   pthread_mutex_destroy( &job.mutex );
+
+   outPrintFile.close();
+   return !outPrintFile.fail();
+} // end function writePrintFile
+
+// no print in progress
+PrintProcess::PrintProcess()
+   : child( 0 ), doneFd( -1 )
+{
+} // end PrintProcess constructor
+
+// wait for a print in progress
+PrintProcess::~PrintProcess()
+{
+   finish();
+} // end PrintProcess destructor
+
+// pin a snapshot and write a print file from it in a child process
+bool PrintProcess::start( const string &dataName, const string &printName )
+{
+   string reason;
+   int done[ 2 ];
+   if ( child > 0 || !snapshot.pin( dataName, reason ) )
+      return false;
+   if ( pipe( done ) < 0 )
+   {
+      snapshot.release();
+      return false;
+   } // end if
+
+   cout.flush(); // nothing buffered is written twice
+   pid_t started = fork();
+   if ( started == 0 )
+   {
+      // the child writes the file and its result, and ends without
+      // releasing the snapshot, which its parent still holds
+      close( done[ 0 ] );
+      char written = writePrintFile( snapshot, printName, 0 );
+      _exit( write( done[ 1 ], &written, 1 ) == 1 ? 0 : 1 );
+   } // end if
+
+   close( done[ 1 ] );
+   if ( started < 0 )
+   {
+      close( done[ 0 ] );
+      snapshot.release();
+      return false;
+   } // end if
+   child = started;
+   doneFd = done[ 0 ];
+   return true;
+} // end function start
+
+// wait for the child and release the snapshot
+bool PrintProcess::finish()
+{
+   if ( child <= 0 )
+      return false;
+
+   // a child that ended without a result did not write the file
+   char written = 0;
+   ssize_t bytes;
+   while ( ( bytes = read( doneFd, &written, 1 ) ) < 0 && errno == EINTR )
+      ;
+   close( doneFd );
+   doneFd = -1;
+   while ( waitpid( child, 0, 0 ) < 0 && errno == EINTR )
+      ;
+   child = 0;
+
+   // the child no longer reads the pages of the snapshot
+   snapshot.release();
+   return bytes == 1 && written;
+} // end function finish
@@ -0,0 +1,62 @@
+// PrintFile.h
+// Functions that format account records as lines of print.txt.
+#ifndef PRINTFILE_H
+#define PRINTFILE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/types.h> // pid_t
+#include "ClientData.h" // ClientData class definition
+#include "Snapshot.h" // Snapshot class definition
+using namespace std;
+
+// display single record with stream manipulators
+void outputLine( ostream&, const ClientData & );
+// append the line outputLine() writes for a record to a buffer,
+// without the formatting state of a stream
+void appendAccountLine( vector< char > &, const ClientData & );
+
+// write the accounts of a records file to a text file, each line
+// as outputLine() writes it. the file is split into chunks that
+// are formatted on a number of threads (0 for one per processor)
+// and written in file order
+bool writePrintFile( const string &, const string &, int );
+// write the accounts of a pinned snapshot to a text file, as the
+// function above does
+bool writePrintFile( Snapshot &, const string &, int );
+
+// PrintProcess writes a print file in a child process, from a
+// snapshot the caller pins before the child starts, so the caller
+// goes on updating the records file meanwhile. the page locks of
+// the snapshot (fcntl) belong to a process, so a child, unlike a
+// thread, is kept out of the pages its parent is changing
+class PrintProcess
+{
+public:
+   PrintProcess();
+   ~PrintProcess(); // waits for a print in progress
+
+   // pin a snapshot of a records file and start writing a print
+   // file from it in a child process; false if a print is in
+   // progress or it could not be started
+   bool start( const string &, const string & );
+   bool isRunning() const { return child > 0; }
+   // descriptor that becomes readable when the child is done,
+   // -1 when no print is in progress
+   int getDoneFd() const { return doneFd; }
+   // wait for the child and release the snapshot, true if the
+   // print file was written
+   bool finish();
+
+private:
+   // a print has a single owner
+   PrintProcess( const PrintProcess & );
+   PrintProcess &operator=( const PrintProcess & );
+
+   Snapshot snapshot;
+   pid_t child; // 0 when no print is in progress
+   int doneFd; // the child writes its result to this pipe
+}; // end class PrintProcess
+
+#endif
@@ -0,0 +1,86 @@
+// ReplayFeed.cpp
+// Apply a feed of charges and payments to credit.dat in one batch.
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib> // exit
+#include <unistd.h> // close
+#include <sys/time.h> // gettimeofday
+#include "TransactionFeed.h" // readFeed, replayFeed
+#include "AccountService.h" // connectService
+using namespace std;
+
+// seconds since the epoch, with microseconds
+double now()
+{
+   timeval time;
+   gettimeofday( &time, 0 );
+   return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+int main( int argc, char *argv[] )
+{
+   if ( argc < 2 )
+   {
+      cerr << "usage: " << argv[ 0 ] << " feed [rejected]" << endl;
+      exit( 1 );
+   } // end if
+   const char *rejectName = ( argc > 2 ? argv[ 2 ] : "rejected.txt" );
+
+   // a running AccountServer owns the file, and its cache would
+   // overwrite the balances of the feed
+   int service = connectService();
+   if ( service >= 0 )
+   {
+      close( service );
+      cerr << "credit.dat is served by AccountServer, stop it first."
+         << endl;
+      exit( 1 );
+   } // end if
+
+   double start = now();
+   vector< Transaction > feed;
+   string reason;
+   if ( !readFeed( argv[ 1 ], feed, reason ) )
+   {
+      cerr << argv[ 1 ] << ": " << reason << endl;
+      exit( 1 );
+   } // end if
+   double read = now() - start;
+
+   ofstream rejects( rejectName, ios::out );
+   if ( !rejects )
+   {
+      cerr << rejectName << " could not be created." << endl;
+      exit( 1 );
+   } // end if
+
+   start = now();
+   ReplayResult result;
+   if ( !replayFeed( "credit.dat", feed, rejects, result, reason ) )
+   {
+      cerr << "credit.dat: " << reason << ", no transaction was applied."
+         << endl;
+      exit( 1 );
+   } // end if
+   double replay = now() - start;
+
+   cout << fixed << setprecision( 3 )
+      << "transactions : " << feed.size() << " read in " << read << " s\n"
+      << "applied      : " << result.applied << " to " << result.accounts
+      << " account(s) in " << replay << " s\n"
+      << "rejected     : " << result.rejected
+      << " for unknown accounts or overflow, written to " << rejectName
+      << '\n'
+      << "throughput   : " << setprecision( 0 )
+      << feed.size() / ( read + replay ) << " transactions/s" << endl;
+
+   // the feed is in the file, but its records are not checked
+   if ( result.checksumsMissing )
+   {
+      cerr << "credit.dat: feed applied, but credit.crc could not be "
+         << "replaced, the records have no checksums." << endl;
+      return 3;
+   } // end if
+   return result.rejected > 0 ? 2 : 0;
+} // end main
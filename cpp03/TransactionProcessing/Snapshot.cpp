@@ -0,0 +1,360 @@
+// Snapshot.cpp
+// Member-function definitions for classes Snapshot and SnapshotWriter.
+#include <cstdio> // snprintf
+#include <cstring> // memset, memcpy
+#include <cerrno> // errno
+#include <algorithm> // min, max
+#include <fcntl.h> // open, fcntl
+#include <unistd.h> // pread, pwrite, ftruncate, unlink, close, getpid
+#include <signal.h> // kill
+#include <sys/stat.h> // fstat
+#include "Snapshot.h"
+using namespace std;
+
+// an entry of the registry, after its first REGISTRY_HEADER bytes;
+// the first byte is locked shared by updates and exclusively while
+// the entries change
+struct RegistryEntry
+{
+   int32_t pid; // process holding the snapshot, 0 if the entry is free
+   int32_t reserved;
+   int64_t pageCount; // pages of the pinned file
+   uint64_t device; // identity of the pinned file
+   uint64_t inode;
+}; // end struct RegistryEntry
+
+static const off_t REGISTRY_HEADER = 64;
+
+// lock, or unlock with F_UNLCK, a byte range of a file, waiting
+// for conflicting locks of other processes; a length of 0 reaches
+// to the end of the file
+static void lockRange( int fd, short type, off_t start, off_t length )
+{
+   struct flock lock;
+   memset( &lock, 0, sizeof( lock ) );
+   lock.l_type = type;
+   lock.l_whence = SEEK_SET;
+   lock.l_start = start;
+   lock.l_len = length;
+   while ( fcntl( fd, F_SETLKW, &lock ) < 0 && errno == EINTR )
+      ; // interrupted by a signal, wait again
+} // end function lockRange
+
+// byte offset of an entry of the registry
+static off_t entryPosition( int index )
+{
+   return REGISTRY_HEADER + static_cast< off_t >( index )
+      * sizeof( RegistryEntry );
+} // end function entryPosition
+
+// read an entry of the registry, a free one past its end
+static RegistryEntry readEntry( int registryFd, int index )
+{
+   RegistryEntry entry;
+   if ( pread( registryFd, &entry, sizeof( entry ), entryPosition( index ) )
+      != static_cast< ssize_t >( sizeof( entry ) ) )
+      memset( &entry, 0, sizeof( entry ) );
+   return entry;
+} // end function readEntry
+
+// true if an entry belongs to a running process
+static bool isPinned( const RegistryEntry &entry )
+{
+   return entry.pid != 0
+      && ( kill( entry.pid, 0 ) == 0 || errno == EPERM );
+} // end function isPinned
+
+// name of the page file of a snapshot
+static string pageFileOf( int index )
+{
+   char name[ 64 ];
+   snprintf( name, sizeof( name ), "%s.%d", CREDIT_SNAPSHOT_FILE, index );
+   return name;
+} // end function pageFileOf
+
+// byte offset of a page image in a page file of a number of pages:
+// a byte per page tells if it was copied, then come the images
+static off_t imageOffset( int64_t pageCount, int64_t page )
+{
+   int64_t flagPages = ( pageCount + SNAPSHOT_PAGE_SIZE - 1 )
+      / SNAPSHOT_PAGE_SIZE;
+   return static_cast< off_t >( flagPages + page ) * SNAPSHOT_PAGE_SIZE;
+} // end function imageOffset
+
+// create an unpinned snapshot
+Snapshot::Snapshot()
+   : registryFd( -1 ), entry( -1 ), dataFd( -1 ), pageFd( -1 ),
+     sumFd( -1 ), pageCount( 0 ), slotCount( 0 )
+{
+} // end Snapshot constructor
+
+// release the snapshot
+Snapshot::~Snapshot()
+{
+   release();
+} // end Snapshot destructor
+
+// pin the current version of a records file
+bool Snapshot::pin( const string &dataName, string &reason )
+{
+   release();
+   registryFd = open( CREDIT_SNAPSHOT_FILE, O_RDWR | O_CREAT, 0644 );
+   dataFd = open( dataName.c_str(), O_RDONLY );
+   if ( registryFd < 0 || dataFd < 0 )
+   {
+      reason = ( dataFd < 0 ) ? "file could not be opened"
+         : "snapshot registry could not be opened";
+      release();
+      return false;
+   } // end if
+
+   // no update is in progress while the registry is locked
+   lockRange( registryFd, F_WRLCK, 0, 1 );
+
+   struct stat info;
+   fstat( dataFd, &info );
+   pageCount = ( info.st_size + SNAPSHOT_PAGE_SIZE - 1 ) / SNAPSHOT_PAGE_SIZE;
+   // every whole record after the header
+   slotCount = ( info.st_size > CREDIT_HEADER_SIZE )
+      ? ( info.st_size - CREDIT_HEADER_SIZE ) / sizeof( ClientData ) : 0;
+
+   // take a free entry, or one left by a process that ended
+   for ( int index = 0; index < MAX_SNAPSHOTS && entry < 0; index++ )
+      if ( !isPinned( readEntry( registryFd, index ) ) )
+         entry = index;
+
+   RegistryEntry pinned;
+   memset( &pinned, 0, sizeof( pinned ) );
+   pinned.pid = getpid();
+   pinned.pageCount = pageCount;
+   pinned.device = info.st_dev;
+   pinned.inode = info.st_ino;
+
+   // a sparse page file, with room for every page of the file
+   if ( entry >= 0 )
+   {
+      pageFileName = pageFileOf( entry );
+      pageFd = open( pageFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+   } // end if
+   bool pinnedOk = pageFd >= 0
+      && ftruncate( pageFd, imageOffset( pageCount, pageCount ) ) == 0
+      && pwrite( registryFd, &pinned, sizeof( pinned ),
+         entryPosition( entry ) ) == static_cast< ssize_t >( sizeof( pinned ) );
+   lockRange( registryFd, F_UNLCK, 0, 1 );
+
+   if ( !pinnedOk )
+   {
+      reason = ( entry < 0 ) ? "too many snapshots are pinned"
+         : "snapshot file could not be created";
+      if ( pageFd >= 0 )
+         unlink( pageFileName.c_str() );
+      entry = -1; // the entry was not written
+      release();
+      return false;
+   } // end if
+
+   sumFd = open( CREDIT_CHECKSUM_FILE, O_RDONLY );
+   return true;
+} // end function pin
+
+// release the snapshot and remove its file
+void Snapshot::release()
+{
+   if ( entry >= 0 )
+   {
+      // writers open the page file only while holding the lock
+      lockRange( registryFd, F_WRLCK, 0, 1 );
+      RegistryEntry blank;
+      memset( &blank, 0, sizeof( blank ) );
+      pwrite( registryFd, &blank, sizeof( blank ), entryPosition( entry ) );
+      unlink( pageFileName.c_str() );
+      lockRange( registryFd, F_UNLCK, 0, 1 );
+      entry = -1;
+   } // end if
+
+   int *fds[] = { &registryFd, &dataFd, &pageFd, &sumFd };
+   for ( size_t i = 0; i < sizeof( fds ) / sizeof( fds[ 0 ] ); i++ )
+      if ( *fds[ i ] >= 0 )
+      {
+         close( *fds[ i ] );
+         *fds[ i ] = -1;
+      } // end if
+   slotCount = 0;
+   pageCount = 0;
+} // end function release
+
+// read a run of slots of the pinned version
+int Snapshot::readSlots( int first, int count, ClientData *records,
+   uint32_t *sums )
+{
+   if ( entry < 0 || first < 1 || first > slotCount || count <= 0 )
+      return 0;
+   count = min( count, slotCount - first + 1 );
+
+   off_t start = accountPosition( first );
+   size_t length = static_cast< size_t >( count ) * sizeof( ClientData );
+   char *bytes = reinterpret_cast< char * >( records );
+
+   // no page of the run changes or is copied while it is read
+   lockRange( dataFd, F_RDLCK, start, length );
+
+   // a run of records never written is blank, and needs no read
+   int64_t written;
+   int64_t writtenEnd;
+   int slotsRead = count;
+   if ( findWrittenRecords( dataFd, first, first + count - 1, written,
+      writtenEnd ) )
+   {
+      ssize_t bytesRead = pread( dataFd, bytes, length, start );
+      slotsRead = ( bytesRead > 0 ? bytesRead / sizeof( ClientData ) : 0 );
+   } // end if
+   else
+      memset( bytes, 0, length );
+
+   // a slot past the end of credit.crc has no checksum
+   if ( sums != 0 )
+   {
+      ssize_t sumBytes = ( sumFd < 0 ) ? 0 : pread( sumFd, sums,
+         count * sizeof( uint32_t ),
+         static_cast< off_t >( first - 1 ) * sizeof( uint32_t ) );
+      int sumsRead = ( sumBytes > 0 ? sumBytes / sizeof( uint32_t ) : 0 );
+      for ( int i = sumsRead; i < count; i++ )
+         sums[ i ] = 0;
+   } // end if
+
+   // pages changed since the snapshot was pinned come from its file
+   int64_t firstPage = start / SNAPSHOT_PAGE_SIZE;
+   int64_t lastPage = min( pageCount - 1,
+      static_cast< int64_t >( ( start + length - 1 ) / SNAPSHOT_PAGE_SIZE ) );
+   vector< char > copied( max< int64_t >( lastPage - firstPage + 1, 0 ) );
+   if ( !copied.empty() )
+      pread( pageFd, &copied[ 0 ], copied.size(), firstPage );
+
+   char image[ SNAPSHOT_PAGE_SIZE ];
+   for ( int64_t page = firstPage; page <= lastPage; page++ )
+   {
+      if ( !copied[ page - firstPage ] )
+         continue;
+      pread( pageFd, image, SNAPSHOT_PAGE_SIZE,
+         imageOffset( pageCount, page ) );
+
+      // the part of the page inside the run
+      off_t pageStart = static_cast< off_t >( page ) * SNAPSHOT_PAGE_SIZE;
+      off_t from = max( start, pageStart );
+      off_t to = min( static_cast< off_t >( start + length ),
+         pageStart + SNAPSHOT_PAGE_SIZE );
+      memcpy( bytes + ( from - start ), image + ( from - pageStart ),
+         to - from );
+
+      // the checksums of credit.crc describe the changed records
+      if ( sums != 0 )
+         for ( off_t slot = ( from - start ) / sizeof( ClientData );
+            slot <= ( to - 1 - start ) / static_cast< off_t >(
+               sizeof( ClientData ) ); slot++ )
+            sums[ slot ] = 0;
+   } // end for
+
+   lockRange( dataFd, F_UNLCK, start, length );
+   return slotsRead;
+} // end function readSlots
+
+// create a writer that has no update in progress
+SnapshotWriter::SnapshotWriter()
+   : registryFd( -1 ), dataFd( -1 ), device( 0 ), inode( 0 )
+{
+} // end SnapshotWriter constructor
+
+// close the registry
+SnapshotWriter::~SnapshotWriter()
+{
+   if ( registryFd >= 0 )
+      close( registryFd );
+} // end SnapshotWriter destructor
+
+// start an update of the file open on a descriptor
+void SnapshotWriter::begin( int fd )
+{
+   if ( registryFd < 0 )
+      registryFd = open( CREDIT_SNAPSHOT_FILE, O_RDWR | O_CREAT, 0644 );
+   struct stat info;
+   if ( registryFd < 0 || fd < 0 || fstat( fd, &info ) < 0 )
+      return; // the file is updated without snapshots
+
+   // snapshots cannot be pinned or released until end()
+   lockRange( registryFd, F_RDLCK, 0, 1 );
+   dataFd = fd;
+   device = info.st_dev;
+   inode = info.st_ino;
+
+   for ( int index = 0; index < MAX_SNAPSHOTS; index++ )
+   {
+      RegistryEntry entry = readEntry( registryFd, index );
+      if ( !isPinned( entry ) || entry.device != device
+         || entry.inode != inode )
+         continue;
+
+      Pinned snapshot;
+      snapshot.pageFd = open( pageFileOf( index ).c_str(), O_RDWR );
+      snapshot.pageCount = entry.pageCount;
+      if ( snapshot.pageFd >= 0 )
+         pinned.push_back( snapshot );
+   } // end for
+} // end function begin
+
+// copy the pages of a byte range into the snapshots without them
+void SnapshotWriter::preserve( int fd, off_t start, size_t length )
+{
+   if ( dataFd < 0 || pinned.empty() || length == 0 )
+      return;
+
+   // a file renamed over the old one during the update (a grown
+   // hashed file) has no snapshots yet
+   struct stat info;
+   if ( fstat( fd, &info ) < 0 || info.st_dev != device
+      || info.st_ino != inode )
+      return;
+
+   // the pages stay locked until end(), so a reader sees them
+   // either before the update or after it
+   int64_t firstPage = start / SNAPSHOT_PAGE_SIZE;
+   int64_t lastPage = ( start + length - 1 ) / SNAPSHOT_PAGE_SIZE;
+   lockRange( fd, F_WRLCK, firstPage * SNAPSHOT_PAGE_SIZE,
+      ( lastPage - firstPage + 1 ) * SNAPSHOT_PAGE_SIZE );
+
+   char image[ SNAPSHOT_PAGE_SIZE ];
+   for ( size_t i = 0; i < pinned.size(); i++ )
+      for ( int64_t page = firstPage;
+         page <= lastPage && page < pinned[ i ].pageCount; page++ )
+      {
+         char copied = 0;
+         pread( pinned[ i ].pageFd, &copied, 1, page );
+         if ( copied )
+            continue;
+
+         // the image is complete before it is marked copied
+         ssize_t bytes = pread( fd, image, SNAPSHOT_PAGE_SIZE,
+            static_cast< off_t >( page ) * SNAPSHOT_PAGE_SIZE );
+         memset( image + max< ssize_t >( bytes, 0 ), 0,
+            SNAPSHOT_PAGE_SIZE - max< ssize_t >( bytes, 0 ) );
+         copied = 1;
+         if ( pwrite( pinned[ i ].pageFd, image, SNAPSHOT_PAGE_SIZE,
+            imageOffset( pinned[ i ].pageCount, page ) )
+            == SNAPSHOT_PAGE_SIZE )
+            pwrite( pinned[ i ].pageFd, &copied, 1, page );
+      } // end for
+} // end function preserve
+
+// finish the update
+void SnapshotWriter::end( int fd )
+{
+   if ( dataFd < 0 )
+      return;
+
+   if ( !pinned.empty() && fd >= 0 )
+      lockRange( fd, F_UNLCK, 0, 0 ); // every page preserve() locked
+   for ( size_t i = 0; i < pinned.size(); i++ )
+      close( pinned[ i ].pageFd );
+   pinned.clear();
+   lockRange( registryFd, F_UNLCK, 0, 1 );
+   dataFd = -1;
+} // end function end
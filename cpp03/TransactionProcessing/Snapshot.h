@@ -0,0 +1,101 @@
+// Snapshot.h
+// Classes Snapshot and SnapshotWriter give readers of credit.dat a
+// consistent version of the file while it is being updated.
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <stdint.h> // fixed size integers
+#include <sys/types.h> // off_t
+#include "ClientData.h" // ClientData class definition
+using namespace std;
+
+// registry of the snapshots taken of credit.dat; snapshot n keeps
+// its pages in the file of this name followed by ".n"
+const char CREDIT_SNAPSHOT_FILE[] = "credit.snap";
+// snapshots that may be pinned at once
+const int MAX_SNAPSHOTS = 32;
+// bytes of credit.dat copied on write at a time
+const int SNAPSHOT_PAGE_SIZE = 4096;
+
+// a snapshot is a version of credit.dat pinned by a reader.
+// the data file is still updated in place, but before a writer
+// changes a page for the first time since a snapshot was pinned it
+// copies the old page into the snapshot's file (copy on write, see
+// SnapshotWriter). the reader reads a page from the snapshot file if
+// it was copied, from credit.dat otherwise, so it sees the file as
+// it was when pinned however long it takes.
+//
+// the snapshot files are sparse: only pages changed while a snapshot
+// is pinned take up space. a snapshot is only pinned between two
+// updates of the file, and a page is locked (fcntl) while it is read
+// or copied, so readers never see part of an update. a file renamed
+// over credit.dat (a grown hashed file, ReplayFeed) is a new file:
+// the snapshot keeps reading the file it pinned.
+class Snapshot
+{
+public:
+   Snapshot();
+   ~Snapshot(); // releases the snapshot
+
+   // pin the current version of a records file, with the reason
+   // in the string on failure
+   bool pin( const string &, string & );
+   // release the snapshot and remove its file
+   void release();
+
+   // record slots of the pinned version
+   int getSlotCount() const { return slotCount; }
+
+   // read a run of slots of the pinned version into an array, and
+   // their checksums from credit.crc into the last array if it is
+   // not 0; a slot changed since the version was pinned has no
+   // checksum (0). return slots read. safe to call from threads
+   int readSlots( int, int, ClientData *, uint32_t * );
+
+private:
+   int registryFd; // credit.snap
+   int entry; // entry of the registry, -1 if not pinned
+   int dataFd; // the pinned credit.dat
+   int pageFd; // pages copied from it
+   int sumFd; // credit.crc, -1 if there is none
+   int64_t pageCount; // pages of the pinned file
+   int slotCount;
+   string pageFileName;
+}; // end class Snapshot
+
+// SnapshotWriter copies pages of credit.dat into the snapshots that
+// need them before they are changed. an update is bracketed by
+// begin() and end(), which lock out pinning a snapshot meanwhile.
+class SnapshotWriter
+{
+public:
+   SnapshotWriter();
+   ~SnapshotWriter();
+
+   // start an update of the file open on a descriptor
+   void begin( int );
+   // lock the pages of a byte range of the file and copy each one
+   // into the pinned snapshots that do not have it yet
+   void preserve( int, off_t, size_t );
+   // finish the update of the file open on a descriptor (it may
+   // have been reopened since begin()), unlocking its pages
+   void end( int );
+
+private:
+   // a snapshot of the file being updated
+   struct Pinned
+   {
+      int pageFd;
+      int64_t pageCount;
+   }; // end struct Pinned
+
+   int registryFd;
+   int dataFd; // file of the update in progress, -1 if none
+   dev_t device; // the file's identity when the update began
+   ino_t inode;
+   vector< Pinned > pinned;
+}; // end class SnapshotWriter
+
+#endif
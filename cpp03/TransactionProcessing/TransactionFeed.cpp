@@ -0,0 +1,401 @@
+// TransactionFeed.cpp
+// Functions that apply a feed of charges and payments to credit.dat
+// in one batch.
+#include <fstream>
+#include <cstdio> // snprintf, rename, remove
+#include <cstdlib> // strtol
+#include <cstring> // memchr, memmove
+#include <cerrno> // errno
+#include <climits> // INT_MIN, INT_MAX
+#include <algorithm> // stable_sort, lower_bound, min
+#include <limits> // numeric_limits
+#include <fcntl.h> // open
+#include <unistd.h> // read, pwrite, ftruncate, fsync, close
+#include "TransactionFeed.h"
+#include "ClientData.h" // ClientData class definition
+#include "AccountFile.h" // AccountFile class definition
+using namespace std;
+
+// bytes of the feed read at a time, the longest line allowed
+static const size_t FEED_BUFFER = 1 << 20;
+// slots copied at a time (about 1 MiB)
+static const int REPLAY_SLOTS = ( 1 << 20 ) / sizeof( ClientData );
+
+// true if a character is a space or tab, or ends a line
+static bool isBlank( char c )
+{
+   return c == ' ' || c == '\t' || c == '\r';
+} // end function isBlank
+
+// parse a line of the feed: 1 for a transaction, 0 for a blank
+// line, -1 if the line is not an account and an amount
+static int parseTransaction( char *line, Transaction &transaction )
+{
+   while ( isBlank( *line ) )
+      line++;
+   if ( *line == '\0' )
+      return 0;
+
+   char *end;
+   errno = 0;
+   long account = strtol( line, &end, 10 );
+   if ( end == line || errno != 0 || account < INT_MIN || account > INT_MAX
+      || !isBlank( *end ) )
+      return -1;
+
+   while ( isBlank( *end ) )
+      end++;
+   int64_t amount;
+   int length = parseCents( end, amount );
+   if ( length == 0 )
+      return -1;
+   const char *amountEnd = end + length;
+   while ( isBlank( *amountEnd ) )
+      amountEnd++;
+   if ( *amountEnd != '\0' )
+      return -1;
+
+   transaction.account = static_cast< int >( account );
+   transaction.amount = amount;
+   return 1;
+} // end function parseTransaction
+
+// read a feed of "account amount" lines
+bool readFeed( const string &feedName, vector< Transaction > &feed,
+   string &reason )
+{
+   int feedFd = open( feedName.c_str(), O_RDONLY );
+   if ( feedFd < 0 )
+   {
+      reason = "feed could not be opened";
+      return false;
+   } // end if
+
+   // one more byte ends a last line that has no newline
+   vector< char > buffer( FEED_BUFFER + 1 );
+   size_t kept = 0; // bytes of a line carried over from the last read
+   long lineNumber = 0;
+   bool atEnd = false;
+   reason.clear();
+
+   while ( !atEnd && reason.empty() )
+   {
+      ssize_t bytes = read( feedFd, &buffer[ kept ], FEED_BUFFER - kept );
+      if ( bytes < 0 )
+      {
+         reason = "feed could not be read";
+         break;
+      } // end if
+      size_t length = kept + bytes;
+      atEnd = ( bytes == 0 );
+      if ( atEnd && length > 0 )
+         buffer[ length++ ] = '\n';
+
+      // parse the whole lines of the buffer
+      size_t start = 0;
+      char *newline;
+      while ( reason.empty() && ( newline = static_cast< char * >(
+         memchr( &buffer[ start ], '\n', length - start ) ) ) != 0 )
+      {
+         *newline = '\0';
+         lineNumber++;
+         Transaction transaction;
+         int parsed = parseTransaction( &buffer[ start ], transaction );
+         if ( parsed > 0 )
+            feed.push_back( transaction );
+         else if ( parsed < 0 )
+         {
+            char line[ 80 ];
+            snprintf( line, sizeof( line ),
+               "line %ld is not an account and an amount", lineNumber );
+            reason = line;
+         } // end else if
+         start = newline - &buffer[ 0 ] + 1;
+      } // end while
+
+      if ( reason.empty() && start == 0 && length == FEED_BUFFER )
+         reason = "feed has a line longer than 1 MiB";
+
+      // move the start of the next line to the front
+      memmove( &buffer[ 0 ], &buffer[ start ], length - start );
+      kept = length - start;
+   } // end while
+
+   close( feedFd );
+   return reason.empty();
+} // end function readFeed
+
+// order transactions by account
+static bool byAccount( const Transaction &left, const Transaction &right )
+{
+   return left.account < right.account;
+} // end function byAccount
+
+// write all of a buffer to a file descriptor at an offset
+static bool writeAll( int fd, const void *data, size_t size, off_t offset )
+{
+   const char *bytes = static_cast< const char * >( data );
+   while ( size > 0 )
+   {
+      ssize_t written = pwrite( fd, bytes, size, offset );
+      if ( written <= 0 )
+         return false;
+      bytes += written;
+      size -= written;
+      offset += written;
+   } // end while
+   return true;
+} // end function writeAll
+
+// apply a feed to a records file whose writer lock is held on a
+// descriptor, which moves to the new file
+static bool replayLocked( const string &dataName,
+   vector< Transaction > &feed, ostream &rejects, ReplayResult &result,
+   string &reason, int &lock )
+{
+   AccountFile accounts;
+   if ( !accounts.open( dataName, reason ) )
+      return false;
+
+   // the header is copied as it is: no account is added or removed
+   char header[ CREDIT_HEADER_SIZE ];
+   ifstream headerFile( dataName.c_str(), ios::in | ios::binary );
+   headerFile.read( header, CREDIT_HEADER_SIZE );
+   if ( !headerFile )
+   {
+      reason = "file could not be read";
+      return false;
+   } // end if
+   headerFile.close();
+
+   // the transactions of each account next to each other, in feed
+   // order; accountsInFeed[ i ] has the transactions from
+   // firstOfAccount[ i ] up to firstOfAccount[ i + 1 ]
+   stable_sort( feed.begin(), feed.end(), byAccount );
+   vector< int > accountsInFeed;
+   vector< size_t > firstOfAccount;
+   for ( size_t i = 0; i < feed.size(); i++ )
+      if ( i == 0 || feed[ i ].account != feed[ i - 1 ].account )
+      {
+         accountsInFeed.push_back( feed[ i ].account );
+         firstOfAccount.push_back( i );
+      } // end if
+   firstOfAccount.push_back( feed.size() );
+   vector< char > inFile( accountsInFeed.size(), 0 );
+   // transactions that would take a balance out of the range of cents
+   vector< char > overflowed( feed.size(), 0 );
+
+   // the new file and its checksums, if credit.crc exists
+   string tempName = dataName + ".tmp";
+   string sumTempName = string( CREDIT_CHECKSUM_FILE ) + ".tmp";
+   ifstream oldSums( CREDIT_CHECKSUM_FILE, ios::in | ios::binary );
+   bool keepSums = oldSums.is_open();
+   int outFd = open( tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+   int sumFd = keepSums
+      ? open( sumTempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 ) : -1;
+   bool written = outFd >= 0 && ( !keepSums || sumFd >= 0 )
+      && writeAll( outFd, header, CREDIT_HEADER_SIZE, 0 );
+
+   vector< ClientData > batch( REPLAY_SLOTS );
+   vector< uint32_t > sums( REPLAY_SLOTS );
+   // the accounts of a direct file ascend with their slots, so the
+   // search for the next one starts after the last one found
+   size_t searchFrom = 0;
+   int slotCount = accounts.getSlotCount();
+
+   // only the runs of slots ever written are copied, the regions of
+   // a sparse file never written hold blank records and stay holes
+   // in the new file and its checksums
+   int regions = open( dataName.c_str(), O_RDONLY );
+   int64_t first = 1;
+   int64_t runEnd = 1;
+   while ( written )
+   {
+      // on to the next run once this one is copied
+      if ( first >= runEnd && !findWrittenRecords( regions, first,
+         slotCount, first, runEnd ) )
+         break;
+      int count = static_cast< int >(
+         min< int64_t >( REPLAY_SLOTS, runEnd - first ) );
+      if ( accounts.readSlots( first, count, &batch[ 0 ] ) != count )
+      {
+         reason = "file is shorter than its header says";
+         written = false;
+         break;
+      } // end if
+
+      // a slot past the end of credit.crc has no checksum
+      int sumsRead = 0;
+      if ( keepSums )
+      {
+         oldSums.seekg( static_cast< streamoff >( first - 1 )
+            * sizeof( uint32_t ) );
+         oldSums.read( reinterpret_cast< char * >( &sums[ 0 ] ),
+            count * sizeof( uint32_t ) );
+         sumsRead = oldSums.gcount() / sizeof( uint32_t );
+         oldSums.clear();
+      } // end if
+      for ( int i = sumsRead; i < count; i++ )
+         sums[ i ] = 0;
+
+      for ( int i = 0; i < count; i++ )
+      {
+         int account = batch[ i ].getAccountNumber();
+         if ( account == 0 ) // skip empty records
+            continue;
+
+         vector< int >::iterator found = lower_bound(
+            accountsInFeed.begin() + ( accounts.isHashed() ? 0 : searchFrom ),
+            accountsInFeed.end(), account );
+         size_t index = found - accountsInFeed.begin();
+         if ( !accounts.isHashed() )
+            searchFrom = index;
+         if ( found == accountsInFeed.end() || *found != account )
+            continue;
+
+         if ( sums[ i ] != 0 && sums[ i ] != accountChecksum( batch[ i ] ) )
+            cerr << "Account #" << first + i
+               << " fails its checksum, the record is damaged." << endl;
+
+         // add the transactions to the balance, exactly in cents; a
+         // transaction that would overflow it is rejected, as
+         // updateAccount() does, and the others still apply
+         int64_t balance = batch[ i ].getBalanceCents();
+         long applied = 0;
+         for ( size_t t = firstOfAccount[ index ];
+            t < firstOfAccount[ index + 1 ]; t++ )
+         {
+            int64_t cents = feed[ t ].amount;
+            if ( ( cents > 0
+                  && balance > numeric_limits< int64_t >::max() - cents )
+               || ( cents < 0
+                  && balance < numeric_limits< int64_t >::min() - cents ) )
+            {
+               overflowed[ t ] = 1;
+               continue;
+            } // end if
+            balance += cents;
+            applied++;
+         } // end for
+         batch[ i ].setBalanceCents( balance );
+         if ( keepSums )
+            sums[ i ] = accountChecksum( batch[ i ] );
+
+         inFile[ index ] = 1;
+         result.applied += applied;
+         result.accounts += ( applied > 0 );
+      } // end for
+
+      written = writeAll( outFd, &batch[ 0 ], count * sizeof( ClientData ),
+            accountPosition( first ) )
+         && ( !keepSums || writeAll( sumFd, &sums[ 0 ],
+            count * sizeof( uint32_t ),
+            static_cast< off_t >( first - 1 ) * sizeof( uint32_t ) ) );
+      first += count;
+   } // end while
+   if ( regions >= 0 )
+      close( regions );
+
+   // the slots after the last run are blank, the files are only
+   // extended to their size
+   written = written && ftruncate( outFd, CREDIT_HEADER_SIZE
+         + static_cast< off_t >( slotCount ) * sizeof( ClientData ) ) == 0
+      && ( !keepSums || ftruncate( sumFd,
+         static_cast< off_t >( slotCount ) * sizeof( uint32_t ) ) == 0 );
+   written = written && fsync( outFd ) == 0
+      && ( !keepSums || fsync( sumFd ) == 0 );
+   if ( outFd >= 0 )
+      written = ( close( outFd ) == 0 ) && written;
+   if ( sumFd >= 0 )
+      written = ( close( sumFd ) == 0 ) && written;
+   oldSums.close();
+   accounts.close();
+
+   if ( written && result.accounts > 0 )
+   {
+      // old checksums never describe new records: credit.crc is
+      // moved aside first, then renaming the new file commits the
+      // feed, then the new checksums are put in place. the old
+      // checksums are put back if the file is not replaced
+      string sumOldName = string( CREDIT_CHECKSUM_FILE ) + ".old";
+      if ( keepSums
+         && rename( CREDIT_CHECKSUM_FILE, sumOldName.c_str() ) != 0 )
+      {
+         reason = "credit.crc could not be moved aside";
+         written = false;
+      } // end if
+      else if ( !replaceCreditFile( tempName, dataName, lock ) )
+      {
+         if ( keepSums )
+            rename( sumOldName.c_str(), CREDIT_CHECKSUM_FILE );
+         reason = "file could not be replaced";
+         written = false;
+      } // end else if
+      else if ( keepSums )
+      {
+         remove( sumOldName.c_str() );
+         // the feed is applied, its records are only unchecked
+         if ( rename( sumTempName.c_str(), CREDIT_CHECKSUM_FILE ) != 0 )
+         {
+            remove( sumTempName.c_str() );
+            result.checksumsMissing = true;
+         } // end if
+      } // end else if
+
+      int dir = open( ".", O_RDONLY );
+      if ( dir >= 0 )
+      {
+         fsync( dir );
+         close( dir );
+      } // end if
+   } // end if
+
+   if ( !written || result.accounts == 0 )
+   {
+      remove( tempName.c_str() );
+      if ( keepSums )
+         remove( sumTempName.c_str() );
+      if ( !written )
+      {
+         if ( reason.empty() )
+            reason = "new file could not be written";
+         return false;
+      } // end if
+   } // end if
+
+   // the transactions of accounts not in the file, and those that
+   // would have overflowed a balance
+   char amount[ CENTS_TEXT_LENGTH ];
+   for ( size_t index = 0; index < accountsInFeed.size(); index++ )
+      for ( size_t t = firstOfAccount[ index ];
+         t < firstOfAccount[ index + 1 ]; t++ )
+         if ( !inFile[ index ] || overflowed[ t ] )
+         {
+            formatCents( amount, feed[ t ].amount );
+            rejects << feed[ t ].account << ' ' << amount << '\n';
+            result.rejected++;
+         } // end if
+   rejects.flush();
+   return true;
+} // end function replayLocked
+
+// apply a feed to a records file in one batch
+bool replayFeed( const string &dataName, vector< Transaction > &feed,
+   ostream &rejects, ReplayResult &result, string &reason )
+{
+   result.applied = 0;
+   result.rejected = 0;
+   result.accounts = 0;
+   result.checksumsMissing = false;
+   reason.clear();
+
+   // no other program writes the file from the read of its first
+   // record until the new file has replaced it
+   int lock = lockCreditFile( dataName, reason );
+   if ( lock < 0 )
+      return false;
+   bool replayed =
+      replayLocked( dataName, feed, rejects, result, reason, lock );
+   close( lock );
+   return replayed;
+} // end function replayFeed
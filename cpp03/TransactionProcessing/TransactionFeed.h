@@ -0,0 +1,50 @@
+// TransactionFeed.h
+// Functions that apply a feed of charges and payments to credit.dat
+// in one batch.
+#ifndef TRANSACTIONFEED_H
+#define TRANSACTIONFEED_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h> // int64_t
+using namespace std;
+
+// a charge (+) or payment (-) to an account
+struct Transaction
+{
+   int account;
+   int64_t amount; // in cents
+}; // end struct Transaction
+
+// counts of a replayed feed
+struct ReplayResult
+{
+   long applied; // transactions added to a balance
+   long rejected; // of accounts not in the file, or overflowing
+   int accounts; // accounts whose balance changed
+   bool checksumsMissing; // applied, but credit.crc was not replaced
+}; // end struct ReplayResult
+
+// read a feed of "account amount" lines, one transaction a line,
+// with amounts in dollars of at most two decimals. false with the
+// reason in the string if the feed cannot be read or a line is not
+// an account and an amount
+bool readFeed( const string &, vector< Transaction > &, string & );
+
+// apply a feed to a records file of either organization. the feed
+// is sorted by account and every transaction is added to its
+// balance in cents, as updateRecord() would. the records are
+// copied in slot order to a new file that is renamed over the old
+// one, so either the whole feed is applied or none of it. the
+// writer lock of the file (see lockCreditFile) is held throughout,
+// so no update of another program is lost to the new file.
+// transactions of accounts not in the file, and those that would
+// take a balance out of the range of int64_t cents, are written to
+// the stream as feed lines and not applied. a feed applied whose
+// new checksums could not be put in place leaves the file without
+// credit.crc and is reported in checksumsMissing
+bool replayFeed( const string &, vector< Transaction > &, ostream &,
+   ReplayResult &, string & );
+
+#endif
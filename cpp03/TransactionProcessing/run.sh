@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+
+[ -z "$BUILD_DIR" ] && BUILD_DIR="../build"
+echo "compiling..."
+mkdir -p $BUILD_DIR
+g++ main.cpp ClientData.cpp AccountFile.cpp Snapshot.cpp AccountCache.cpp \
+    AccountOps.cpp PrintFile.cpp AccountService.cpp -pthread \
+    -o $BUILD_DIR/TransactionProcessing
+g++ AccountServer.cpp AccountService.cpp AccountOps.cpp ClientData.cpp \
+    AccountFile.cpp Snapshot.cpp AccountCache.cpp PrintFile.cpp -pthread \
+    -o $BUILD_DIR/AccountServer
+g++ AccountClient.cpp AccountService.cpp AccountOps.cpp ClientData.cpp \
+    AccountFile.cpp Snapshot.cpp AccountCache.cpp PrintFile.cpp -pthread \
+    -o $BUILD_DIR/AccountClient
+g++ HashRAFile.cpp ClientData.cpp AccountFile.cpp Snapshot.cpp \
+    -o $BUILD_DIR/HashRAFile
+g++ PrintBench.cpp ClientData.cpp AccountFile.cpp Snapshot.cpp \
+    PrintFile.cpp -pthread \
+    -o $BUILD_DIR/PrintBench
+g++ ReplayFeed.cpp TransactionFeed.cpp ClientData.cpp AccountFile.cpp \
+    Snapshot.cpp AccountService.cpp AccountOps.cpp AccountCache.cpp \
+    PrintFile.cpp -pthread \
+    -o $BUILD_DIR/ReplayFeed
+g++ CentsRAFile.cpp ClientData.cpp AccountFile.cpp Snapshot.cpp \
+    -o $BUILD_DIR/CentsRAFile
+g++ -O2 LedgerTotals.cpp Ledger.cpp ClientData.cpp AccountFile.cpp \
+    Snapshot.cpp -o $BUILD_DIR/LedgerTotals
+g++ OpBench.cpp AccountOps.cpp ClientData.cpp AccountFile.cpp Snapshot.cpp \
+    AccountCache.cpp PrintFile.cpp -pthread \
+    -o $BUILD_DIR/OpBench
+
+# the programs work on credit.dat in the current directory
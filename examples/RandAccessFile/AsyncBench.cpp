@@ -0,0 +1,122 @@
+// compare random record lookups one at a time with lookups
+// kept in flight on io_uring and on a pool of reader threads
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "record.h"
+#include "fileheader.h"
+#include "lock.h"
+#include "async.h"
+using namespace std;
+
+// seconds since the epoch, with microseconds
+double now()
+{
+    timeval time;
+    gettimeofday( &time, 0 );
+    return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+// drop the cached pages of a file, so reads go to the device
+void dropCache( const char *fileName )
+{
+    int fd = open( fileName, O_RDONLY );
+    if( fd >= 0 )
+    {
+        posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+        close( fd );
+    }
+} // end function dropCache
+
+int main( int argc, char *argv[] )
+{
+    int lookups = ( argc > 1 ? atoi( argv[1] ) : 100000 );
+    int depth = ( argc > 2 ? atoi( argv[2] ) : 32 );
+
+    // open file for reading binary data
+    fstream fin( "students.bin", ios::in | ios::binary );
+    if( !fin )
+    {
+        cerr << "error: openning file for input failed!" << endl;
+        exit(1);
+    }
+    // the header must describe records of this program
+    string reason;
+    if( !checkRecordFile( fin, reason ) )
+    {
+        cerr << "error: " << reason << "!" << endl;
+        exit(1);
+    }
+    // readers take the same locks as the other tools
+    AsyncReader ring, pool;
+    if( !recordLocks.open( "students.bin" )
+        || !ring.open( "students.bin", depth )
+        || !pool.open( "students.bin", depth, false ) )
+    {
+        cerr << "error: openning file for locking or reading failed!" << endl;
+        exit(1);
+    }
+
+    int recordCount = getRecordCount( fin );
+    if( recordCount < 1 || lookups < 1 )
+    {
+        cerr << "error: no records to look up!" << endl;
+        exit(1);
+    }
+
+    // the same random record numbers for both runs
+    vector< int > recordNumbers( lookups );
+    srand( 1 );
+    for( int i = 0; i < lookups; i++ )
+        recordNumbers[i] = 1 + static_cast< int >(
+                rand() / ( RAND_MAX + 1.0 ) * recordCount );
+
+    // one read at a time
+    vector< Student > blocking( lookups );
+    dropCache( "students.bin" );
+    double start = now();
+    for( int i = 0; i < lookups; i++ )
+        blocking[i] = readRecord( fin, recordNumbers[i] );
+    double blockingSeconds = now() - start;
+
+    // all reads submitted at once, on the ring
+    // (or on threads where io_uring is missing) and on threads
+    vector< Student > async( lookups );
+    dropCache( "students.bin" );
+    start = now();
+    readRecordsAsync( fin, ring, &recordNumbers[0], lookups, &async[0] );
+    double ringSeconds = now() - start;
+    bool same = memcmp( &blocking[0], &async[0],
+                        lookups * sizeof( Student ) ) == 0;
+
+    dropCache( "students.bin" );
+    start = now();
+    readRecordsAsync( fin, pool, &recordNumbers[0], lookups, &async[0] );
+    double poolSeconds = now() - start;
+    same = same && memcmp( &blocking[0], &async[0],
+                           lookups * sizeof( Student ) ) == 0;
+
+    cout << fixed << setprecision(0)
+        << lookups << " random lookup(s) in " << recordCount
+        << " record(s), cold cache, " << depth << " in flight\n"
+        << "blocking     : " << setw(10) << lookups / blockingSeconds
+        << " lookups/s\n"
+        << ( ring.usesRing() ? "io_uring     : " : "(no io_uring): " )
+        << setw(10) << lookups / ringSeconds << " lookups/s, "
+        << setprecision(1) << blockingSeconds / ringSeconds << "x\n"
+        << setprecision(0)
+        << "threads      : " << setw(10) << lookups / poolSeconds
+        << " lookups/s, " << setprecision(1)
+        << blockingSeconds / poolSeconds << "x\n"
+        << "results      : " << ( same ? "match" : "DIFFER" ) << endl;
+
+    ring.close();
+    pool.close();
+    return same ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+// run a stream of search/find/update/insert/delete commands
+// against a random access (binary) file without prompts
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <sys/time.h>
+#include "record.h"
+#include "fileheader.h"
+#include "index.h"
+#include "freemap.h"
+#include "wal.h"
+#include "lock.h"
+#include "pool.h"
+using namespace std;
+
+// writes committed with one log fsync
+const int COMMIT_EVERY = 1000;
+
+// latency counters of one kind of operation
+struct OpStats
+{
+    OpStats() : count(0), failed(0), total(0.0), worst(0.0) {}
+    long count;
+    long failed;
+    double total;  // seconds
+    double worst;  // seconds
+};
+
+// seconds since the epoch, with microseconds
+double now()
+{
+    timeval time;
+    gettimeofday( &time, 0 );
+    return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+// commit the writes of the open batch and begin the next one
+void commitBatch( fstream &fio, map< string, OpStats > &stats )
+{
+    double begin = now();
+    writeLog.commitBatch( fio );
+    writeLog.beginBatch();
+    OpStats &commitStats = stats[ "(commit)" ];
+    ++commitStats.count;
+    commitStats.total += now() - begin;
+    commitStats.worst = max( commitStats.worst, now() - begin );
+} // end function commitBatch
+
+// rest of a command line after the fields already read
+string restOfLine( istringstream &fields )
+{
+    string rest;
+    getline( fields >> ws, rest );
+    return rest;
+} // end function restOfLine
+
+// write a record as a tab separated result line
+void printResult( ostream &output, const string &op, int recordNumber,
+                  const Student &rec )
+{
+    output << "ok\t" << op << '\t' << recordNumber << '\t'
+        << rec.getName() << '\t' << rec.getScore() << '\n';
+} // end function printResult
+
+// write a failed command as a result line
+void printError( ostream &output, const string &line, const string &reason )
+{
+    output << "error\t" << line << '\t' << reason << '\n';
+} // end function printError
+
+// run one command, return false if it failed
+bool runCommand( fstream &fio, const string &line, const string &op,
+                 istringstream &fields, ostream &output )
+{
+    int recordCount = freeSlots.getRecordCount();
+    int recordNumber = 0;
+    float score = 0.0;
+
+    if( op == "search" )
+    {
+        if( !( fields >> recordNumber )
+            || recordNumber < 1 || recordNumber > recordCount )
+        {
+            printError( output, line, "no such record" );
+            return false;
+        }
+        Student rec = readRecord( fio, recordNumber );
+        if( isDeletedRecord( rec ) )
+        {
+            printError( output, line, "deleted record" );
+            return false;
+        }
+        printResult( output, op, recordNumber, rec );
+    }
+    else if( op == "find" )
+    {
+        vector< int > matches = findByName( restOfLine( fields ) );
+        if( matches.empty() )
+        {
+            printError( output, line, "no such name" );
+            return false;
+        }
+        for( size_t i = 0; i < matches.size(); i++ )
+            printResult( output, op, matches[i], readRecord( fio, matches[i] ) );
+    }
+    else if( op == "range" || op == "top" )
+    {
+        float low = 0.0, high = 0.0;
+        int count = 0;
+        if( op == "range" ? !( fields >> low >> high ) || low > high
+                          : !( fields >> count ) || count < 1 )
+        {
+            printError( output, line,
+                        op == "range" ? "expected: low high" : "expected: count" );
+            return false;
+        }
+        // only the records in the result are read
+        vector< int > matches = ( op == "range" ? findByScore( low, high )
+                                                : topScores( count ) );
+        for( size_t i = 0; i < matches.size(); i++ )
+            printResult( output, op, matches[i], readRecord( fio, matches[i] ) );
+    }
+    else if( op == "update" || op == "insert" )
+    {
+        if( op == "update"
+            && ( !( fields >> recordNumber )
+                 || recordNumber < 1 || recordNumber > recordCount ) )
+        {
+            printError( output, line, "no such record" );
+            return false;
+        }
+        string name;
+        if( !( fields >> score ) || score < 0.0 || score > 100.0
+            || ( name = restOfLine( fields ) ).size() < 3 )
+        {
+            printError( output, line, "expected: score name" );
+            return false;
+        }
+
+        Student rec( recordNumber, name, score );
+        if( op == "update" )
+        {
+            if( !writeRecord( fio, recordNumber, rec ) )
+                recordNumber = 0;
+        }
+        else
+        {
+            recordNumber = insertRecord( fio, rec );
+            rec.setID( recordNumber );
+        }
+        if( recordNumber == 0 )
+        {
+            printError( output, line, "write failed" );
+            return false;
+        }
+        printResult( output, op, recordNumber, rec );
+    }
+    else if( op == "delete" )
+    {
+        if( !( fields >> recordNumber )
+            || recordNumber < 1 || recordNumber > recordCount )
+        {
+            printError( output, line, "no such record" );
+            return false;
+        }
+        if( isDeletedRecord( readRecord( fio, recordNumber ) ) )
+        {
+            printError( output, line, "deleted record" );
+            return false;
+        }
+        if( !writeRecord( fio, recordNumber, Student() ) )
+        {
+            printError( output, line, "write failed" );
+            return false;
+        }
+        output << "ok\t" << op << '\t' << recordNumber << '\n';
+    }
+    else
+    {
+        printError( output, line, "unknown command" );
+        return false;
+    }
+
+    return true;
+} // end function runCommand
+
+int main( int argc, char *argv[] )
+{
+    // commands from a file or standard input
+    ifstream commandFile;
+    if( argc > 1 && string( argv[1] ) != "-" )
+    {
+        commandFile.open( argv[1] );
+        if( !commandFile )
+        {
+            cerr << "error: openning command file failed!" << endl;
+            exit(1);
+        }
+    }
+    istream &commands = ( commandFile.is_open() ? commandFile : cin );
+
+    // open file to read and write binary data
+    fstream fio( "students.bin", ios::in | ios::out | ios::binary );
+    if( !fio )
+    {
+        cerr << "error: openning file failed!" << endl;
+        exit(1);
+    }
+    // the header must describe records of this program
+    string reason;
+    if( !checkRecordFile( fio, reason ) )
+    {
+        cerr << "error: " << reason << "!" << endl;
+        exit(1);
+    }
+    // other processes may use the file at the same time
+    if( !recordLocks.open( "students.bin" ) )
+    {
+        cerr << "error: openning file for locking failed!" << endl;
+        exit(1);
+    }
+    // a batch keeps its cache for the whole run, 16 MiB in all
+    bufferPool.resize( fio, 4096 );
+    if( !ensureNameIndex( fio ) || !ensureScoreIndex( fio )
+        || !freeSlots.load( fio ) || !writeLog.open( fio, "students.bin" ) )
+    {
+        cerr << "error: openning the indexes, free-slot map or log failed!"
+            << endl;
+        exit(1);
+    }
+
+    // results are collected and written out in bulk
+    ostringstream results;
+    results << fixed << setprecision(2);
+    map< string, OpStats > stats;
+    string line, op;
+    long operations = 0;
+    double start = now();
+
+    writeLog.beginBatch();
+    while( getline( commands, line ) )
+    {
+        istringstream fields( line );
+        if( !( fields >> op ) || op[0] == '#' )
+            continue;  // skip blank and comment lines
+
+        // the indexes only hold committed writes, so a lookup in them
+        // commits the writes of the batch first
+        if( ( op == "find" || op == "range" || op == "top" )
+            && writeLog.pendingCount() > 0 )
+        {
+            commitBatch( fio, stats );
+        }
+
+        double begin = now();
+        bool done = runCommand( fio, line, op, fields, results );
+        double elapsed = now() - begin;
+
+        OpStats &opStats = stats[ op ];
+        ++opStats.count;
+        opStats.failed += !done;
+        opStats.total += elapsed;
+        opStats.worst = max( opStats.worst, elapsed );
+
+        // bound the writes held in memory by the batch
+        if( ++operations % COMMIT_EVERY == 0 )
+        {
+            commitBatch( fio, stats );
+        }
+    }
+    bool committed = writeLog.close( fio );
+    double seconds = now() - start;
+
+    // write the results of all commands at once
+    ofstream resultFile;
+    if( argc > 2 && string( argv[2] ) != "-" )
+        resultFile.open( argv[2] );
+    ostream &output = ( resultFile.is_open() ? resultFile : cout );
+    output << results.str() << flush;
+
+    // report latency per operation and total throughput
+    cerr << fixed << setprecision(1)
+        << setw(10) << "operation" << setw(10) << "count"
+        << setw(10) << "failed" << setw(14) << "mean (us)"
+        << setw(14) << "max (us)" << '\n';
+    for( map< string, OpStats >::const_iterator it = stats.begin();
+         it != stats.end(); ++it )
+    {
+        cerr << setw(10) << it->first << setw(10) << it->second.count
+            << setw(10) << it->second.failed
+            << setw(14) << 1e6 * it->second.total / it->second.count
+            << setw(14) << 1e6 * it->second.worst << '\n';
+    }
+    cerr << operations << " operation(s) in " << seconds << " s, "
+        << setprecision(0) << ( seconds > 0 ? operations / seconds : 0.0 )
+        << " ops/s" << endl;
+    bufferPool.printStats( cerr );
+
+    if( !committed )
+    {
+        cerr << "error: writing to the file failed!" << endl;
+        fio.close();
+        return 1;
+    }
+    fio.close();
+    return 0;
+} // end main
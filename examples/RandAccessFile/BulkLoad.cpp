@@ -0,0 +1,269 @@
+// load a delimited text file of students into a new random access file
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "record.h"
+#include "fileheader.h"
+#include "index.h"
+#include "freemap.h"
+#include "wal.h"
+#include "checksum.h"
+using namespace std;
+
+// bytes per write to the records file (a multiple of the page size).
+// every write but the last fills the buffer, so each starts at an
+// offset that is a multiple of it and covers whole pages
+const size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+// a part of the input parsed by one thread
+struct ParseJob
+{
+    const char *begin;        // first byte of the part
+    const char *end;          // one past the last byte
+    char delimiter;           // field separator
+    vector< Student > records;
+    int skipped;              // lines that could not be parsed
+};
+
+// parse a score of the form digits[.digits]
+bool parseScore( const char *first, const char *last, float &score )
+{
+    double value = 0.0, scale = 1.0;
+    bool digits = false, fraction = false;
+
+    for( ; first < last; ++first )
+    {
+        if( *first >= '0' && *first <= '9' )
+        {
+            digits = true;
+            if( fraction )
+            {
+                scale /= 10.0;
+                value += ( *first - '0' ) * scale;
+            }
+            else
+            {
+                value = value * 10.0 + ( *first - '0' );
+            }
+        }
+        else if( *first == '.' && !fraction )
+            fraction = true;
+        else if( *first != ' ' && *first != '\r' )
+            return false;
+    }
+
+    score = static_cast< float >( value );
+    return digits && value <= 100.0;
+} // end function parseScore
+
+// parse the lines "name<delimiter>score" of a part of the input
+void *parseLines( void *argument )
+{
+    ParseJob *job = static_cast< ParseJob * >( argument );
+    const char *line = job->begin;
+
+    while( line < job->end )
+    {
+        const char *lineEnd = static_cast< const char * >(
+                memchr( line, '\n', job->end - line ) );
+        if( lineEnd == 0 )
+            lineEnd = job->end;
+
+        const char *separator = static_cast< const char * >(
+                memchr( line, job->delimiter, lineEnd - line ) );
+        float score;
+        if( separator != 0 && separator > line
+            && parseScore( separator + 1, lineEnd, score ) )
+        {
+            // record ids are set once all parts are counted
+            job->records.push_back(
+                Student( 0, string( line, separator ), score ) );
+        }
+        else if( lineEnd > line )
+        {
+            ++job->skipped;
+        }
+        line = lineEnd + 1;
+    }
+
+    return 0;
+} // end function parseLines
+
+// seconds since the epoch, with microseconds
+double now()
+{
+    timeval time;
+    gettimeofday( &time, 0 );
+    return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+int main( int argc, char *argv[] )
+{
+    if( argc < 2 )
+    {
+        cerr << "usage: " << argv[0] << " input-file [delimiter] [threads]\n"
+            << "each line of the input is: name<delimiter>score" << endl;
+        exit(1);
+    }
+
+    char delimiter = ( argc > 2 ? argv[2][0] : ',' );
+    int threadCount = ( argc > 3 ? atoi( argv[3] )
+                                 : sysconf( _SC_NPROCESSORS_ONLN ) );
+    if( threadCount < 1 )
+        threadCount = 1;
+
+    double start = now();
+
+    // map the input file for the parsing threads
+    int inputFd = open( argv[1], O_RDONLY );
+    struct stat info;
+    if( inputFd < 0 || fstat( inputFd, &info ) < 0 )
+    {
+        cerr << "error: openning file for input failed!" << endl;
+        exit(1);
+    }
+    size_t inputSize = info.st_size;
+    const char *input = 0;
+    if( inputSize > 0 )
+    {
+        void *map = mmap( 0, inputSize, PROT_READ, MAP_PRIVATE, inputFd, 0 );
+        if( map == MAP_FAILED )
+        {
+            cerr << "error: mapping the input file failed!" << endl;
+            exit(1);
+        }
+        madvise( map, inputSize, MADV_SEQUENTIAL );
+        input = static_cast< const char * >( map );
+    }
+
+    // split the input into parts at line boundaries
+    vector< ParseJob > jobs( threadCount );
+    const char *partBegin = input;
+    for( int i = 0; i < threadCount; i++ )
+    {
+        const char *partEnd = input + inputSize * ( i + 1 ) / threadCount;
+        // move the end past the line it falls in
+        while( partEnd < input + inputSize && partEnd > partBegin
+               && partEnd[-1] != '\n' )
+            ++partEnd;
+        if( partEnd < partBegin )
+            partEnd = partBegin;
+
+        jobs[i].begin = partBegin;
+        jobs[i].end = partEnd;
+        jobs[i].delimiter = delimiter;
+        jobs[i].skipped = 0;
+        partBegin = partEnd;
+    }
+
+    // parse all parts at the same time
+    vector< pthread_t > threads( threadCount );
+    for( int i = 0; i < threadCount; i++ )
+        pthread_create( &threads[i], 0, parseLines, &jobs[i] );
+
+    // write a new file, renamed over the old one when complete
+    const string tempName = "students.bin.tmp";
+    int outputFd = open( tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    void *buffer = 0;
+    if( outputFd < 0 || posix_memalign( &buffer, 4096, WRITE_BUFFER_SIZE ) != 0 )
+    {
+        cerr << "error: open file for output failed!" << endl;
+        exit(1);
+    }
+    char *staging = static_cast< char * >( buffer );
+    // the header goes first, its record count is set at the end
+    FileHeader header = makeFileHeader( 0 );
+    memcpy( staging, &header, sizeof( FileHeader ) );
+    size_t staged = sizeof( FileHeader );
+    bool written = true;
+
+    // write each part as soon as it is parsed, in input order
+    int recordCount = 0, skipped = 0;
+    for( int i = 0; i < threadCount; i++ )
+    {
+        pthread_join( threads[i], 0 );
+        skipped += jobs[i].skipped;
+
+        vector< Student > &records = jobs[i].records;
+        for( size_t r = 0; r < records.size(); r++ )
+        {
+            records[r].setID( ++recordCount );
+            // a record that does not fit is split between two buffers
+            const char *bytes = reinterpret_cast< const char * >( &records[r] );
+            size_t left = sizeof( Student );
+            while( left > 0 )
+            {
+                size_t part = min( left, WRITE_BUFFER_SIZE - staged );
+                memcpy( staging + staged, bytes, part );
+                staged += part;
+                bytes += part;
+                left -= part;
+                // one large write per full buffer
+                if( staged == WRITE_BUFFER_SIZE )
+                {
+                    written = write( outputFd, staging, staged )
+                                  == static_cast< ssize_t >( staged )
+                              && written;
+                    staged = 0;
+                }
+            }
+        }
+        vector< Student >().swap( records );  // release the part
+    }
+    if( staged > 0 )
+    {
+        written = write( outputFd, staging, staged )
+                      == static_cast< ssize_t >( staged ) && written;
+    }
+    header.recordCount = recordCount;
+    written = pwrite( outputFd, &header, sizeof( FileHeader ), 0 )
+                  == static_cast< ssize_t >( sizeof( FileHeader ) ) && written;
+    written = fsync( outputFd ) == 0 && written;
+    close( outputFd );
+    free( buffer );
+    if( input != 0 )
+        munmap( const_cast< char * >( input ), inputSize );
+    close( inputFd );
+
+    if( !written || rename( tempName.c_str(), "students.bin" ) != 0 )
+    {
+        cerr << "error: writing to the file failed!" << endl;
+        unlink( tempName.c_str() );
+        exit(1);
+    }
+    double loaded = now();
+
+    // files kept next to the old records are rebuilt for the new ones
+    remove( LOG_FILE );
+    remove( FREE_MAP_FILE );
+    fstream fin( "students.bin", ios::in | ios::binary );
+    if( !buildNameIndex( fin ) || !buildScoreIndex( fin )
+        || !buildChecksums( fin ) || !freeSlots.load( fin ) )
+    {
+        cerr << "error: indexing the new file failed!" << endl;
+        exit(1);
+    }
+    double indexed = now();
+
+    cout << fixed << setprecision(2)
+        << "Loaded " << recordCount << " record(s) with " << threadCount
+        << " thread(s), skipped " << skipped << " invalid line(s)\n"
+        << "load : " << setw(8) << loaded - start << " s, "
+        << setprecision(0) << recordCount / ( loaded - start )
+        << " records/s\n" << setprecision(2)
+        << "index: " << setw(8) << indexed - loaded << " s" << endl;
+
+    return 0;
+} // end main
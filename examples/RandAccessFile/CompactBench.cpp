@@ -0,0 +1,115 @@
+// compare the size and scan speed of the fixed record file
+// with its compact copy (numeric columns and a name heap)
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "record.h"
+#include "store.h"
+#include "compact.h"
+#include "columns.h"
+using namespace std;
+
+// seconds since the epoch, with microseconds
+double now()
+{
+    timeval time;
+    gettimeofday( &time, 0 );
+    return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+// size of a file in bytes, 0 if it does not exist
+long long fileSize( const char *fileName )
+{
+    struct stat info;
+    return stat( fileName, &info ) == 0 ? info.st_size : 0;
+} // end function fileSize
+
+// print a row of the comparison
+void printRow( const string &format, long long bytes, int records,
+               double scoreSeconds, double recordSeconds )
+{
+    cout << setw(10) << format << setw(14) << bytes
+        << setw(10) << ( records > 0 ? double( bytes ) / records : 0.0 )
+        << setw(16) << records / scoreSeconds / 1e6
+        << setw(16) << records / recordSeconds / 1e6 << endl;
+} // end function printRow
+
+int main( int argc, char *argv[] )
+{
+    // full scans per measurement, the fastest one is reported
+    int passes = ( argc > 1 ? atoi( argv[1] ) : 5 );
+    if( passes < 1 )
+        passes = 1;
+
+    // map the file into memory for reading
+    StudentStore store( "students.bin" );
+    if( !store.isOpen() )
+    {
+        cerr << "error: openning file for input failed!" << endl;
+        exit(1);
+    }
+    // write the compact copy and map it
+    CompactStore compact;
+    if( !writeCompactFile( store, COMPACT_FILE ) || !compact.open( COMPACT_FILE ) )
+    {
+        cerr << "error: writing the compact file failed!" << endl;
+        exit(1);
+    }
+
+    int recordCount = store.getRecordCount();
+    double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+    double checksum = 0.0;  // keeps the scans from being optimized out
+
+    for( int pass = 0; pass < passes; pass++ )
+    {
+        // scores only: fixed records are read whole
+        double start = now();
+        double sum = 0.0;
+        for( StudentStore::const_iterator rec = store.begin();
+             rec != store.end(); ++rec )
+            sum += rec->getScore();
+        best[0] = min( best[0], now() - start );
+        checksum += sum;
+
+        // scores only: the compact file has a score column
+        start = now();
+        checksum += sumScores( compact.scores(), compact.getRecordCount() );
+        best[1] = min( best[1], now() - start );
+
+        // whole records, names included
+        start = now();
+        size_t nameBytes = 0;
+        for( StudentStore::const_iterator rec = store.begin();
+             rec != store.end(); ++rec )
+            nameBytes += rec->getName().size() + rec->getID();
+        best[2] = min( best[2], now() - start );
+        checksum += nameBytes;
+
+        start = now();
+        nameBytes = 0;
+        for( int recordNumber = 1; recordNumber <= recordCount; recordNumber++ )
+            nameBytes += compact.getName( recordNumber ).size()
+                         + compact.getID( recordNumber );
+        best[3] = min( best[3], now() - start );
+        checksum -= nameBytes;
+    }
+
+    cout << fixed << setprecision(1)
+        << recordCount << " record(s), best of " << passes
+        << " scan(s) with a warm cache\n"
+        << setw(10) << "format" << setw(14) << "file (bytes)"
+        << setw(10) << "B/record" << setw(16) << "scores (M/s)"
+        << setw(16) << "records (M/s)" << '\n';
+    printRow( "fixed", fileSize( "students.bin" ), recordCount,
+              best[0], best[2] );
+    printRow( "compact", fileSize( COMPACT_FILE ), recordCount,
+              best[1], best[3] );
+    cout << setprecision(0) << "compact file is "
+        << 100.0 * fileSize( COMPACT_FILE ) / fileSize( "students.bin" )
+        << "% of the fixed file (checksum " << checksum << ")" << endl;
+
+    return 0;
+}
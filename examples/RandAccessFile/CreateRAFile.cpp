@@ -2,14 +2,21 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cstdio>
 #include <string>
 #include "record.h"
+#include "fileheader.h"
+#include "index.h"
+#include "freemap.h"
+#include "wal.h"
+#include "checksum.h"
 using namespace std;
 
 int main()
 {
     // open file for writing binary data
-    ofstream fout( "students.bin", ios::out | ios::binary );
+    fstream fout( "students.bin",
+                  ios::in | ios::out | ios::trunc | ios::binary );
     // handle error
     if( !fout )
     {
@@ -17,6 +24,11 @@ int main()
         exit(1);
     }
 
+    // a log left by the old file must not be replayed on the new one
+    remove( LOG_FILE );
+    // nor the checksums of the old records checked against the new
+    remove( CHECKSUM_FILE );
+
     const int recordCount = 5;
     // initialize records
     Student studentRecords[recordCount] = {
@@ -29,13 +41,40 @@ int main()
         { 5, "Usaid Azhar",  87.67 }
     };
 
-    for( size_t index = 0; index < recordCount; index++ )
+    // the header describes the records, none are counted yet
+    if( !writeFileHeader( fout, 0 ) )
+    {
+        cerr << "error: writing to the file failed!" << endl;
+        exit(1);
+    }
+
+    // write all records as one array of byte sized data
+    if( !writeRecords( fout, 1, recordCount, studentRecords ) )
+    {
+        cerr << "error: writing to the file failed!" << endl;
+        exit(1);
+    }
+
+    // index the new records by name and by score
+    if( !buildNameIndex( fout ) || !buildScoreIndex( fout ) )
     {
-        // write a record as array of byte sized data
-        fout.write(
-                reinterpret_cast< char * >( &studentRecords[index] ),
-                sizeof( Student )  // size of record to be written
-            );
+        cerr << "error: creating the indexes failed!" << endl;
+        exit(1);
+    }
+
+    // checksum the new records, checked each time they are read
+    if( !buildChecksums( fout ) )
+    {
+        cerr << "error: creating the checksum file failed!" << endl;
+        exit(1);
+    }
+
+    // map the free slots of the new file
+    remove( FREE_MAP_FILE );
+    if( !freeSlots.load( fout ) )
+    {
+        cerr << "error: creating the free-slot map failed!" << endl;
+        exit(1);
     }
 
     fout.close();  // close file
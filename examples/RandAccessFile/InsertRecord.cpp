@@ -0,0 +1,96 @@
+// insert a new record in a random access (binary) file
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include "inputs.h"
+#include "record.h"
+#include "fileheader.h"
+#include "lock.h"
+#include "pool.h"
+#include "freemap.h"
+#include "wal.h"
+using namespace std;
+
+int main()
+{
+    int recordNumber = 0;
+    char choice = 0;
+    Student rec;
+
+    // open file to read and write binary data
+    fstream fio( "students.bin", ios::in | ios::out | ios::binary );
+
+    // handle error
+    if( !fio )
+    {
+        cerr << "error: openning file failed!" << endl;
+        exit(1);
+    }
+    // the header must describe records of this program
+    string reason;
+    if( !checkRecordFile( fio, reason ) )
+    {
+        cerr << "error: " << reason << "!" << endl;
+        exit(1);
+    }
+    // other processes may use the file at the same time,
+    // take byte-range locks on the records
+    if( !recordLocks.open( "students.bin" ) )
+    {
+        cerr << "error: openning file for locking failed!" << endl;
+        exit(1);
+    }
+    // cache pages of records, 1 MiB in all
+    bufferPool.resize( fio, 256 );
+
+    // the free-slot map picks the slot for each new record
+    if( !freeSlots.load( fio ) )
+    {
+        cerr << "error: openning the free-slot map failed!" << endl;
+        exit(1);
+    }
+    // writes go through the log, replaying any left by a crash
+    if( !writeLog.open( fio, "students.bin" ) )
+    {
+        cerr << "error: recovering from the write-ahead log failed!" << endl;
+        exit(1);
+    }
+
+    do
+    {
+        // see the records written by other processes
+        bufferPool.invalidate( fio );
+        cout << "Total " << freeSlots.getRecordCount()
+            << " record slot(s) in the file.\n"
+            << "To insert a record" << endl;
+        // read the new record from the user
+        inputRecord( rec );
+
+        // write the record in a free slot
+        recordNumber = insertRecord( fio, rec );
+        if( recordNumber != 0 )
+        {
+            cout << "Record inserted at #" << recordNumber << ":\n";
+            printRecordHeader();
+            // print inserted record
+            readRecord( fio, recordNumber ).print();
+        }
+        else
+        {
+            cerr << "error: writing to the file failed!" << endl;
+        }
+
+        cout << endl;
+        // ask a yes/no question
+        choice = askYesNo( string( "Insert another record?" ) );
+    }while( choice == 'y' || choice == 'Y' );
+
+    // make the writes durable and close the file
+    if( !writeLog.close( fio ) )
+    {
+        cerr << "error: writing to the file failed!" << endl;
+    }
+    fio.close();
+    return 0;
+} // end main
@@ -5,12 +5,14 @@
 #include <cstdlib>
 #include <string>
 #include "record.h"
+#include "fileheader.h"
+#include "store.h"
+#include "freemap.h"
 using namespace std;
 
 int main()
 {
-    int recordCount = 0;
-    // open file for reading binary data
+    // open file for reading the free-slot map
     fstream fin( "students.bin", ios::in | ios::binary );
     // handle error
     if( !fin )
@@ -18,21 +20,42 @@ int main()
         cerr << "error: openning file for input failed!" << endl;
         exit(1);
     }
+    // the header must describe records of this program
+    string reason;
+    if( !checkRecordFile( fin, reason ) )
+    {
+        cerr << "error: " << reason << "!" << endl;
+        exit(1);
+    }
+    // map the file into memory for reading
+    StudentStore store( "students.bin" );
+    if( !store.isOpen() )
+    {
+        cerr << "error: mapping file for input failed!" << endl;
+        exit(1);
+    }
+    // deleted slots are skipped by the free-slot map
+    if( !freeSlots.load( fin ) )
+    {
+        cerr << "error: openning the free-slot map failed!" << endl;
+        exit(1);
+    }
 
-    recordCount = getRecordCount( fin );
+    int recordCount = store.getRecordCount();
     cout << "Reading " << recordCount << " record(s)..." << endl;
 
     // print record header
     printRecordHeader();
-    for( int recordNumber = 1; recordNumber <= recordCount; recordNumber++ )
+    // scan the records in place, no copy per record, skipping
+    // runs of deleted records without reading them
+    for( int recordNumber = freeSlots.nextUsed( 1 );
+         recordNumber <= recordCount;
+         recordNumber = freeSlots.nextUsed( recordNumber + 1 ) )
     {
-        Student rec = readRecord( fin, recordNumber );
-        if( ! isDeletedRecord( rec ) )
-            rec.print();
-
+        store[ recordNumber ].print();
     }
 
-    // close the file
+    // close the file, store is unmapped when it goes out of scope
     fin.close();
     return 0;
 }
@@ -0,0 +1,52 @@
+// print score statistics of the records in a random access file
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include "record.h"
+#include "store.h"
+#include "columns.h"
+using namespace std;
+
+int main()
+{
+    const int binCount = 10;  // histogram bins of 10 points
+    int bins[ binCount ];
+
+    // map the file into memory for reading
+    StudentStore store( "students.bin" );
+    // handle error
+    if( !store.isOpen() )
+    {
+        // a missing file, or one without a valid records header
+        cerr << "error: openning file for input failed!" << endl;
+        exit(1);
+    }
+
+    // copy the records into one array per field
+    StudentColumns columns;
+    columns.load( store );
+    const float *scores = columns.scores.empty() ? 0 : &columns.scores[0];
+    int count = columns.size();
+
+    cout << fixed << setprecision(2)
+        << "Records : " << count << '\n'
+        << "Average : "
+        << ( count > 0 ? sumScores( scores, count ) / count : 0.0 ) << '\n'
+        << "Minimum : " << minScore( scores, count ) << '\n'
+        << "Maximum : " << maxScore( scores, count ) << '\n'
+        << "Median  : " << scorePercentile( scores, count, 50 ) << '\n'
+        << "90th pct: " << scorePercentile( scores, count, 90 ) << '\n'
+        << "99th pct: " << scorePercentile( scores, count, 99 ) << "\n\n";
+
+    // print the score distribution
+    scoreHistogram( scores, count, bins, binCount );
+    cout << setw(10) << "Scores" << setw(10) << "Count" << endl;
+    for( int bin = 0; bin < binCount; bin++ )
+    {
+        cout << setw(4) << bin * 100 / binCount << " - "
+            << setw(3) << ( bin + 1 ) * 100 / binCount
+            << setw(10) << bins[ bin ] << endl;
+    }
+
+    return 0;
+} // end main
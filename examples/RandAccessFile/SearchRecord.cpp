@@ -3,8 +3,15 @@
 #include <iomanip>
 #include <fstream>
 #include <cstdlib>
+#include <vector>
+#include <sys/stat.h>
 #include "inputs.h"
 #include "record.h"
+#include "fileheader.h"
+#include "lock.h"
+#include "pool.h"
+#include "index.h"
+#include "checksum.h"
 using namespace std;
 
 int main()
@@ -12,7 +19,10 @@ int main()
     int recordCount = 0,
         searchKey = 0;
     char choice = 0;
+    float low, high;
     Student rec;
+    string name;
+    vector< int > matches;
 
     // open file for reading binary data
     fstream fin( "students.bin", ios::in | ios::binary );
@@ -22,32 +32,117 @@ int main()
         cerr << "error: openning file for input failed!" << endl;
         exit(1);
     }
+    // the header must describe records of this program
+    string reason;
+    if( !checkRecordFile( fin, reason ) )
+    {
+        cerr << "error: " << reason << "!" << endl;
+        exit(1);
+    }
+    // other processes may use the file at the same time,
+    // take byte-range locks on the records
+    if( !recordLocks.open( "students.bin" ) )
+    {
+        cerr << "error: openning file for locking failed!" << endl;
+        exit(1);
+    }
+    // cache pages of records, 1 MiB in all
+    bufferPool.resize( fin, 256 );
 
     // get record count
     recordCount = getRecordCount( fin );
+    // name and score lookups go through the indexes
+    // on students.idx and students.sdx
+    if( !ensureNameIndex( fin ) || !ensureScoreIndex( fin ) )
+    {
+        cerr << "error: creating the indexes failed!" << endl;
+        exit(1);
+    }
+
+    // identity of the open file, a vacuum replaces it
+    struct stat opened, current;
+    stat( "students.bin", &opened );
 
     do
     {
+        // see the records written by other processes
+        bufferPool.invalidate( fin );
+        // searches go on against the old file during a vacuum,
+        // the new file is opened once it is in place
+        if( stat( "students.bin", &current ) == 0
+            && current.st_ino != opened.st_ino )
+        {
+            fin.close();
+            fin.clear();
+            fin.open( "students.bin", ios::in | ios::binary );
+            recordLocks.open( "students.bin" );
+            // the new file has checksums of its own
+            recordChecksums.close();
+            opened = current;
+            recordCount = getRecordCount( fin );
+        }
         cout << "\nTotal " << recordCount
             << " record(s) in the file." << endl;
-        // ask for the record number
-        searchKey = getRecordRequest( recordCount );
-        rec = readRecord( fin, searchKey );
-        if( isDeletedRecord( rec ) )
+        // ask for the search key
+        choice = askYesNo( string( "Search by student name?" ) );
+        if( choice == 'y' || choice == 'Y' )
+        {
+            name = getString( "Enter name of the student: ", NAME_LENGTH );
+            // look the name up in the index
+            matches = findByName( name );
+            if( matches.empty() )
+            {
+                cout << "\nNo student named " << name << "!\n" << endl;
+            }
+            else
+            {
+                printRecordHeader();
+                // print all records with the name
+                for( size_t i = 0; i < matches.size(); i++ )
+                    readRecord( fin, matches[i] ).print();
+            }
+        }
+        else if( ( choice = askYesNo( string( "Search by score?" ) ) ) == 'y'
+                 || choice == 'Y' )
         {
-            cout << "\nThe requested record doesn't exist!\n" << endl;
+            low = getFloat( string( "Enter lowest score: " ) );
+            high = getFloat( string( "Enter highest score: " ) );
+            // the index lists the range, highest score first
+            matches = findByScore( low, high );
+            if( matches.empty() )
+            {
+                cout << "\nNo student scored " << low << " to " << high
+                    << "!\n" << endl;
+            }
+            else
+            {
+                printRecordHeader();
+                for( size_t i = 0; i < matches.size(); i++ )
+                    readRecord( fin, matches[i] ).print();
+            }
         }
         else
         {
-            printRecordHeader();
-            // print the record
-            rec.print();
+            // ask for the record number
+            searchKey = getRecordRequest( recordCount );
+            rec = readRecord( fin, searchKey );
+            if( isDeletedRecord( rec ) )
+            {
+                cout << "\nThe requested record doesn't exist!\n" << endl;
+            }
+            else
+            {
+                printRecordHeader();
+                // print the record
+                rec.print();
+            }
         }
         cout << endl;
         // ask a yes/no question
         choice = askYesNo( string( "Search another record?" ) );
     }while( choice == 'y' || choice == 'Y' );
 
+    bufferPool.printStats( cout );
     // close the file
     fin.close();
     return 0;
@@ -5,6 +5,11 @@
 #include <cstdlib>
 #include "inputs.h"
 #include "record.h"
+#include "fileheader.h"
+#include "lock.h"
+#include "pool.h"
+#include "freemap.h"
+#include "wal.h"
 using namespace std;
 
 int main()
@@ -22,11 +27,41 @@ int main()
         cerr << "error: openning file failed!" << endl;
         exit(1);
     }
+    // the header must describe records of this program
+    string reason;
+    if( !checkRecordFile( fio, reason ) )
+    {
+        cerr << "error: " << reason << "!" << endl;
+        exit(1);
+    }
+    // other processes may use the file at the same time,
+    // take byte-range locks on the records
+    if( !recordLocks.open( "students.bin" ) )
+    {
+        cerr << "error: openning file for locking failed!" << endl;
+        exit(1);
+    }
+    // cache pages of records, 1 MiB in all
+    bufferPool.resize( fio, 256 );
 
     // get record count
     recordCount = getRecordCount( fio );
+    // track free slots as records are written
+    if( !freeSlots.load( fio ) )
+    {
+        cerr << "error: openning the free-slot map failed!" << endl;
+        exit(1);
+    }
+    // writes go through the log, replaying any left by a crash
+    if( !writeLog.open( fio, "students.bin" ) )
+    {
+        cerr << "error: recovering from the write-ahead log failed!" << endl;
+        exit(1);
+    }
     do
     {
+        // see the records written by other processes
+        bufferPool.invalidate( fio );
         cout << "Total " << recordCount
             << " record(s) in the file.\n"
             << "To update a record";
@@ -63,7 +98,11 @@ int main()
         cout << endl;
     }while( choice == 'y' || choice == 'Y' );
 
-    // close the file
+    // make the writes durable and close the file
+    if( !writeLog.close( fio ) )
+    {
+        cerr << "error: writing to the file failed!" << endl;
+    }
     fio.close();
     return 0;
 } // end main
@@ -0,0 +1,44 @@
+// add the records header to a random access file written
+// before the file format had one
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include "record.h"
+#include "fileheader.h"
+using namespace std;
+
+int main()
+{
+    // open file for reading binary data
+    fstream fin( "students.bin", ios::in | ios::binary );
+    // handle error
+    if( !fin )
+    {
+        cerr << "error: openning file for input failed!" << endl;
+        exit(1);
+    }
+
+    string reason;
+    if( checkRecordFile( fin, reason ) )
+    {
+        cout << "students.bin is already in format version "
+            << FILE_VERSION << endl;
+        return 0;
+    }
+    fin.close();
+
+    // the records keep their numbers, so the name index, free-slot
+    // map and write-ahead log of the file stay valid
+    if( !upgradeRecordFile( "students.bin" ) )
+    {
+        cerr << "error: students.bin cannot be upgraded, " << reason << "!"
+            << endl;
+        exit(1);
+    }
+
+    fin.open( "students.bin", ios::in | ios::binary );
+    cout << "Upgraded students.bin to format version " << FILE_VERSION
+        << ", " << getRecordCount( fin ) << " record(s)" << endl;
+    return 0;
+}
@@ -0,0 +1,224 @@
+// rewrite a random access file without the slots of deleted
+// records, while readers keep reading the old file
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "record.h"
+#include "fileheader.h"
+#include "index.h"
+#include "freemap.h"
+#include "wal.h"
+#include "lock.h"
+#include "checksum.h"
+using namespace std;
+
+// file name of the record-number remap table of the last vacuum
+const char REMAP_FILE[] = "students.remap";
+// records per read and per write (about 1 MiB)
+const int BATCH_RECORDS = ( 1 << 20 ) / sizeof( Student );
+
+// seconds since the epoch, with microseconds
+double now()
+{
+    timeval time;
+    gettimeofday( &time, 0 );
+    return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+// size of a file in bytes, 0 if it does not exist
+long long fileSize( const char *fileName )
+{
+    struct stat info;
+    return stat( fileName, &info ) == 0 ? info.st_size : 0;
+} // end function fileSize
+
+// rename a file over another and make the rename durable
+bool replaceFile( const string &from, const string &to )
+{
+    if( rename( from.c_str(), to.c_str() ) != 0 )
+    {
+        return false;
+    }
+    int dir = open( ".", O_RDONLY );
+    if( dir >= 0 )
+    {
+        fsync( dir );
+        close( dir );
+    }
+    return true;
+} // end function replaceFile
+
+int main()
+{
+    // open file to read binary data
+    fstream fin( "students.bin", ios::in | ios::out | ios::binary );
+    if( !fin )
+    {
+        cerr << "error: openning file failed!" << endl;
+        exit(1);
+    }
+    // the header must describe records of this program
+    string reason;
+    if( !checkRecordFile( fin, reason ) )
+    {
+        cerr << "error: " << reason << "!" << endl;
+        exit(1);
+    }
+    if( !recordLocks.open( "students.bin" ) )
+    {
+        cerr << "error: openning file for locking failed!" << endl;
+        exit(1);
+    }
+
+    // redo the writes of a crashed session, so the log is empty
+    if( !writeLog.open( fin, "students.bin" ) || !writeLog.close( fin ) )
+    {
+        cerr << "error: replaying the log failed!" << endl;
+        exit(1);
+    }
+
+    // writers hold a shared lock on the file for their session,
+    // wait until none is left and keep new ones out
+    int sessionFd = open( "students.bin", O_RDONLY );
+    if( sessionFd < 0 )
+    {
+        cerr << "error: openning file for locking failed!" << endl;
+        exit(1);
+    }
+    if( flock( sessionFd, LOCK_EX | LOCK_NB ) != 0 )
+    {
+        cout << "Waiting for writers to close students.bin..." << endl;
+        flock( sessionFd, LOCK_EX );
+    }
+    if( fileSize( LOG_FILE ) != 0 )
+    {
+        cerr << "error: a writer left entries in the log, "
+            << "open the file for writing to replay them!" << endl;
+        exit(1);
+    }
+
+    double start = now();
+    int recordCount = getRecordCount( fin );
+
+    // the new file is written next to the old one, readers keep
+    // reading the old file (a snapshot) until they reopen it
+    const string tempName = "students.bin.tmp";
+    int outFd = open( tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    ofstream remap( ( string( REMAP_FILE ) + ".tmp" ).c_str() );
+    if( outFd < 0 || !remap )
+    {
+        cerr << "error: open file for output failed!" << endl;
+        exit(1);
+    }
+    remap << "# old\tnew\n";
+
+    // the header goes first, its record count is set at the end
+    FileHeader header = makeFileHeader( 0 );
+    bool written = write( outFd, &header, sizeof( FileHeader ) )
+                   == static_cast< ssize_t >( sizeof( FileHeader ) );
+
+    // copy the records in use in large sequential reads and writes
+    vector< Student > batch( BATCH_RECORDS ), kept;
+    kept.reserve( BATCH_RECORDS );
+    int keptCount = 0;
+    for( int first = 1; written && first <= recordCount; first += BATCH_RECORDS )
+    {
+        int records = readRecords( fin, first,
+                                   min( BATCH_RECORDS, recordCount - first + 1 ),
+                                   &batch[0] );
+        kept.clear();
+        for( int i = 0; i < records; i++ )
+        {
+            if( isDeletedRecord( batch[i] ) )
+                continue;
+            // record ids follow the new record numbers
+            kept.push_back( batch[i] );
+            kept.back().setID( ++keptCount );
+            remap << first + i << '\t' << keptCount << '\n';
+        }
+        if( !kept.empty() )
+        {
+            ssize_t bytes = kept.size() * sizeof( Student );
+            written = write( outFd, &kept[0], bytes ) == bytes;
+        }
+    }
+
+    header.recordCount = keptCount;
+    written = written
+        && pwrite( outFd, &header, sizeof( FileHeader ), 0 )
+               == static_cast< ssize_t >( sizeof( FileHeader ) )
+        && fsync( outFd ) == 0;
+    close( outFd );
+    remap.close();
+    written = written && !remap.fail();
+    // a damaged record is not carried into the new file with a
+    // checksum that would make it look sound
+    if( recordChecksums.getFailures() > 0 )
+    {
+        cerr << "error: " << recordChecksums.getFailures()
+            << " record(s) fail their checksums, see VerifyRAFile!" << endl;
+        unlink( tempName.c_str() );
+        exit(1);
+    }
+
+    // build the indexes of the new file before any file is swapped
+    fstream fout( tempName.c_str(), ios::in | ios::binary );
+    recordLocks.open( tempName );
+    const string nameIndex = string( NAME_INDEX_FILE ) + ".tmp";
+    const string scoreIndex = string( SCORE_INDEX_FILE ) + ".tmp";
+    // the checksums are optional, kept if the old file had them
+    const string checksums = string( CHECKSUM_FILE ) + ".tmp";
+    bool checksummed = access( CHECKSUM_FILE, F_OK ) == 0;
+    written = written
+        && ( !checksummed || buildChecksums( fout, checksums.c_str() ) );
+    // the records of the new file are checked against their own
+    // checksums, never against those of the old record numbers
+    if( checksummed )
+        recordChecksums.open( checksums.c_str() );
+    else
+        recordChecksums.detach();
+    written = written && buildNameIndex( fout, nameIndex.c_str() )
+        && buildScoreIndex( fout, scoreIndex.c_str() );
+    fout.close();
+
+    // swap the files, the records file last
+    if( !written
+        || !replaceFile( nameIndex, NAME_INDEX_FILE )
+        || !replaceFile( scoreIndex, SCORE_INDEX_FILE )
+        || ( checksummed && !replaceFile( checksums, CHECKSUM_FILE ) )
+        || !replaceFile( string( REMAP_FILE ) + ".tmp", REMAP_FILE )
+        || !replaceFile( tempName, "students.bin" ) )
+    {
+        cerr << "error: writing the new file failed!" << endl;
+        unlink( tempName.c_str() );
+        exit(1);
+    }
+    // the free-slot map of the new file has no free slots
+    remove( FREE_MAP_FILE );
+    fout.open( "students.bin", ios::in | ios::binary );
+    recordLocks.open( "students.bin" );
+    recordChecksums.close();
+    if( !freeSlots.load( fout ) )
+    {
+        cerr << "error: creating the free-slot map failed!" << endl;
+        exit(1);
+    }
+    close( sessionFd );  // writers may open the new file
+
+    cout << fixed << setprecision(2)
+        << "Kept " << keptCount << " of " << recordCount << " record(s), "
+        << "removed " << recordCount - keptCount << " deleted slot(s) in "
+        << now() - start << " s\n"
+        << "Old record numbers map to new ones in " << REMAP_FILE << endl;
+    return 0;
+}
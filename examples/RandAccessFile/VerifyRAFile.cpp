@@ -0,0 +1,255 @@
+// check the records of a random access file against their
+// checksums, or write the checksums, with a pool of threads
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "fileheader.h"
+#include "checksum.h"
+using namespace std;
+
+// bytes per read of a thread
+const size_t CHUNK_SIZE = 1 << 20;
+// failed records listed by number
+const size_t LISTED_FAILURES = 10;
+
+// a part of the file checked (or checksummed) by one thread
+struct VerifyJob
+{
+    int dataFd;
+    int sumFd;
+    bool build;                    // write the checksums instead
+    size_t headerSize;
+    size_t recordSize;
+    long long first;               // first record of the part
+    long long end;                 // one past the last record
+    long long failed;
+    long long missing;             // records without a checksum
+    vector< long long > failures;  // the first failed records
+    bool ok;                       // all reads and writes succeeded
+};
+
+// seconds since the epoch, with microseconds
+double now()
+{
+    timeval time;
+    gettimeofday( &time, 0 );
+    return time.tv_sec + time.tv_usec / 1e6;
+} // end function now
+
+// lock or unlock a byte range of the records for reading, so no
+// record is seen half way through a write of another process
+void lockRange( int fd, off_t start, off_t length, short type )
+{
+    struct flock range;
+    range.l_type = type;
+    range.l_whence = SEEK_SET;
+    range.l_start = start;
+    range.l_len = length;
+    range.l_pid = 0;
+    fcntl( fd, type == F_UNLCK ? F_SETLK : F_SETLKW, &range );
+} // end function lockRange
+
+// check or checksum the records of one part, a chunk at a time
+void *verifyPart( void *argument )
+{
+    VerifyJob &job = *static_cast< VerifyJob * >( argument );
+    size_t chunkRecords = max( CHUNK_SIZE / job.recordSize,
+                               static_cast< size_t >( 1 ) );
+    vector< char > records( chunkRecords * job.recordSize );
+    vector< uint32_t > sums( chunkRecords );
+    job.failed = job.missing = 0;
+    job.ok = true;
+
+    for( long long first = job.first; job.ok && first < job.end;
+         first += chunkRecords )
+    {
+        size_t count = min( static_cast< long long >( chunkRecords ),
+                            job.end - first );
+        off_t position = job.headerSize + ( first - 1 ) * job.recordSize;
+        ssize_t bytes = count * job.recordSize;
+
+        if( !job.build )
+            lockRange( job.dataFd, position, bytes, F_RDLCK );
+        job.ok = pread( job.dataFd, &records[0], bytes, position ) == bytes;
+        // a checksum file shorter than the records has no
+        // checksum for the records past its end
+        ssize_t stored = 0;
+        if( job.ok && !job.build )
+        {
+            stored = pread( job.sumFd, &sums[0], count * sizeof( uint32_t ),
+                            ( first - 1 ) * sizeof( uint32_t ) );
+            stored = ( stored > 0 ? stored / sizeof( uint32_t ) : 0 );
+        }
+        if( !job.build )
+            lockRange( job.dataFd, position, bytes, F_UNLCK );
+        if( !job.ok )
+            break;
+
+        if( job.build )
+        {
+            for( size_t i = 0; i < count; i++ )
+                sums[i] = recordChecksum( &records[ i * job.recordSize ],
+                                          job.recordSize );
+            ssize_t sumBytes = count * sizeof( uint32_t );
+            job.ok = pwrite( job.sumFd, &sums[0], sumBytes,
+                             ( first - 1 ) * sizeof( uint32_t ) ) == sumBytes;
+            continue;
+        }
+
+        for( size_t i = 0; i < count; i++ )
+        {
+            if( static_cast< ssize_t >( i ) >= stored || sums[i] == 0 )
+            {
+                ++job.missing;
+            }
+            else if( sums[i] != recordChecksum( &records[ i * job.recordSize ],
+                                                job.recordSize ) )
+            {
+                ++job.failed;
+                if( job.failures.size() < LISTED_FAILURES )
+                    job.failures.push_back( first + i );
+            }
+        }
+    }
+    return 0;
+} // end function verifyPart
+
+// name of the checksum file of a records file
+string checksumFileName( const string &fileName )
+{
+    size_t dot = fileName.rfind( '.' );
+    size_t slash = fileName.rfind( '/' );
+    if( dot == string::npos || ( slash != string::npos && dot < slash ) )
+    {
+        return fileName + ".crc";
+    }
+    return fileName.substr( 0, dot ) + ".crc";
+} // end function checksumFileName
+
+int main( int argc, char *argv[] )
+{
+    bool build = ( argc > 1 && strcmp( argv[1], "-b" ) == 0 );
+    int arg = ( build ? 2 : 1 );
+    string fileName = ( argc > arg ? argv[ arg ] : "students.bin" );
+    int threadCount = ( argc > arg + 1 ? atoi( argv[ arg + 1 ] )
+                                       : sysconf( _SC_NPROCESSORS_ONLN ) );
+    if( threadCount < 1 )
+    {
+        cerr << "usage: " << argv[0] << " [-b] [file] [threads]" << endl;
+        exit(1);
+    }
+
+    // any records file with the header layout of FileHeader is
+    // checked, students.bin as well as credit.dat
+    int dataFd = open( fileName.c_str(), O_RDONLY );
+    FileHeader header;
+    struct stat info;
+    if( dataFd < 0 || fstat( dataFd, &info ) < 0
+        || pread( dataFd, &header, sizeof( FileHeader ), 0 )
+               != static_cast< ssize_t >( sizeof( FileHeader ) ) )
+    {
+        cerr << "error: openning file " << fileName << " failed!" << endl;
+        exit(1);
+    }
+    if( header.byteOrder != BYTE_ORDER_MARK || header.recordSize == 0
+        || header.headerSize < sizeof( FileHeader ) || header.recordCount < 0 )
+    {
+        cerr << "error: " << fileName << " has no records header!" << endl;
+        exit(1);
+    }
+    // counted records missing from the end of the file are not read
+    long long recordCount = min( static_cast< long long >( header.recordCount ),
+        max( static_cast< long long >( info.st_size ) - header.headerSize, 0LL )
+            / header.recordSize );
+    posix_fadvise( dataFd, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+    // a new checksum file is renamed over the old one when complete
+    string sumName = checksumFileName( fileName );
+    string tempName = sumName + ".tmp";
+    int sumFd = build
+        ? open( tempName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 )
+        : open( sumName.c_str(), O_RDONLY );
+    if( sumFd < 0 )
+    {
+        if( build )
+            cerr << "error: open file for output failed!" << endl;
+        else
+            cerr << "error: " << fileName << " has no checksum file "
+                << sumName << ", write one with -b!" << endl;
+        exit(1);
+    }
+
+    // each thread takes an equal run of records
+    double start = now();
+    vector< VerifyJob > jobs( threadCount );
+    vector< pthread_t > threads( threadCount );
+    long long part = ( recordCount + threadCount - 1 ) / threadCount;
+    for( int i = 0; i < threadCount; i++ )
+    {
+        jobs[i].dataFd = dataFd;
+        jobs[i].sumFd = sumFd;
+        jobs[i].build = build;
+        jobs[i].headerSize = header.headerSize;
+        jobs[i].recordSize = header.recordSize;
+        jobs[i].first = min( i * part, recordCount ) + 1;
+        jobs[i].end = min( ( i + 1 ) * part, recordCount ) + 1;
+        pthread_create( &threads[i], 0, verifyPart, &jobs[i] );
+    }
+
+    long long failed = 0, missing = 0;
+    bool ok = true;
+    vector< long long > failures;
+    for( int i = 0; i < threadCount; i++ )
+    {
+        pthread_join( threads[i], 0 );
+        ok = ok && jobs[i].ok;
+        failed += jobs[i].failed;
+        missing += jobs[i].missing;
+        failures.insert( failures.end(), jobs[i].failures.begin(),
+                         jobs[i].failures.end() );
+    }
+    double seconds = now() - start;
+
+    if( build )
+    {
+        ok = ok && fsync( sumFd ) == 0
+            && rename( tempName.c_str(), sumName.c_str() ) == 0;
+        if( !ok )
+            unlink( tempName.c_str() );
+    }
+    close( sumFd );
+    close( dataFd );
+    if( !ok )
+    {
+        cerr << "error: reading or writing the files failed!" << endl;
+        exit(1);
+    }
+
+    double megabytes = recordCount * header.recordSize / 1e6;
+    cout << fixed << setprecision(2)
+        << ( build ? "Checksummed " : "Checked " ) << recordCount
+        << " record(s) of " << fileName << " with " << threadCount
+        << " thread(s) in " << seconds << " s ("
+        << setprecision(0) << megabytes / seconds << " MB/s)" << endl;
+    if( build )
+    {
+        cout << "Checksums written to " << sumName << endl;
+        return 0;
+    }
+
+    cout << failed << " record(s) fail their checksum, " << missing
+        << " record(s) have none" << endl;
+    for( size_t i = 0; i < failures.size() && i < LISTED_FAILURES; i++ )
+        cout << "  record " << failures[i] << " is damaged" << endl;
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,495 @@
+// async.cpp
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "async.h"
+#include "pool.h"
+#include "wal.h"
+
+// most reads a ring keeps in flight
+static const int RING_ENTRIES_MAX = 4096;
+
+// the rings of an io_uring instance and the reads in flight on it
+struct AsyncRing
+{
+    // a read in flight, its index is the user_data of its entry
+    struct Slot
+    {
+        AsyncRequest request;
+        Student record;
+        iovec buffer;
+    };
+
+    AsyncRing() : ringFd(-1), fd(-1), sqRing(MAP_FAILED), sqRingSize(0),
+        cqRing(MAP_FAILED), cqRingSize(0), sqes(MAP_FAILED), sqesSize(0),
+        unsubmitted(0)
+    {
+    }
+
+    int ringFd;                     // the io_uring instance
+    int fd;                         // the records file, read by the kernel
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    void *sqes;
+    size_t sqesSize;
+
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    io_uring_cqe *cqes;
+
+    vector< Slot > slots;
+    vector< unsigned > freeSlots;
+    unsigned unsubmitted;           // entries the kernel has not seen yet
+    map< int, int > lockCounts;     // reads in flight of each locked record
+};
+
+// take or release a lock of a record with an open file description,
+// false if it is held by a writer and not waited for
+static bool lockRecord( int fd, int recordNumber, short type, bool wait )
+{
+#ifdef F_OFD_SETLKW
+    struct flock range;
+    range.l_type = type;
+    range.l_whence = SEEK_SET;
+    range.l_start = recordPosition( recordNumber );
+    range.l_len = sizeof( Student );
+    range.l_pid = 0;
+    int status;
+    while( ( status = fcntl( fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &range ) )
+           < 0 && errno == EINTR )
+        ;
+    return status == 0;
+#else
+    return true;
+#endif
+} // end function lockRecord
+
+// create a reader with no workers
+AsyncReader::AsyncReader() : ring_(0), outstanding_(0), stopping_(false)
+{
+    pthread_mutex_init( &mutex_, 0 );
+    pthread_cond_init( &requested_, 0 );
+    pthread_cond_init( &completed_, 0 );
+} // end AsyncReader constructor
+
+// wait for the workers and close their descriptors
+AsyncReader::~AsyncReader()
+{
+    close();
+    pthread_cond_destroy( &completed_ );
+    pthread_cond_destroy( &requested_ );
+    pthread_mutex_destroy( &mutex_ );
+} // end AsyncReader destructor
+
+// start on a records file with a number of reads in flight
+bool AsyncReader::open( const string &fileName, int depth, bool useRing )
+{
+    close();
+    // a worker opens the file itself, check it can be opened
+    int fd = ::open( fileName.c_str(), O_RDONLY );
+    if( fd < 0 )
+    {
+        return false;
+    }
+    ::close( fd );
+
+    fileName_ = fileName;
+    stopping_ = false;
+    if( depth < 1 )
+        depth = 1;
+    // the ring is tried first, the workers are the fallback
+    if( useRing && openRing( fileName, depth ) )
+    {
+        return true;
+    }
+    threads_.resize( depth );
+    for( size_t i = 0; i < threads_.size(); i++ )
+    {
+        if( pthread_create( &threads_[i], 0, work, this ) != 0 )
+        {
+            threads_.resize( i );
+            close();
+            return false;
+        }
+    }
+    return true;
+} // end function open
+
+// stop the ring or the workers
+void AsyncReader::close()
+{
+    closeRing();
+
+    pthread_mutex_lock( &mutex_ );
+    stopping_ = true;
+    pthread_cond_broadcast( &requested_ );
+    pthread_mutex_unlock( &mutex_ );
+
+    for( size_t i = 0; i < threads_.size(); i++ )
+        pthread_join( threads_[i], 0 );
+    threads_.clear();
+
+    requests_.clear();
+    results_.clear();
+    outstanding_ = 0;
+} // end function close
+
+// queue the read of a (record numbered) location
+void AsyncReader::submit( int recordNumber, int tag )
+{
+    AsyncRequest request;
+    request.recordNumber = recordNumber;
+    request.tag = tag;
+
+    pthread_mutex_lock( &mutex_ );
+    requests_.push_back( request );
+    ++outstanding_;
+    pthread_cond_signal( &requested_ );
+    pthread_mutex_unlock( &mutex_ );
+
+    // the entry goes in the ring now and to the kernel when results
+    // are collected, so a batch of submits costs one system call
+    if( ring_ )
+        fillRing();
+} // end function submit
+
+// wait for a read to complete
+bool AsyncReader::collect( AsyncResult &result )
+{
+    if( ring_ )
+    {
+        if( outstanding_ == 0 )
+        {
+            return false;
+        }
+        while( results_.empty() )
+        {
+            fillRing();
+            if( !results_.empty() )
+                break;
+            if( !enterRing( 1 ) )
+                return false;
+            reapRing();
+        }
+        result = results_.front();
+        results_.pop_front();
+        --outstanding_;
+        return true;
+    }
+
+    pthread_mutex_lock( &mutex_ );
+    if( outstanding_ == 0 )
+    {
+        pthread_mutex_unlock( &mutex_ );
+        return false;
+    }
+    while( results_.empty() )
+        pthread_cond_wait( &completed_, &mutex_ );
+
+    result = results_.front();
+    results_.pop_front();
+    --outstanding_;
+    pthread_mutex_unlock( &mutex_ );
+    return true;
+} // end function collect
+
+// body of a worker thread: take requests until the reader stops
+void *AsyncReader::work( void *argument )
+{
+    AsyncReader *reader = static_cast< AsyncReader * >( argument );
+    // a descriptor per worker, so the reads do not share a file offset
+    // and each worker's locks belong to its own open file description
+    int fd = ::open( reader->fileName_.c_str(), O_RDONLY );
+
+    pthread_mutex_lock( &reader->mutex_ );
+    while( true )
+    {
+        while( reader->requests_.empty() && !reader->stopping_ )
+            pthread_cond_wait( &reader->requested_, &reader->mutex_ );
+        if( reader->stopping_ )
+            break;
+
+        AsyncRequest request = reader->requests_.front();
+        reader->requests_.pop_front();
+        // the read runs while other workers take requests
+        pthread_mutex_unlock( &reader->mutex_ );
+
+        AsyncResult result;
+        readOne( fd, request, result );
+
+        pthread_mutex_lock( &reader->mutex_ );
+        reader->results_.push_back( result );
+        pthread_cond_signal( &reader->completed_ );
+    }
+    pthread_mutex_unlock( &reader->mutex_ );
+
+    if( fd >= 0 )
+        ::close( fd );
+    return 0;
+} // end function work
+
+// read one record with a worker's descriptor
+void AsyncReader::readOne( int fd, const AsyncRequest &request,
+                           AsyncResult &result )
+{
+    result.recordNumber = request.recordNumber;
+    result.tag = request.tag;
+    result.record = Student();
+    result.found = false;
+    if( fd < 0 || request.recordNumber < 1 )
+    {
+        return;
+    }
+
+    // a shared lock keeps a writer out of the record while it is read
+    lockRecord( fd, request.recordNumber, F_RDLCK, true );
+    result.found = pread( fd, &result.record, sizeof( Student ),
+                          recordPosition( request.recordNumber ) )
+                   == static_cast< ssize_t >( sizeof( Student ) );
+    lockRecord( fd, request.recordNumber, F_UNLCK, false );
+    if( !result.found )
+        result.record = Student();
+} // end function readOne
+
+// set up an io_uring instance with raw system calls and map its rings
+bool AsyncReader::openRing( const string &fileName, int depth )
+{
+    io_uring_params params;
+    memset( &params, 0, sizeof( params ) );
+    int ringFd = syscall( __NR_io_uring_setup,
+                          depth < RING_ENTRIES_MAX ? depth : RING_ENTRIES_MAX,
+                          &params );
+    if( ringFd < 0 )
+    {
+        return false;
+    }
+
+    ring_ = new AsyncRing;
+    AsyncRing &ring = *ring_;
+    ring.ringFd = ringFd;
+    ring.fd = ::open( fileName.c_str(), O_RDONLY );
+    ring.sqRingSize = params.sq_off.array
+                      + params.sq_entries * sizeof( unsigned );
+    ring.cqRingSize = params.cq_off.cqes
+                      + params.cq_entries * sizeof( io_uring_cqe );
+    ring.sqesSize = params.sq_entries * sizeof( io_uring_sqe );
+    ring.sqRing = mmap( 0, ring.sqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING );
+    ring.cqRing = mmap( 0, ring.cqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING );
+    ring.sqes = mmap( 0, ring.sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES );
+    if( ring.fd < 0 || ring.sqRing == MAP_FAILED
+        || ring.cqRing == MAP_FAILED || ring.sqes == MAP_FAILED )
+    {
+        closeRing();
+        return false;
+    }
+
+    char *sq = static_cast< char * >( ring.sqRing );
+    char *cq = static_cast< char * >( ring.cqRing );
+    ring.sqHead = reinterpret_cast< unsigned * >( sq + params.sq_off.head );
+    ring.sqTail = reinterpret_cast< unsigned * >( sq + params.sq_off.tail );
+    ring.sqMask = reinterpret_cast< unsigned * >(
+                      sq + params.sq_off.ring_mask );
+    ring.sqArray = reinterpret_cast< unsigned * >( sq + params.sq_off.array );
+    ring.cqHead = reinterpret_cast< unsigned * >( cq + params.cq_off.head );
+    ring.cqTail = reinterpret_cast< unsigned * >( cq + params.cq_off.tail );
+    ring.cqMask = reinterpret_cast< unsigned * >(
+                      cq + params.cq_off.ring_mask );
+    ring.cqes = reinterpret_cast< io_uring_cqe * >( cq + params.cq_off.cqes );
+
+    // no more reads in flight than submission entries, and the
+    // completion ring is twice as large, so neither ring overflows
+    ring.slots.resize( params.sq_entries );
+    for( unsigned i = params.sq_entries; i > 0; i-- )
+        ring.freeSlots.push_back( i - 1 );
+    return true;
+} // end function openRing
+
+// complete the reads in flight and release the io_uring instance
+void AsyncReader::closeRing()
+{
+    if( !ring_ )
+    {
+        return;
+    }
+    AsyncRing *ring = ring_;
+    // the kernel writes the records of reads in flight into the
+    // slots, which are kept if the reads cannot be waited for
+    bool drained = drainRing();
+    ring_ = 0;
+
+    if( ring->sqes != MAP_FAILED )
+        munmap( ring->sqes, ring->sqesSize );
+    if( ring->cqRing != MAP_FAILED )
+        munmap( ring->cqRing, ring->cqRingSize );
+    if( ring->sqRing != MAP_FAILED )
+        munmap( ring->sqRing, ring->sqRingSize );
+    // closing the file releases the locks of its description
+    if( ring->fd >= 0 )
+        ::close( ring->fd );
+    ::close( ring->ringFd );
+    if( drained )
+        delete ring;
+} // end function closeRing
+
+// move queued requests to free entries of the submission ring
+void AsyncReader::fillRing()
+{
+    AsyncRing &ring = *ring_;
+    while( !requests_.empty() && !ring.freeSlots.empty() )
+    {
+        AsyncRequest request = requests_.front();
+        requests_.pop_front();
+        if( request.recordNumber < 1 )
+        {
+            AsyncResult result;
+            readOne( -1, request, result );
+            results_.push_back( result );
+            continue;
+        }
+
+        // the record stays locked until its read completes. a writer
+        // holding it is waited for with no other record locked, as a
+        // worker thread would, so the two never wait for each other
+        if( ring.lockCounts[ request.recordNumber ] == 0
+            && !lockRecord( ring.fd, request.recordNumber, F_RDLCK, false ) )
+        {
+            if( errno == EAGAIN || errno == EACCES )
+                drainRing();
+            lockRecord( ring.fd, request.recordNumber, F_RDLCK, true );
+        }
+        ++ring.lockCounts[ request.recordNumber ];
+
+        unsigned slot = ring.freeSlots.back();
+        ring.freeSlots.pop_back();
+        AsyncRing::Slot &read = ring.slots[ slot ];
+        read.request = request;
+        read.buffer.iov_base = &read.record;
+        read.buffer.iov_len = sizeof( Student );
+
+        unsigned tail = *ring.sqTail;
+        unsigned index = tail & *ring.sqMask;
+        io_uring_sqe *entry = static_cast< io_uring_sqe * >( ring.sqes )
+                              + index;
+        memset( entry, 0, sizeof( io_uring_sqe ) );
+        entry->opcode = IORING_OP_READV;
+        entry->fd = ring.fd;
+        entry->off = recordPosition( request.recordNumber );
+        entry->addr = reinterpret_cast< unsigned long >( &read.buffer );
+        entry->len = 1;
+        entry->user_data = slot;
+        ring.sqArray[ index ] = index;
+        // the kernel sees the entry once the tail moves past it
+        __atomic_store_n( ring.sqTail, tail + 1, __ATOMIC_RELEASE );
+        ++ring.unsubmitted;
+    }
+} // end function fillRing
+
+// pass the new entries to the kernel and wait for completions
+bool AsyncReader::enterRing( unsigned completions )
+{
+    AsyncRing &ring = *ring_;
+    unsigned inFlight = ring.slots.size() - ring.freeSlots.size();
+    if( completions > inFlight )
+        completions = inFlight;
+    while( true )
+    {
+        long submitted = syscall( __NR_io_uring_enter, ring.ringFd,
+                                  ring.unsubmitted, completions,
+                                  completions ? IORING_ENTER_GETEVENTS : 0,
+                                  0, 0 );
+        if( submitted >= 0 )
+        {
+            ring.unsubmitted -= submitted;
+            return true;
+        }
+        if( errno != EINTR )
+        {
+            return false;
+        }
+    }
+} // end function enterRing
+
+// move the completed reads to the results and unlock their records
+void AsyncReader::reapRing()
+{
+    AsyncRing &ring = *ring_;
+    unsigned head = *ring.cqHead;
+    unsigned tail = __atomic_load_n( ring.cqTail, __ATOMIC_ACQUIRE );
+    for( ; head != tail; head++ )
+    {
+        const io_uring_cqe &completion = ring.cqes[ head & *ring.cqMask ];
+        unsigned slot = static_cast< unsigned >( completion.user_data );
+        const AsyncRing::Slot &read = ring.slots[ slot ];
+
+        AsyncResult result;
+        result.recordNumber = read.request.recordNumber;
+        result.tag = read.request.tag;
+        // a short read is past the end of file, as with pread()
+        result.found = completion.res
+                       == static_cast< int >( sizeof( Student ) );
+        result.record = result.found ? read.record : Student();
+        results_.push_back( result );
+
+        if( --ring.lockCounts[ result.recordNumber ] == 0 )
+        {
+            ring.lockCounts.erase( result.recordNumber );
+            lockRecord( ring.fd, result.recordNumber, F_UNLCK, false );
+        }
+        ring.freeSlots.push_back( slot );
+    }
+    __atomic_store_n( ring.cqHead, head, __ATOMIC_RELEASE );
+} // end function reapRing
+
+// wait for every read in flight to complete
+bool AsyncReader::drainRing()
+{
+    AsyncRing &ring = *ring_;
+    while( ring.freeSlots.size() < ring.slots.size() )
+    {
+        if( !enterRing( ring.slots.size() - ring.freeSlots.size() ) )
+            return false;
+        reapRing();
+    }
+    return true;
+} // end function drainRing
+
+// read records at a list of (record numbered) locations with
+// many reads in flight, into an array in list order
+int readRecordsAsync( fstream &inFile, AsyncReader &reader,
+                      const int *recordNumbers, int count, Student *recs )
+{
+    // the workers read the file, after the records
+    // written to the pool are in it
+    if( bufferPool.isEnabled() )
+        bufferPool.flush( inFile );
+
+    for( int i = 0; i < count; i++ )
+        reader.submit( recordNumbers[i], i );
+
+    int found = 0;
+    AsyncResult result;
+    while( reader.outstanding() > 0 && reader.collect( result ) )
+    {
+        recs[ result.tag ] = result.record;
+        found += result.found;
+        // a write of the open batch is newer than the file
+        writeLog.pendingRecord( result.recordNumber, recs[ result.tag ] );
+    }
+    return found;
+} // end function readRecordsAsync
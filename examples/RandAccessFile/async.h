@@ -0,0 +1,110 @@
+// async.h
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "record.h"
+using namespace std;
+
+// a read submitted to an AsyncReader
+struct AsyncRequest
+{
+    int recordNumber;
+    int tag;              // chosen by the caller, returned with the result
+};
+
+// a completed read
+struct AsyncResult
+{
+    int recordNumber;
+    int tag;
+    bool found;           // false past the end of file
+    Student record;
+};
+
+// the io_uring instance of a reader, defined in async.cpp
+struct AsyncRing;
+
+// keeps many record reads in flight at once, so a batch of random
+// lookups is limited by the throughput of the device instead of the
+// latency of each read.
+//
+// the reads are queued to an io_uring instance, set up with raw
+// system calls, where the kernel has it. a record stays under a
+// shared lock of the ring's open file description (F_OFD_SETLK)
+// from submit to completion, so writers wait for it. where io_uring
+// cannot be set up (an old kernel, or a sandbox that forbids it)
+// a pool of worker threads reads with pread() instead, each worker
+// with its own descriptor and lock of the record being read.
+//
+// results are collected in completion order, not in submit order.
+// with io_uring, submit() and collect() belong to one thread.
+// the reader sees the file only: a caller with a buffer pool or an
+// open log batch uses readRecordsAsync(), which handles both.
+class AsyncReader
+{
+public:
+    AsyncReader();
+    // wait for the workers and close their descriptors
+    ~AsyncReader();
+
+    // start on a records file with a number of reads in flight,
+    // on io_uring unless told to use worker threads
+    bool open( const string &, int, bool = true );
+    // stop reading, reads not yet collected are dropped
+    void close();
+    bool isOpen() const { return ring_ != 0 || !threads_.empty(); }
+    // true if the reads go through io_uring
+    bool usesRing() const { return ring_ != 0; }
+
+    // queue the read of a (record numbered) location
+    void submit( int, int );
+    // wait for a read to complete, false if none is outstanding
+    bool collect( AsyncResult & );
+    // reads submitted and not yet collected
+    int outstanding() const { return outstanding_; }
+
+private:
+    // a pool has a single owner
+    AsyncReader( const AsyncReader & );
+    AsyncReader &operator=( const AsyncReader & );
+
+    // body of a worker thread
+    static void *work( void * );
+    // read one record with a worker's descriptor
+    static void readOne( int, const AsyncRequest &, AsyncResult & );
+
+    // set up and tear down the io_uring instance
+    bool openRing( const string &, int );
+    void closeRing();
+    // move queued requests to the submission ring
+    void fillRing();
+    // pass submissions to the kernel, wait for a number of completions
+    bool enterRing( unsigned );
+    // move completions to the results
+    void reapRing();
+    // complete every read in flight, releasing their locks
+    bool drainRing();
+
+    AsyncRing *ring_;
+
+    vector< pthread_t > threads_;
+    string fileName_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t requested_;          // a request was queued
+    pthread_cond_t completed_;          // a result was queued
+    deque< AsyncRequest > requests_;
+    deque< AsyncResult > results_;
+    int outstanding_;
+    bool stopping_;
+};
+
+// read records at a list of (record numbered) locations with many
+// reads in flight, into an array in list order, return records found
+int readRecordsAsync( fstream &, AsyncReader &, const int *, int, Student * );
+
+#endif
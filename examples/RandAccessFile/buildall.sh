@@ -8,11 +8,22 @@ CWD=$(dirname `realpath $BASH_SOURCE`)
 
 echo "your c++ compiler is: $(basename $CXX)"
 echo "compiling .cpp files..."
-$CXX inputs.cpp record.cpp CreateRAFile.cpp -o $BUILD_DIR/CreateRAFile
-$CXX inputs.cpp record.cpp ReadRAFile.cpp -o $BUILD_DIR/ReadRAFile
-$CXX inputs.cpp record.cpp SearchRecord.cpp -o $BUILD_DIR/SearchRecord
-$CXX inputs.cpp record.cpp UpdateRecord.cpp -o $BUILD_DIR/UpdateRecord
-$CXX inputs.cpp record.cpp DeleteRecord.cpp -o $BUILD_DIR/DeleteRecord
+# record processing library linked into every program
+LIB="inputs.cpp record.cpp fileheader.cpp index.cpp freemap.cpp wal.cpp lock.cpp pool.cpp checksum.cpp"
+$CXX $LIB CreateRAFile.cpp -o $BUILD_DIR/CreateRAFile
+$CXX $LIB store.cpp ReadRAFile.cpp -o $BUILD_DIR/ReadRAFile
+$CXX $LIB SearchRecord.cpp -o $BUILD_DIR/SearchRecord
+$CXX $LIB UpdateRecord.cpp -o $BUILD_DIR/UpdateRecord
+$CXX $LIB DeleteRecord.cpp -o $BUILD_DIR/DeleteRecord
+$CXX $LIB InsertRecord.cpp -o $BUILD_DIR/InsertRecord
+$CXX $LIB store.cpp columns.cpp ScoreStats.cpp -o $BUILD_DIR/ScoreStats
+$CXX $LIB BatchRecord.cpp -o $BUILD_DIR/BatchRecord
+$CXX $LIB BulkLoad.cpp -pthread -o $BUILD_DIR/BulkLoad
+$CXX $LIB store.cpp columns.cpp compact.cpp CompactBench.cpp -o $BUILD_DIR/CompactBench
+$CXX $LIB async.cpp AsyncBench.cpp -pthread -o $BUILD_DIR/AsyncBench
+$CXX $LIB VacuumRAFile.cpp -o $BUILD_DIR/VacuumRAFile
+$CXX $LIB VerifyRAFile.cpp -pthread -o $BUILD_DIR/VerifyRAFile
+$CXX $LIB UpgradeRAFile.cpp -o $BUILD_DIR/UpgradeRAFile
 
 [ $? -ne 0 ] && echo "error compiling files!" && exit 1
 echo "successfully compiled all .cpp files..."
@@ -0,0 +1,333 @@
+// checksum.cpp
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+// the crc32 instruction is compiled in whatever the flags of the
+// build, and used if the processor has it
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+#define CRC32C_INSTRUCTION
+#include <nmmintrin.h>
+#endif
+#include "checksum.h"
+
+// checksums of the records file used by the tools
+RecordChecksums recordChecksums;
+
+// the checksum file grows by this many records at a time
+static const size_t GROW_RECORDS = 16384;
+// records per read when a checksum file is built (about 1 MiB)
+static const int BUILD_RECORDS = ( 1 << 20 ) / sizeof( Student );
+
+// CRC32C polynomial, bit reversed
+static const uint32_t CASTAGNOLI = 0x82f63b78u;
+
+// tables to take the CRC eight bytes at a time ("slicing by 8"),
+// filled before main() so threads can share them
+struct Crc32cTables
+{
+    Crc32cTables()
+    {
+        for( uint32_t byte = 0; byte < 256; byte++ )
+        {
+            uint32_t crc = byte;
+            for( int bit = 0; bit < 8; bit++ )
+                crc = ( crc >> 1 ) ^ ( ( crc & 1 ) ? CASTAGNOLI : 0 );
+            table[0][ byte ] = crc;
+        }
+        for( int slice = 1; slice < 8; slice++ )
+            for( int byte = 0; byte < 256; byte++ )
+                table[ slice ][ byte ] = ( table[ slice - 1 ][ byte ] >> 8 )
+                    ^ table[0][ table[ slice - 1 ][ byte ] & 0xff ];
+    }
+
+    uint32_t table[8][256];
+};
+static const Crc32cTables crcTables;
+
+#ifdef CRC32C_INSTRUCTION
+// CRC32C with the crc32 instruction, one instruction per eight bytes
+__attribute__(( target( "sse4.2" ) ))
+static uint32_t crc32cInstruction( uint32_t crc, const unsigned char *bytes,
+                                   size_t size )
+{
+    uint64_t crc64 = crc;
+    for( ; size >= 8; size -= 8, bytes += 8 )
+    {
+        uint64_t word;
+        memcpy( &word, bytes, 8 );
+        crc64 = _mm_crc32_u64( crc64, word );
+    }
+    crc = static_cast< uint32_t >( crc64 );
+    for( ; size > 0; size--, bytes++ )
+        crc = _mm_crc32_u8( crc, *bytes );
+    return crc;
+} // end function crc32cInstruction
+
+// whether the processor has the crc32 instruction (SSE4.2)
+static bool hasCrcInstruction()
+{
+    // the check may run before the constructors of the runtime
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "sse4.2" );
+} // end function hasCrcInstruction
+
+// checked before main() so threads can share it
+static const bool crcInstruction = hasCrcInstruction();
+#endif
+
+// CRC32C of a block of bytes
+uint32_t crc32c( const void *data, size_t size )
+{
+    const unsigned char *bytes = static_cast< const unsigned char * >( data );
+    uint32_t crc = 0xffffffffu;
+#ifdef CRC32C_INSTRUCTION
+    if( crcInstruction )
+        return ~crc32cInstruction( crc, bytes, size );
+#endif
+
+    const uint32_t ( *table )[256] = crcTables.table;
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // eight table lookups per eight bytes
+    for( ; size >= 8; size -= 8, bytes += 8 )
+    {
+        uint32_t low, high;
+        memcpy( &low, bytes, 4 );
+        memcpy( &high, bytes + 4, 4 );
+        low ^= crc;
+        crc = table[7][ low & 0xff ] ^ table[6][ ( low >> 8 ) & 0xff ]
+            ^ table[5][ ( low >> 16 ) & 0xff ] ^ table[4][ low >> 24 ]
+            ^ table[3][ high & 0xff ] ^ table[2][ ( high >> 8 ) & 0xff ]
+            ^ table[1][ ( high >> 16 ) & 0xff ] ^ table[0][ high >> 24 ];
+    }
+#endif
+    for( ; size > 0; size--, bytes++ )
+        crc = ( crc >> 8 ) ^ table[0][ ( crc ^ *bytes ) & 0xff ];
+    return ~crc;
+} // end function crc32c
+
+// checksum stored for a record, zero is kept for "not recorded"
+uint32_t recordChecksum( const void *record, size_t size )
+{
+    uint32_t crc = crc32c( record, size );
+    return crc != 0 ? crc : 1;
+} // end function recordChecksum
+
+/**
+ *  RecordChecksums member functions
+ */
+
+// create a closed checksum file
+RecordChecksums::RecordChecksums()
+    : fd_(-1), writable_(false), tried_(false),
+      map_(0), mapped_(0), failures_(0)
+{
+} // end RecordChecksums constructor
+
+// unmap the file
+RecordChecksums::~RecordChecksums()
+{
+    close();
+} // end RecordChecksums destructor
+
+// open the checksum file, false if there is none
+bool RecordChecksums::open( const char *fileName )
+{
+    close();
+    tried_ = true;
+
+    // a reader without write access still checks its records
+    writable_ = true;
+    fd_ = ::open( fileName, O_RDWR );
+    if( fd_ < 0 )
+    {
+        writable_ = false;
+        fd_ = ::open( fileName, O_RDONLY );
+    }
+    return fd_ >= 0;
+} // end function open
+
+// unmap the file, it is opened again on next use
+void RecordChecksums::close()
+{
+    if( map_ != 0 )
+        munmap( map_, mapped_ * sizeof( uint32_t ) );
+    if( fd_ >= 0 )
+        ::close( fd_ );
+    fd_ = -1;
+    map_ = 0;
+    mapped_ = 0;
+    tried_ = false;
+} // end function close
+
+// unmap the file and check no records until it is opened again
+void RecordChecksums::detach()
+{
+    close();
+    tried_ = true;
+} // end function detach
+
+// open the file on first use, if it exists
+bool RecordChecksums::attach()
+{
+    if( fd_ < 0 && !tried_ )
+        open();
+    return fd_ >= 0;
+} // end function attach
+
+// map at least a number of records, growing the file if asked
+bool RecordChecksums::reserve( int records, bool grow )
+{
+    if( static_cast< size_t >( records ) <= mapped_ )
+    {
+        return true;
+    }
+
+    // other processes may have grown the file
+    struct stat info;
+    if( fstat( fd_, &info ) < 0 )
+    {
+        return false;
+    }
+    size_t fileRecords = info.st_size / sizeof( uint32_t );
+    if( fileRecords < static_cast< size_t >( records ) && grow && writable_ )
+    {
+        // posix_fallocate() never shrinks a file another process grew
+        fileRecords = ( records + GROW_RECORDS - 1 ) / GROW_RECORDS
+                      * GROW_RECORDS;
+        if( posix_fallocate( fd_, 0, fileRecords * sizeof( uint32_t ) ) != 0 )
+        {
+            return false;
+        }
+    }
+    if( fileRecords <= mapped_ )
+    {
+        return false;
+    }
+
+    void *map = mmap( 0, fileRecords * sizeof( uint32_t ),
+                      writable_ ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED, fd_, 0 );
+    if( map == MAP_FAILED )
+    {
+        return false;
+    }
+    if( map_ != 0 )
+        munmap( map_, mapped_ * sizeof( uint32_t ) );
+    map_ = static_cast< uint32_t * >( map );
+    mapped_ = fileRecords;
+    return fileRecords >= static_cast< size_t >( records );
+} // end function reserve
+
+// record the checksums of a range of records being written
+void RecordChecksums::update( int first, int count, const Student *recs )
+{
+    if( count <= 0 || !attach() || !writable_
+        || !reserve( first + count - 1, true ) )
+    {
+        return;
+    }
+    for( int i = 0; i < count; i++ )
+        map_[ first - 1 + i ] = recordChecksum( &recs[i], sizeof( Student ) );
+} // end function update
+
+// check a range of records read
+bool RecordChecksums::verify( int first, int count, const Student *recs )
+{
+    if( count <= 0 || !attach() )
+    {
+        return true;
+    }
+    // records past the end of the checksum file have none
+    reserve( first + count - 1, false );
+    int checked = min( static_cast< size_t >( count ),
+                       mapped_ >= static_cast< size_t >( first )
+                           ? mapped_ - first + 1 : 0 );
+
+    bool passed = true;
+    for( int i = 0; i < checked; i++ )
+        passed = check( first + i, recs[i], map_[ first - 1 + i ] ) && passed;
+    return passed;
+} // end function verify
+
+// copy the stored checksums of a range of records
+void RecordChecksums::load( int first, int count, uint32_t *sums )
+{
+    int copied = 0;
+    if( count > 0 && attach() )
+    {
+        reserve( first + count - 1, false );
+        copied = min( static_cast< size_t >( count ),
+                      mapped_ >= static_cast< size_t >( first )
+                          ? mapped_ - first + 1 : 0 );
+        if( copied > 0 )
+            memcpy( sums, map_ + first - 1, copied * sizeof( uint32_t ) );
+    }
+    for( ; copied < count; copied++ )
+        sums[ copied ] = 0;
+} // end function load
+
+// check a record against a stored checksum
+bool RecordChecksums::check( int recordNumber, const Student &rec,
+                             uint32_t stored )
+{
+    if( stored == 0 || stored == recordChecksum( &rec, sizeof( Student ) ) )
+    {
+        return true;
+    }
+    cerr << "warning: record " << recordNumber
+        << " fails its checksum!" << endl;
+    ++failures_;
+    return false;
+} // end function check
+
+// write the changed checksums to disk
+bool RecordChecksums::sync()
+{
+    return map_ == 0
+           || msync( map_, mapped_ * sizeof( uint32_t ), MS_SYNC ) == 0;
+} // end function sync
+
+// write a checksum file for all records of a file
+bool buildChecksums( fstream &inFile, const char *fileName )
+{
+    int recordCount = getRecordCount( inFile );
+    int fd = ::open( fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( fd < 0 )
+    {
+        return false;
+    }
+
+    // the records are read as they are in the file, without
+    // checking them against the checksums being replaced
+    vector< Student > batch( BUILD_RECORDS );
+    vector< uint32_t > sums( BUILD_RECORDS );
+    bool written = true;
+    for( int first = 1; written && first <= recordCount; first += BUILD_RECORDS )
+    {
+        int wanted = min( BUILD_RECORDS, recordCount - first + 1 );
+        inFile.seekg( recordPosition( first ) );
+        inFile.read( reinterpret_cast< char * >( &batch[0] ),
+                     static_cast< streamsize >( wanted ) * sizeof( Student ) );
+        int records = inFile.gcount() / sizeof( Student );
+        inFile.clear();
+
+        for( int i = 0; i < records; i++ )
+            sums[i] = recordChecksum( &batch[i], sizeof( Student ) );
+        ssize_t bytes = records * sizeof( uint32_t );
+        written = write( fd, &sums[0], bytes ) == bytes;
+        // counted records missing from the file have no checksum
+        if( records < wanted )
+            break;
+    }
+    written = fsync( fd ) == 0 && written;
+    ::close( fd );
+
+    // a mapping of the file replaced is dropped
+    recordChecksums.close();
+    return written;
+} // end function buildChecksums
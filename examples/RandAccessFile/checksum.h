@@ -0,0 +1,84 @@
+// checksum.h
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <fstream>
+#include <stdint.h>
+#include "record.h"
+using namespace std;
+
+// file name of the record checksums of the records file
+const char CHECKSUM_FILE[] = "students.crc";
+
+// CRC32C (Castagnoli) of a block of bytes, with the SSE4.2 crc32
+// instruction when the processor has it, else by table
+uint32_t crc32c( const void *, size_t );
+// checksum stored for a record of a number of bytes, never zero
+uint32_t recordChecksum( const void *, size_t );
+
+// checksums of the records, kept next to the records file. the
+// file is optional: while it does not exist the records are not
+// checked. it holds one CRC32C per record, indexed by record number,
+// and is mapped in place, so a record written costs a CRC and a
+// store, and a record read costs a CRC and a load.
+//
+// a checksum is written and checked under the record lock of its
+// record, so readers never see a record and a checksum of two
+// different writes. a zero checksum stands for "not recorded yet".
+class RecordChecksums
+{
+public:
+    RecordChecksums();
+    // unmap the file
+    ~RecordChecksums();
+
+    // map the checksum file, false if there is none
+    bool open( const char * = CHECKSUM_FILE );
+    // unmap the file, it is mapped again on next use
+    void close();
+    // unmap the file, no records are checked until open()
+    void detach();
+    bool isOpen() const { return fd_ >= 0; }
+
+    // record the checksums of a range of records being written
+    void update( int, int, const Student * );
+    // check a range of records read, warn about and count each
+    // record that fails, return false if any does
+    bool verify( int, int, const Student * );
+    // copy the stored checksums of a range of records, zero for
+    // records that have none, to check the records later
+    void load( int, int, uint32_t * );
+    // check a record against a checksum copied by load()
+    bool check( int, const Student &, uint32_t );
+    // write the changed checksums to disk
+    bool sync();
+
+    // records that failed their checksum
+    long getFailures() const { return failures_; }
+
+private:
+    // a mapping has a single owner
+    RecordChecksums( const RecordChecksums & );
+    RecordChecksums &operator=( const RecordChecksums & );
+
+    // open the file on first use, if it exists
+    bool attach();
+    // map at least a number of records, growing the file if asked
+    bool reserve( int, bool );
+
+    int fd_;
+    bool writable_;
+    bool tried_;              // open was tried since the last close
+    uint32_t *map_;
+    size_t mapped_;           // records covered by the mapping
+    long failures_;
+};
+
+// checksums of the records file used by the tools
+extern RecordChecksums recordChecksums;
+
+// write a checksum file for all records of a file
+bool buildChecksums( fstream &, const char * = CHECKSUM_FILE );
+
+#endif
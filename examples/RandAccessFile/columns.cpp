@@ -0,0 +1,172 @@
+// columns.cpp
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "columns.h"
+
+/**
+ *  StudentColumns member functions
+ */
+
+// load the records in use from a store
+void StudentColumns::load( const StudentStore &store )
+{
+    ids.clear();
+    scores.clear();
+    names.clear();
+    ids.reserve( store.getRecordCount() );
+    scores.reserve( store.getRecordCount() );
+    names.reserve( store.getRecordCount() * NAME_LENGTH );
+
+    for( StudentStore::const_iterator rec = store.begin();
+         rec != store.end(); ++rec )
+    {
+        if( isDeletedRecord( *rec ) )
+            continue;
+
+        ids.push_back( rec->getID() );
+        scores.push_back( rec->getScore() );
+        // fixed width name column, zero padded
+        string name = rec->getName();
+        name.resize( NAME_LENGTH, '\0' );
+        names.insert( names.end(), name.begin(), name.end() );
+    }
+} // end function load
+
+// name of a row as a string
+string StudentColumns::nameAt( int row ) const
+{
+    const char *name = &names[ row * NAME_LENGTH ];
+    return string( name, strnlen( name, NAME_LENGTH ) );
+} // end function nameAt
+
+/**
+ *  score aggregation kernels
+ */
+
+// sum of scores, accumulated in double precision
+double sumScores( const float *scores, int count )
+{
+    int i = 0;
+    double sum = 0.0;
+#ifdef __SSE2__
+    // four scores per step, widened to two pairs of doubles
+    __m128d low = _mm_setzero_pd(), high = _mm_setzero_pd();
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 v = _mm_loadu_ps( scores + i );
+        low = _mm_add_pd( low, _mm_cvtps_pd( v ) );
+        high = _mm_add_pd( high, _mm_cvtps_pd( _mm_movehl_ps( v, v ) ) );
+    }
+    double lanes[2];
+    _mm_storeu_pd( lanes, _mm_add_pd( low, high ) );
+    sum = lanes[0] + lanes[1];
+#endif
+    // remaining scores one at a time
+    for( ; i < count; i++ )
+        sum += scores[i];
+    return sum;
+} // end function sumScores
+
+// lowest score, 0 for no scores
+float minScore( const float *scores, int count )
+{
+    if( count == 0 )
+        return 0.0f;
+
+    int i = 0;
+    float result = scores[0];
+#ifdef __SSE2__
+    if( count >= 4 )
+    {
+        __m128 lowest = _mm_loadu_ps( scores );
+        for( i = 4; i + 4 <= count; i += 4 )
+            lowest = _mm_min_ps( lowest, _mm_loadu_ps( scores + i ) );
+        float lanes[4];
+        _mm_storeu_ps( lanes, lowest );
+        result = min( min( lanes[0], lanes[1] ), min( lanes[2], lanes[3] ) );
+    }
+#endif
+    for( ; i < count; i++ )
+        result = min( result, scores[i] );
+    return result;
+} // end function minScore
+
+// highest score, 0 for no scores
+float maxScore( const float *scores, int count )
+{
+    if( count == 0 )
+        return 0.0f;
+
+    int i = 0;
+    float result = scores[0];
+#ifdef __SSE2__
+    if( count >= 4 )
+    {
+        __m128 highest = _mm_loadu_ps( scores );
+        for( i = 4; i + 4 <= count; i += 4 )
+            highest = _mm_max_ps( highest, _mm_loadu_ps( scores + i ) );
+        float lanes[4];
+        _mm_storeu_ps( lanes, highest );
+        result = max( max( lanes[0], lanes[1] ), max( lanes[2], lanes[3] ) );
+    }
+#endif
+    for( ; i < count; i++ )
+        result = max( result, scores[i] );
+    return result;
+} // end function maxScore
+
+// count scores in equal width bins over [0, 100]
+void scoreHistogram( const float *scores, int count, int *bins, int binCount )
+{
+    fill( bins, bins + binCount, 0 );
+    const float scale = binCount / 100.0f;
+
+    int i = 0;
+#ifdef __SSE2__
+    // compute four bin numbers at a time, clamped to the last bin
+    const __m128 vscale = _mm_set1_ps( scale );
+    const __m128i last = _mm_set1_epi32( binCount - 1 );
+    const __m128i zero = _mm_setzero_si128();
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128i bin = _mm_cvttps_epi32(
+                _mm_mul_ps( _mm_loadu_ps( scores + i ), vscale ) );
+        // min/max of 32 bit lanes with compare and select
+        __m128i over = _mm_cmpgt_epi32( bin, last );
+        bin = _mm_or_si128( _mm_and_si128( over, last ),
+                            _mm_andnot_si128( over, bin ) );
+        bin = _mm_andnot_si128( _mm_cmplt_epi32( bin, zero ), bin );
+
+        int lanes[4];
+        _mm_storeu_si128( reinterpret_cast< __m128i * >( lanes ), bin );
+        ++bins[ lanes[0] ];
+        ++bins[ lanes[1] ];
+        ++bins[ lanes[2] ];
+        ++bins[ lanes[3] ];
+    }
+#endif
+    for( ; i < count; i++ )
+    {
+        int bin = static_cast< int >( scores[i] * scale );
+        bin = max( 0, min( bin, binCount - 1 ) );
+        ++bins[ bin ];
+    }
+} // end function scoreHistogram
+
+// score at a percentile (0 - 100), nearest rank
+float scorePercentile( const float *scores, int count, double percentile )
+{
+    if( count == 0 )
+        return 0.0f;
+
+    // partial sort of a copy, the column stays in row order
+    vector< float > sorted( scores, scores + count );
+    int rank = static_cast< int >( ceil( percentile / 100.0 * count ) );
+    rank = max( 1, min( rank, count ) );
+    nth_element( sorted.begin(), sorted.begin() + ( rank - 1 ), sorted.end() );
+    return sorted[ rank - 1 ];
+} // end function scorePercentile
@@ -0,0 +1,40 @@
+// columns.h
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <vector>
+#include "record.h"
+#include "store.h"
+using namespace std;
+
+// Student records split into one contiguous array per field
+// (structure of arrays). an aggregate over scores then reads
+// only scores, instead of every byte of the 40 byte records.
+class StudentColumns
+{
+public:
+    // load the records in use from a store
+    void load( const StudentStore & );
+
+    // number of rows (records in use)
+    int size() const { return static_cast< int >( ids.size() ); }
+    // name of a row as a string
+    string nameAt( int row ) const;
+
+    vector< int > ids;      // record ids
+    vector< float > scores; // record scores
+    vector< char > names;   // NAME_LENGTH chars per row
+};
+
+// score aggregation kernels, vectorized with SSE2 where available
+// sum of scores, accumulated in double precision
+double sumScores( const float *, int );
+// lowest and highest score, 0 for no scores
+float minScore( const float *, int );
+float maxScore( const float *, int );
+// count scores in equal width bins over [0, 100]
+void scoreHistogram( const float *, int, int *, int );
+// score at a percentile (0 - 100), nearest rank
+float scorePercentile( const float *, int, double );
+
+#endif
@@ -0,0 +1,187 @@
+// compact.cpp
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fileheader.h"
+#include "compact.h"
+
+// first bytes of a compact records file
+static const char COMPACT_MAGIC[8] = { 'S', 'T', 'U', 'D', 'C', 'O', 'M', 'P' };
+// version of the compact file format
+static const uint32_t COMPACT_VERSION = 1;
+
+// round a byte count up to the next 8 byte boundary
+static size_t align8( size_t bytes )
+{
+    return ( bytes + 7 ) & ~static_cast< size_t >( 7 );
+} // end function align8
+
+// byte offsets of the columns of a compact file, and its length
+struct CompactLayout
+{
+    CompactLayout( size_t recordCount, size_t heapSize )
+    {
+        ids = align8( sizeof( CompactHeader ) );
+        scores = ids + align8( recordCount * sizeof( int32_t ) );
+        nameOffsets = scores + align8( recordCount * sizeof( float ) );
+        names = nameOffsets + align8( ( recordCount + 1 ) * sizeof( uint32_t ) );
+        length = names + heapSize;
+    }
+
+    size_t ids;
+    size_t scores;
+    size_t nameOffsets;
+    size_t names;
+    size_t length;
+};
+
+// create a closed store
+CompactStore::CompactStore()
+    : map_(0), length_(0), recordCount_(0),
+      ids_(0), scores_(0), nameOffsets_(0), names_(0)
+{
+} // end CompactStore constructor
+
+// unmap the file
+CompactStore::~CompactStore()
+{
+    close();
+} // end CompactStore destructor
+
+// map a compact file
+bool CompactStore::open( const string &fileName )
+{
+    close();
+
+    int fd = ::open( fileName.c_str(), O_RDONLY );
+    struct stat info;
+    CompactHeader header;
+    if( fd < 0 || fstat( fd, &info ) < 0
+        || pread( fd, &header, sizeof( CompactHeader ), 0 )
+               != static_cast< ssize_t >( sizeof( CompactHeader ) )
+        || memcmp( header.magic, COMPACT_MAGIC, sizeof( COMPACT_MAGIC ) ) != 0
+        || header.version != COMPACT_VERSION
+        || header.byteOrder != BYTE_ORDER_MARK
+        || header.recordCount < 0 || header.heapSize < 0 )
+    {
+        if( fd >= 0 )
+            ::close( fd );
+        return false;
+    }
+
+    // a file shorter than its columns is not mapped
+    CompactLayout layout( header.recordCount, header.heapSize );
+    if( static_cast< size_t >( info.st_size ) < layout.length )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    void *map = mmap( 0, layout.length, PROT_READ, MAP_SHARED, fd, 0 );
+    // the mapping stays valid after the descriptor is closed
+    ::close( fd );
+    if( map == MAP_FAILED )
+    {
+        return false;
+    }
+    madvise( map, layout.length, MADV_SEQUENTIAL );
+
+    const char *base = static_cast< const char * >( map );
+    map_ = map;
+    length_ = layout.length;
+    recordCount_ = header.recordCount;
+    ids_ = reinterpret_cast< const int32_t * >( base + layout.ids );
+    scores_ = reinterpret_cast< const float * >( base + layout.scores );
+    nameOffsets_ =
+        reinterpret_cast< const uint32_t * >( base + layout.nameOffsets );
+    names_ = base + layout.names;
+    return true;
+} // end function open
+
+// unmap the file
+void CompactStore::close()
+{
+    if( map_ != 0 )
+    {
+        munmap( map_, length_ );
+    }
+    map_ = 0;
+    length_ = 0;
+    recordCount_ = 0;
+    ids_ = 0;
+    scores_ = 0;
+    nameOffsets_ = 0;
+    names_ = 0;
+} // end function close
+
+// the whole record at a (record numbered) location
+Student CompactStore::getRecord( int recordNumber ) const
+{
+    return Student( getID( recordNumber ), getName( recordNumber ),
+                    getScore( recordNumber ) );
+} // end function getRecord
+
+// write the records of a store as a compact file, deleted records
+// keep their rows so every record keeps its record number
+bool writeCompactFile( const StudentStore &store, const string &fileName )
+{
+    size_t recordCount = store.getRecordCount();
+    vector< int32_t > ids;
+    vector< float > scores;
+    vector< uint32_t > nameOffsets;
+    string names;
+    ids.reserve( recordCount );
+    scores.reserve( recordCount );
+    nameOffsets.reserve( recordCount + 1 );
+
+    for( StudentStore::const_iterator rec = store.begin();
+         rec != store.end(); ++rec )
+    {
+        nameOffsets.push_back( names.size() );
+        ids.push_back( rec->getID() );
+        scores.push_back( rec->getScore() );
+        names += rec->getName();
+    }
+    nameOffsets.push_back( names.size() );
+    // heap offsets are 32 bit
+    if( names.size() > 0xffffffffu )
+    {
+        return false;
+    }
+
+    CompactHeader header;
+    memset( &header, 0, sizeof( CompactHeader ) );
+    memcpy( header.magic, COMPACT_MAGIC, sizeof( COMPACT_MAGIC ) );
+    header.version = COMPACT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.recordCount = recordCount;
+    header.heapSize = names.size();
+
+    // each column is written at its offset, the gaps read as zeros
+    CompactLayout layout( recordCount, names.size() );
+    fstream fout( fileName.c_str(), ios::out | ios::trunc | ios::binary );
+    fout.write( reinterpret_cast< const char * >( &header ),
+                sizeof( CompactHeader ) );
+    if( recordCount > 0 )
+    {
+        fout.seekp( layout.ids );
+        fout.write( reinterpret_cast< const char * >( &ids[0] ),
+                    recordCount * sizeof( int32_t ) );
+        fout.seekp( layout.scores );
+        fout.write( reinterpret_cast< const char * >( &scores[0] ),
+                    recordCount * sizeof( float ) );
+    }
+    fout.seekp( layout.nameOffsets );
+    fout.write( reinterpret_cast< const char * >( &nameOffsets[0] ),
+                nameOffsets.size() * sizeof( uint32_t ) );
+    fout.seekp( layout.names );
+    fout.write( names.data(), names.size() );
+    fout.close();
+
+    return !fout.fail();
+} // end function writeCompactFile
@@ -0,0 +1,87 @@
+// compact.h
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include <cstddef>
+#include <string>
+#include <stdint.h>
+#include "record.h"
+#include "store.h"
+using namespace std;
+
+// file name of the compact copy of the records file
+const char COMPACT_FILE[] = "students.cmp";
+
+// header of a compact records file. the columns follow it in
+// this order, each starting on an 8 byte boundary:
+//   int32_t ids[ recordCount ]
+//   float scores[ recordCount ]
+//   uint32_t nameOffsets[ recordCount + 1 ]  (into the name heap)
+//   char names[ heapSize ]                   (no terminators)
+struct CompactHeader
+{
+    char magic[8];          // "STUDCOMP"
+    uint32_t version;       // COMPACT_VERSION
+    uint32_t byteOrder;     // BYTE_ORDER_MARK
+    int64_t recordCount;    // rows, deleted records included
+    int64_t heapSize;       // bytes of the name heap
+};
+
+// read-only view of a compact records file. numbers are kept in
+// fixed width columns and names in a heap of only the bytes they
+// use, so a short name takes a few bytes instead of NAME_LENGTH.
+// a row keeps its record number, so access by number stays O(1):
+// the name of a record lies between two adjacent heap offsets.
+class CompactStore
+{
+public:
+    // create a closed store
+    CompactStore();
+    // unmap the file
+    ~CompactStore();
+
+    // map a compact file, return false on failure
+    bool open( const string & );
+    // unmap the file
+    void close();
+    bool isOpen() const { return map_ != 0; }
+
+    // number of records, deleted ones included
+    int getRecordCount() const { return recordCount_; }
+
+    // fields of a (record numbered) location, no bounds check
+    int getID( int recordNumber ) const { return ids_[ recordNumber - 1 ]; }
+    float getScore( int recordNumber ) const
+    {
+        return scores_[ recordNumber - 1 ];
+    }
+    string getName( int recordNumber ) const
+    {
+        return string( names_ + nameOffsets_[ recordNumber - 1 ],
+                       nameOffsets_[ recordNumber ]
+                       - nameOffsets_[ recordNumber - 1 ] );
+    }
+    // the whole record at a (record numbered) location
+    Student getRecord( int ) const;
+
+    // the score column, for the kernels in columns.h
+    const float *scores() const { return scores_; }
+
+private:
+    // a mapping has a single owner
+    CompactStore( const CompactStore & );
+    CompactStore &operator=( const CompactStore & );
+
+    void *map_;               // start of the mapping
+    size_t length_;           // length of the mapping (bytes)
+    int recordCount_;
+    const int32_t *ids_;
+    const float *scores_;
+    const uint32_t *nameOffsets_;
+    const char *names_;
+};
+
+// write the records of a store as a compact file
+bool writeCompactFile( const StudentStore &, const string & );
+
+#endif
@@ -0,0 +1,174 @@
+// fileheader.cpp
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fileheader.h"
+#include "lock.h"
+
+// first bytes of every records file
+static const char FILE_MAGIC[8] = { 'S', 'T', 'U', 'D', 'E', 'N', 'T', 'S' };
+
+// the header must be exactly as large as the space before the records
+typedef char FileHeaderSizeCheck[ sizeof( FileHeader ) == FILE_HEADER_SIZE ? 1 : -1 ];
+
+// header for a file of a number of Student records
+FileHeader makeFileHeader( int recordCount )
+{
+    FileHeader header;
+    // zero fill so unused bytes are the same in every file
+    memset( &header, 0, sizeof( FileHeader ) );
+    memcpy( header.magic, FILE_MAGIC, sizeof( FILE_MAGIC ) );
+    header.version = FILE_VERSION;
+    header.headerSize = FILE_HEADER_SIZE;
+    header.recordSize = sizeof( Student );
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.layoutHash = Student::layoutHash();
+    header.recordCount = recordCount;
+    return header;
+} // end function makeFileHeader
+
+// check a header describes records of this program
+bool checkFileHeader( const FileHeader &header, string &reason )
+{
+    stringstream ss;
+    if( memcmp( header.magic, FILE_MAGIC, sizeof( FILE_MAGIC ) ) != 0 )
+        ss << "the file has no records header, run UpgradeRAFile on it";
+    else if( header.byteOrder != BYTE_ORDER_MARK )
+        ss << "the file was written on a host of another byte order";
+    else if( header.version != FILE_VERSION )
+        ss << "the file format version " << header.version
+            << " is not supported";
+    else if( header.headerSize != FILE_HEADER_SIZE
+             || header.recordSize != sizeof( Student )
+             || header.layoutHash != Student::layoutHash() )
+        ss << "the records of the file have another layout";
+    else if( header.recordCount < 0 )
+        ss << "the record count of the file is corrupt";
+
+    reason = ss.str();
+    return reason.empty();
+} // end function checkFileHeader
+
+// read the header of a records file
+bool readFileHeader( fstream &inFile, FileHeader &header )
+{
+    if( recordLocks.isOpen() )
+        recordLocks.lockHeader( SHARED_LOCK );
+    inFile.clear();
+    inFile.seekg( 0 );
+    inFile.read( reinterpret_cast< char * >( &header ), sizeof( FileHeader ) );
+    bool complete = inFile.gcount() == sizeof( FileHeader );
+    // a file shorter than a header leaves the stream failed
+    inFile.clear();
+    if( recordLocks.isOpen() )
+        recordLocks.unlockHeader();
+    return complete;
+} // end function readFileHeader
+
+// write a new header for a number of records
+bool writeFileHeader( fstream &outFile, int recordCount )
+{
+    FileHeader header = makeFileHeader( recordCount );
+    outFile.seekp( 0 );
+    outFile.write( reinterpret_cast< const char * >( &header ),
+                   sizeof( FileHeader ) );
+    outFile.flush();
+    return outFile.good();
+} // end function writeFileHeader
+
+// check the header of a records file
+bool checkRecordFile( fstream &inFile, string &reason )
+{
+    FileHeader header;
+    if( !readFileHeader( inFile, header ) )
+    {
+        // an old file too short to hold a header
+        reason = "the file has no records header, run UpgradeRAFile on it";
+        return false;
+    }
+    return checkFileHeader( header, reason );
+} // end function checkRecordFile
+
+// raise the record count in the header to cover a record. the count
+// only grows, so a writer never hides a record another one appended
+bool extendRecordCount( fstream &ioFile, int recordNumber )
+{
+    const streamoff countOffset = offsetof( FileHeader, recordCount );
+    int64_t recordCount = 0;
+
+    if( recordLocks.isOpen() )
+        recordLocks.lockHeader( EXCLUSIVE_LOCK );
+    ioFile.clear();
+    ioFile.seekg( countOffset );
+    ioFile.read( reinterpret_cast< char * >( &recordCount ),
+                 sizeof( recordCount ) );
+    if( ioFile.good() && recordCount < recordNumber )
+    {
+        recordCount = recordNumber;
+        ioFile.seekp( countOffset );
+        ioFile.write( reinterpret_cast< const char * >( &recordCount ),
+                      sizeof( recordCount ) );
+        ioFile.flush();
+    }
+    bool written = ioFile.good();
+    if( recordLocks.isOpen() )
+        recordLocks.unlockHeader();
+    return written;
+} // end function extendRecordCount
+
+// rewrite a records file without a header with a header in
+// front of its records, renamed over the old file when complete
+bool upgradeRecordFile( const string &fileName )
+{
+    int inFd = open( fileName.c_str(), O_RDONLY );
+    struct stat info;
+    if( inFd < 0 || fstat( inFd, &info ) < 0 )
+    {
+        if( inFd >= 0 )
+            close( inFd );
+        return false;
+    }
+
+    // an old file holds whole records only, and no header
+    char magic[ sizeof( FILE_MAGIC ) ];
+    if( info.st_size % sizeof( Student ) != 0
+        || ( pread( inFd, magic, sizeof( magic ), 0 ) == sizeof( magic )
+             && memcmp( magic, FILE_MAGIC, sizeof( magic ) ) == 0 ) )
+    {
+        close( inFd );
+        return false;
+    }
+
+    const string tempName = fileName + ".tmp";
+    int outFd = open( tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( outFd < 0 )
+    {
+        close( inFd );
+        return false;
+    }
+
+    FileHeader header = makeFileHeader( info.st_size / sizeof( Student ) );
+    bool written = write( outFd, &header, sizeof( FileHeader ) )
+                   == sizeof( FileHeader );
+
+    // copy the records behind the header in large blocks
+    vector< char > buffer( 1 << 20 );
+    ssize_t bytes = 0;
+    while( written && ( bytes = read( inFd, &buffer[0], buffer.size() ) ) > 0 )
+        written = write( outFd, &buffer[0], bytes ) == bytes;
+    written = written && bytes == 0 && fsync( outFd ) == 0;
+
+    close( outFd );
+    close( inFd );
+    if( !written || rename( tempName.c_str(), fileName.c_str() ) != 0 )
+    {
+        unlink( tempName.c_str() );
+        return false;
+    }
+    return true;
+} // end function upgradeRecordFile
@@ -0,0 +1,55 @@
+// fileheader.h
+#ifndef FILEHEADER_H
+#define FILEHEADER_H
+
+#include <fstream>
+#include <string>
+#include <stdint.h>
+#include "record.h"
+using namespace std;
+
+// bytes before the first record of a records file
+const int FILE_HEADER_SIZE = 64;
+// version of the records file format written by the tools
+const uint32_t FILE_VERSION = 1;
+// stored as written by the host, reads back swapped on a host
+// of the other byte order
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// the header at the start of a records file. it describes the
+// records that follow, so a file written with another record
+// layout is refused instead of being read as garbage, and it holds
+// the record count, so the count is not worked out from the size.
+struct FileHeader
+{
+    char magic[8];          // "STUDENTS"
+    uint32_t version;       // FILE_VERSION
+    uint32_t headerSize;    // FILE_HEADER_SIZE
+    uint32_t recordSize;    // sizeof( Student )
+    uint32_t byteOrder;     // BYTE_ORDER_MARK
+    uint32_t layoutHash;    // Student::layoutHash()
+    uint32_t reserved;
+    int64_t recordCount;    // records in the file
+    char unused[ FILE_HEADER_SIZE - 40 ];
+};
+
+// header for a file of a number of Student records
+FileHeader makeFileHeader( int );
+// check a header describes records of this program, with the
+// reason in the string if it does not
+bool checkFileHeader( const FileHeader &, string & );
+
+// read the header of a records file
+bool readFileHeader( fstream &, FileHeader & );
+// write a new header for a number of records
+bool writeFileHeader( fstream &, int );
+// check the header of a records file, with the reason if it is bad
+bool checkRecordFile( fstream &, string & );
+// raise the record count in the header to cover a record
+bool extendRecordCount( fstream &, int );
+
+// rewrite a records file without a header (the format before
+// FILE_VERSION 1) with a header in front of its records
+bool upgradeRecordFile( const string & );
+
+#endif
@@ -0,0 +1,296 @@
+// freemap.cpp
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "freemap.h"
+#include "fileheader.h"
+
+// free-slot bitmap of the records file used by the tools
+FreeSlotMap freeSlots;
+
+// take the exclusive lock of the bitmap file, return the descriptor
+// that holds it (-1 if there is no bitmap file yet)
+static int lockMap()
+{
+    int fd = open( FREE_MAP_FILE, O_RDONLY );
+    if( fd >= 0 )
+    {
+        flock( fd, LOCK_EX );
+    }
+    return fd;
+} // end function lockMap
+
+// create an empty, unloaded bitmap
+FreeSlotMap::FreeSlotMap() : loaded_(false), recordCount_(0)
+{
+} // end FreeSlotMap constructor
+
+// load the bitmap for the records file
+bool FreeSlotMap::load( fstream &inFile )
+{
+    // no other process changes the bitmap while it is read or rebuilt
+    int lock = lockMap();
+    recordCount_ = ::getRecordCount( inFile );
+    size_t words = ( recordCount_ + 63 ) / 64;
+    bits_.assign( words, 0 );
+    freeList_.clear();
+
+    file_.close();
+    file_.clear();
+    file_.open( FREE_MAP_FILE, ios::in | ios::out | ios::binary );
+
+    bool current = false;
+    if( file_ )
+    {
+        file_.seekg( 0, ios::end );
+        // a bitmap of another size belongs to another file
+        if( static_cast< size_t >( file_.tellg() ) == words * sizeof( uint64_t ) )
+        {
+            if( words > 0 )
+            {
+                file_.seekg( 0 );
+                file_.read( reinterpret_cast< char * >( &bits_[0] ),
+                            words * sizeof( uint64_t ) );
+            }
+            current = file_.good();
+        }
+    }
+
+    if( !current )
+    {
+        bits_.assign( words, 0 );
+        build( inFile );
+        if( !save() )
+        {
+            if( lock >= 0 )
+                close( lock );
+            return false;
+        }
+    }
+    if( lock >= 0 )
+        close( lock );
+
+    // stack the free slots, lowest record number on top
+    for( int recordNumber = recordCount_; recordNumber >= 1; recordNumber-- )
+    {
+        if( isFree( recordNumber ) )
+            freeList_.push_back( recordNumber );
+    }
+
+    loaded_ = true;
+    return true;
+} // end function load
+
+// build the bitmap by reading all records
+void FreeSlotMap::build( fstream &inFile )
+{
+    const int batchSize = 4096;  // records per read
+    vector< Student > batch( batchSize );
+
+    for( int first = 1; first <= recordCount_; first += batchSize )
+    {
+        int records = readRecords( inFile, first, batchSize, &batch[0] );
+        // counted records not yet in the file are free
+        fill( batch.begin() + records, batch.end(), Student() );
+        records = min( batchSize, recordCount_ - first + 1 );
+        for( int i = 0; i < records; i++ )
+        {
+            if( isDeletedRecord( batch[i] ) )
+            {
+                int slot = first + i - 1;
+                bits_[ slot / 64 ] |= uint64_t( 1 ) << ( slot % 64 );
+            }
+        }
+    }
+} // end function build
+
+// write the whole bitmap to the file
+bool FreeSlotMap::save()
+{
+    file_.close();
+    file_.clear();
+    file_.open( FREE_MAP_FILE, ios::in | ios::out | ios::trunc | ios::binary );
+    if( !file_ )
+    {
+        return false;
+    }
+    if( !bits_.empty() )
+    {
+        file_.write( reinterpret_cast< const char * >( &bits_[0] ),
+                     bits_.size() * sizeof( uint64_t ) );
+    }
+    file_.flush();
+    return file_.good();
+} // end function save
+
+// set the bit of a slot and write its word to the file, the caller
+// holds the lock of the bitmap file and has re-read the word
+void FreeSlotMap::setFree( int recordNumber, bool free )
+{
+    int slot = recordNumber - 1;
+    uint64_t mask = uint64_t( 1 ) << ( slot % 64 );
+    uint64_t &word = bits_[ slot / 64 ];
+
+    if( free )
+        word |= mask;
+    else
+        word &= ~mask;
+
+    // only the changed word goes to the file
+    writeWord( slot / 64 );
+} // end function setFree
+
+// re-read a word of the bitmap from the file
+bool FreeSlotMap::refreshWord( int lock, size_t index )
+{
+    uint64_t word;
+    if( lock < 0
+        || pread( lock, &word, sizeof( word ), index * sizeof( uint64_t ) )
+           != static_cast< ssize_t >( sizeof( word ) ) )
+    {
+        return false;
+    }
+    bits_[ index ] = word;
+    return true;
+} // end function refreshWord
+
+// write a word of the bitmap to the file
+void FreeSlotMap::writeWord( size_t index )
+{
+    file_.clear();
+    file_.seekp( static_cast< streamoff >( index ) * sizeof( uint64_t ) );
+    file_.write( reinterpret_cast< const char * >( &bits_[ index ] ),
+                 sizeof( uint64_t ) );
+    file_.flush();
+} // end function writeWord
+
+// cover the slots up to a record count
+void FreeSlotMap::growTo( int lock, int recordCount )
+{
+    for( int slot = recordCount_; slot < recordCount; slot++ )
+    {
+        size_t index = slot / 64;
+        if( index >= bits_.size() )
+        {
+            bits_.push_back( 0 );
+        }
+        // another process may have added the slots, and freed some
+        if( slot == recordCount_ || slot % 64 == 0 )
+        {
+            // a word new to the file starts with every slot in use
+            if( !refreshWord( lock, index ) )
+                writeWord( index );
+        }
+        if( isFree( slot + 1 ) )
+        {
+            freeList_.push_back( slot + 1 );
+        }
+    }
+    recordCount_ = max( recordCount_, recordCount );
+} // end function growTo
+
+// mark a slot free and make it available for reuse
+void FreeSlotMap::markFree( int recordNumber )
+{
+    int lock = lockMap();
+    refreshWord( lock, ( recordNumber - 1 ) / 64 );
+    if( !isFree( recordNumber ) )
+    {
+        setFree( recordNumber, true );
+        freeList_.push_back( recordNumber );
+    }
+    if( lock >= 0 )
+        close( lock );
+} // end function markFree
+
+// mark a slot in use, its free list entry goes stale
+void FreeSlotMap::markUsed( int recordNumber )
+{
+    int lock = lockMap();
+    refreshWord( lock, ( recordNumber - 1 ) / 64 );
+    if( isFree( recordNumber ) )
+    {
+        setFree( recordNumber, false );
+    }
+    if( lock >= 0 )
+        close( lock );
+} // end function markUsed
+
+// claim a slot for a new record
+int FreeSlotMap::claimSlot( fstream &ioFile )
+{
+    int lock = lockMap();
+    // other processes may have appended slots since the bitmap was read
+    growTo( lock, ::getRecordCount( ioFile ) );
+
+    // reuse the slot of a deleted record in O(1), skipping slots that
+    // were reused since they were freed, here or by another process
+    int recordNumber = 0;
+    while( recordNumber == 0 && !freeList_.empty() )
+    {
+        int slot = freeList_.back();
+        freeList_.pop_back();
+        refreshWord( lock, ( slot - 1 ) / 64 );
+        if( isFree( slot ) )
+        {
+            recordNumber = slot;
+        }
+    }
+
+    bool claimed;
+    if( recordNumber != 0 )
+    {
+        // in use from now on, though the record is written later
+        setFree( recordNumber, false );
+        claimed = file_.good();
+    }
+    else
+    {
+        // a new slot at the end of the file, counted in the header
+        // from now on, though the record is written later
+        recordNumber = recordCount_ + 1;
+        growTo( lock, recordNumber );
+        claimed = file_.good() && extendRecordCount( ioFile, recordNumber );
+    }
+
+    if( lock >= 0 )
+        close( lock );
+    return claimed ? recordNumber : 0;
+} // end function claimSlot
+
+// cover the slots up to a record appended at the end of the file
+void FreeSlotMap::extendTo( int recordNumber )
+{
+    if( recordCount_ < recordNumber )
+    {
+        int lock = lockMap();
+        growTo( lock, recordNumber );
+        if( lock >= 0 )
+            close( lock );
+    }
+} // end function extendTo
+
+// first record in use at or after a record number
+int FreeSlotMap::nextUsed( int recordNumber ) const
+{
+    int slot = recordNumber - 1;
+    while( slot < recordCount_ )
+    {
+        // free bits of the rest of the current word
+        uint64_t free = bits_[ slot / 64 ] >> ( slot % 64 );
+        if( ( free & 1 ) == 0 )
+        {
+            return slot + 1;
+        }
+        if( ~free == 0 )
+        {
+            // a whole word of free slots, skip to the next word
+            slot = ( slot / 64 + 1 ) * 64;
+            continue;
+        }
+        // count the free slots before the next one in use
+        slot += __builtin_ctzll( ~free );
+    }
+    return recordCount_ + 1;
+} // end function nextUsed
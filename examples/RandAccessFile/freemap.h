@@ -0,0 +1,79 @@
+// freemap.h
+#ifndef FREEMAP_H
+#define FREEMAP_H
+
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+#include "record.h"
+using namespace std;
+
+// file name of the free-slot bitmap of the records file
+const char FREE_MAP_FILE[] = "students.map";
+
+// bitmap of deleted (free) record slots, persisted next to the
+// records file. one bit per record, set when the slot is free.
+// a stack of free slots gives O(1) slot reuse on insert, and scans
+// skip a whole word (64 records) of deleted slots at a time.
+//
+// every process keeps its own copy of the bitmap, so each change
+// re-reads its word under an exclusive lock (flock) of the bitmap
+// file, and a slot is claimed for an insert under the same lock.
+class FreeSlotMap
+{
+public:
+    FreeSlotMap();
+
+    // load the bitmap for the records file, rebuilding it
+    // from the records if it is missing or out of date
+    bool load( fstream & );
+    bool isLoaded() const { return loaded_; }
+
+    // number of record slots covered by the bitmap
+    int getRecordCount() const { return recordCount_; }
+    // check if a (record numbered) slot is free
+    bool isFree( int recordNumber ) const
+    {
+        --recordNumber;
+        return ( bits_[ recordNumber / 64 ] >> ( recordNumber % 64 ) ) & 1;
+    }
+    // mark a slot free or in use and persist the change
+    void markFree( int );
+    void markUsed( int );
+    // claim a slot for a new record, a free slot or a new one at the
+    // end of the file, return its number (0 on failure). the claim is
+    // in the files before it returns, so no other process takes it
+    int claimSlot( fstream & );
+    // cover the slots up to a record appended at the end of the file
+    void extendTo( int );
+    // first record in use at or after a record number,
+    // getRecordCount() + 1 if there is none
+    int nextUsed( int ) const;
+
+private:
+    // set the bits of a slot and write its word to the file
+    void setFree( int, bool );
+    // re-read a word of the bitmap, which another process may have
+    // changed, return false if the file has no such word yet
+    bool refreshWord( int, size_t );
+    // write a word of the bitmap to the file
+    void writeWord( size_t );
+    // cover the slots up to a record count, with their words as the
+    // file has them
+    void growTo( int, int );
+    // build the bitmap by reading all records
+    void build( fstream & );
+    // write the whole bitmap to the file
+    bool save();
+
+    bool loaded_;
+    int recordCount_;
+    vector< uint64_t > bits_;  // one bit per record slot
+    vector< int > freeList_;   // free slots, may hold stale entries
+    fstream file_;
+};
+
+// free-slot bitmap of the records file used by the tools
+extern FreeSlotMap freeSlots;
+
+#endif
@@ -0,0 +1,324 @@
+// index.cpp
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "index.h"
+
+// lock a whole index file against other processes, return the
+// descriptor holding the lock (closing it unlocks), -1 if no index
+static int lockIndex( const char *fileName, int operation )
+{
+    int fd = open( fileName, O_RDONLY );
+    if( fd >= 0 )
+    {
+        flock( fd, operation );
+    }
+    return fd;
+} // end function lockIndex
+
+// order name entries by name, then by record number
+bool operator<( const NameEntry &left, const NameEntry &right )
+{
+    int order = strncmp( left.name, right.name, NAME_LENGTH );
+    if( order != 0 )
+    {
+        return order < 0;
+    }
+    return left.recordNumber < right.recordNumber;
+} // end operator<
+
+// check if two name entries are the same
+bool operator==( const NameEntry &left, const NameEntry &right )
+{
+    return left.recordNumber == right.recordNumber
+        && strncmp( left.name, right.name, NAME_LENGTH ) == 0;
+} // end operator==
+
+// make a name index entry for a (record numbered) Student
+NameEntry makeNameEntry( const string &name, int recordNumber )
+{
+    NameEntry entry;
+    // zero fill so equal names compare equal byte for byte
+    memset( entry.name, 0, NAME_LENGTH );
+    name.copy( entry.name, NAME_LENGTH - 1 );
+    entry.recordNumber = recordNumber;
+    return entry;
+} // end function makeNameEntry
+
+// build the name index from all records in the file
+bool buildNameIndex( fstream &inFile, const char *fileName )
+{
+    const int batchSize = 4096;  // records per read
+    vector< NameEntry > entries;
+    vector< Student > batch( batchSize );
+    int recordCount = getRecordCount( inFile );
+
+    for( int first = 1; first <= recordCount; first += batchSize )
+    {
+        int records = readRecords( inFile, first, batchSize, &batch[0] );
+        for( int i = 0; i < records; i++ )
+        {
+            if( !isDeletedRecord( batch[i] ) )
+            {
+                entries.push_back(
+                    makeNameEntry( batch[i].getName(), first + i ) );
+            }
+        }
+    }
+
+    int lock = lockIndex( fileName, LOCK_EX );
+    bool created = BTreeIndex< NameEntry >::create( fileName, entries );
+    if( lock >= 0 )
+        close( lock );
+    return created;
+} // end function buildNameIndex
+
+// build the name index if there is no valid index file
+bool ensureNameIndex( fstream &inFile )
+{
+    int lock = lockIndex( NAME_INDEX_FILE, LOCK_SH );
+    bool valid = BTreeIndex< NameEntry >( NAME_INDEX_FILE ).isOpen();
+    if( lock >= 0 )
+        close( lock );
+    // an index in an older format is rebuilt as well
+    return valid || buildNameIndex( inFile );
+} // end function ensureNameIndex
+
+// record numbers of the students with a name
+vector< int > findByName( const string &name )
+{
+    vector< int > recordNumbers;
+    // lookups share the index, updates wait for them
+    int lock = lockIndex( NAME_INDEX_FILE, LOCK_SH );
+    BTreeIndex< NameEntry > index( NAME_INDEX_FILE );
+    if( !index.isOpen() )
+    {
+        if( lock >= 0 )
+            close( lock );
+        return recordNumbers;
+    }
+
+    // entries with the same name are adjacent, ordered by record number
+    NameEntry key = makeNameEntry( name, 0 ), entry;
+    BTreeIndex< NameEntry >::Cursor cursor;
+    index.seek( key, cursor );
+    while( index.next( cursor, entry )
+           && strncmp( entry.name, key.name, NAME_LENGTH ) == 0 )
+    {
+        recordNumbers.push_back( entry.recordNumber );
+    }
+
+    if( lock >= 0 )
+        close( lock );
+    return recordNumbers;
+} // end function findByName
+
+// update the name index for a record being replaced
+void updateNameIndex( int recordNumber, const Student &oldRec,
+                      const Student &newRec )
+{
+    // one process at a time changes the pages of the index
+    int lock = lockIndex( NAME_INDEX_FILE, LOCK_EX );
+    BTreeIndex< NameEntry > index( NAME_INDEX_FILE );
+    // without an index there is nothing to maintain
+    if( !index.isOpen() )
+    {
+        if( lock >= 0 )
+            close( lock );
+        return;
+    }
+
+    if( !isDeletedRecord( oldRec ) )
+    {
+        index.remove( makeNameEntry( oldRec.getName(), recordNumber ) );
+    }
+    if( !isDeletedRecord( newRec ) )
+    {
+        index.insert( makeNameEntry( newRec.getName(), recordNumber ) );
+    }
+    if( lock >= 0 )
+        close( lock );
+} // end function updateNameIndex
+
+// order score entries by score, highest first, then by record number
+bool operator<( const ScoreEntry &left, const ScoreEntry &right )
+{
+    if( left.score != right.score )
+    {
+        return left.score > right.score;
+    }
+    return left.recordNumber < right.recordNumber;
+} // end operator<
+
+// check if two score entries are the same
+bool operator==( const ScoreEntry &left, const ScoreEntry &right )
+{
+    return left.score == right.score
+        && left.recordNumber == right.recordNumber;
+} // end operator==
+
+// make a score index entry for a (record numbered) Student
+ScoreEntry makeScoreEntry( float score, int recordNumber )
+{
+    ScoreEntry entry;
+    entry.score = score;
+    entry.recordNumber = recordNumber;
+    return entry;
+} // end function makeScoreEntry
+
+// build the score index from all records in the file
+bool buildScoreIndex( fstream &inFile, const char *fileName )
+{
+    const int batchSize = 4096;  // records per read
+    vector< ScoreEntry > entries;
+    vector< Student > batch( batchSize );
+    int recordCount = getRecordCount( inFile );
+
+    for( int first = 1; first <= recordCount; first += batchSize )
+    {
+        int records = readRecords( inFile, first, batchSize, &batch[0] );
+        for( int i = 0; i < records; i++ )
+        {
+            if( !isDeletedRecord( batch[i] ) )
+            {
+                entries.push_back(
+                    makeScoreEntry( batch[i].getScore(), first + i ) );
+            }
+        }
+    }
+
+    int lock = lockIndex( fileName, LOCK_EX );
+    bool created = BTreeIndex< ScoreEntry >::create( fileName, entries );
+    if( lock >= 0 )
+        close( lock );
+    return created;
+} // end function buildScoreIndex
+
+// build the score index if there is no valid index file
+bool ensureScoreIndex( fstream &inFile )
+{
+    int lock = lockIndex( SCORE_INDEX_FILE, LOCK_SH );
+    bool valid = BTreeIndex< ScoreEntry >( SCORE_INDEX_FILE ).isOpen();
+    if( lock >= 0 )
+        close( lock );
+    return valid || buildScoreIndex( inFile );
+} // end function ensureScoreIndex
+
+// record numbers of the students with a score in [low, high],
+// only the index entries in the range are read
+vector< int > findByScore( float low, float high )
+{
+    vector< int > recordNumbers;
+    int lock = lockIndex( SCORE_INDEX_FILE, LOCK_SH );
+    BTreeIndex< ScoreEntry > index( SCORE_INDEX_FILE );
+    if( index.isOpen() )
+    {
+        // scores are in descending order, start at the highest
+        ScoreEntry entry;
+        BTreeIndex< ScoreEntry >::Cursor cursor;
+        index.seek( makeScoreEntry( high, 0 ), cursor );
+        while( index.next( cursor, entry ) && entry.score >= low )
+            recordNumbers.push_back( entry.recordNumber );
+    }
+    if( lock >= 0 )
+        close( lock );
+    return recordNumbers;
+} // end function findByScore
+
+// record numbers of the students with the highest scores
+vector< int > topScores( int count )
+{
+    vector< int > recordNumbers;
+    int lock = lockIndex( SCORE_INDEX_FILE, LOCK_SH );
+    BTreeIndex< ScoreEntry > index( SCORE_INDEX_FILE );
+    if( index.isOpen() )
+    {
+        // the first entries of the index are the highest scores
+        ScoreEntry entry;
+        BTreeIndex< ScoreEntry >::Cursor cursor;
+        index.first( cursor );
+        while( static_cast< int >( recordNumbers.size() ) < count
+               && index.next( cursor, entry ) )
+            recordNumbers.push_back( entry.recordNumber );
+    }
+    if( lock >= 0 )
+        close( lock );
+    return recordNumbers;
+} // end function topScores
+
+// update the score index for a record being replaced
+void updateScoreIndex( int recordNumber, const Student &oldRec,
+                       const Student &newRec )
+{
+    bool oldDeleted = isDeletedRecord( oldRec );
+    bool newDeleted = isDeletedRecord( newRec );
+    // a change of name only leaves the entry as it is
+    if( oldDeleted && newDeleted )
+    {
+        return;
+    }
+    if( !oldDeleted && !newDeleted && oldRec.getScore() == newRec.getScore() )
+    {
+        return;
+    }
+
+    int lock = lockIndex( SCORE_INDEX_FILE, LOCK_EX );
+    BTreeIndex< ScoreEntry > index( SCORE_INDEX_FILE );
+    // without an index there is nothing to maintain
+    if( index.isOpen() )
+    {
+        if( !oldDeleted )
+            index.remove( makeScoreEntry( oldRec.getScore(), recordNumber ) );
+        if( !newDeleted )
+            index.insert( makeScoreEntry( newRec.getScore(), recordNumber ) );
+    }
+    if( lock >= 0 )
+        close( lock );
+} // end function updateScoreIndex
+
+// remove the stale entries of a record from an index, then put in
+// the entry of its new image once (none if it is deleted)
+template< typename Entry >
+static void mendIndex( const char *fileName, const vector< Entry > &stale,
+                       const Entry *fresh )
+{
+    int lock = lockIndex( fileName, LOCK_EX );
+    BTreeIndex< Entry > index( fileName );
+    // without an index there is nothing to maintain
+    if( index.isOpen() )
+    {
+        // removing an entry that is not in the index does nothing
+        for( size_t i = 0; i < stale.size(); i++ )
+            index.remove( stale[i] );
+        if( fresh != 0 )
+            index.insert( *fresh );
+    }
+    if( lock >= 0 )
+        close( lock );
+} // end function mendIndex
+
+// mend the index entries of a record after a replayed write
+void mendIndexes( int recordNumber, const Student &replaced,
+                  const Student &current, const Student &newRec )
+{
+    // the entries of every image the record may have had in the
+    // indexes go, then the new image's entries go in
+    const Student *images[] = { &replaced, &current, &newRec };
+    vector< NameEntry > names;
+    vector< ScoreEntry > scores;
+    for( int i = 0; i < 3; i++ )
+    {
+        if( !isDeletedRecord( *images[i] ) )
+        {
+            names.push_back(
+                makeNameEntry( images[i]->getName(), recordNumber ) );
+            scores.push_back(
+                makeScoreEntry( images[i]->getScore(), recordNumber ) );
+        }
+    }
+
+    bool kept = !isDeletedRecord( newRec );
+    mendIndex( NAME_INDEX_FILE, names, kept ? &names.back() : 0 );
+    mendIndex( SCORE_INDEX_FILE, scores, kept ? &scores.back() : 0 );
+} // end function mendIndexes
@@ -0,0 +1,487 @@
+// index.h
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include "record.h"
+using namespace std;
+
+// file name of the secondary index on Student names
+const char NAME_INDEX_FILE[] = "students.idx";
+// file name of the secondary index on Student scores
+const char SCORE_INDEX_FILE[] = "students.sdx";
+
+// a persistent secondary index: a B+tree of fixed size entries in
+// 4 KiB pages. a lookup reads one page per level of the tree, so it
+// costs O(log n) page reads instead of a scan of the records file,
+// and an insert or remove rewrites only the pages on its path.
+// Entry must be a plain struct with operator< and operator==,
+// and entries must be unique.
+template< typename Entry >
+class BTreeIndex
+{
+public:
+    // position of an entry in the leaves of the tree
+    struct Cursor
+    {
+        int page;  // leaf page, -1 past the last entry
+        int slot;  // entry in the leaf
+    };
+
+    // open an existing index file
+    explicit BTreeIndex( const string & );
+
+    bool isOpen() const { return opened_; }
+    // number of entries in the index
+    int size() const { return header_.count; }
+
+    // position a cursor at the first entry not less than a key
+    void seek( const Entry &, Cursor & );
+    // position a cursor at the first entry
+    void first( Cursor & );
+    // read the entry at a cursor and move it on, false at the end
+    bool next( Cursor &, Entry & );
+
+    // add an entry
+    bool insert( const Entry & );
+    // remove an entry, return false if it is not in the index
+    bool remove( const Entry & );
+
+    // write a new index file from unsorted entries
+    static bool create( const string &, vector< Entry > & );
+
+private:
+    enum
+    {
+        PAGE_BYTES = 4096,
+        NODE_HEADER = 4 * sizeof( int32_t ),
+        // entries held by a leaf page
+        LEAF_CAPACITY = ( PAGE_BYTES - NODE_HEADER ) / sizeof( Entry ),
+        // separators held by a branch page, with one child more
+        BRANCH_CAPACITY = ( PAGE_BYTES - NODE_HEADER - sizeof( int32_t ) )
+                          / ( sizeof( Entry ) + sizeof( int32_t ) ),
+        INDEX_MAGIC = 0x42545231  // "BTR1"
+    };
+
+    // first page of the file
+    struct Header
+    {
+        uint32_t magic;
+        int32_t root;       // root page
+        int32_t pageCount;  // pages in the file, header included
+        int32_t count;      // entries in the index
+    };
+
+    // a page being changed in memory, may be over capacity
+    struct Node
+    {
+        bool leaf;
+        int next;
+        vector< Entry > entries;      // entries or separators
+        vector< int32_t > children;   // children of a branch
+    };
+
+    // read and write pages of the file
+    void readNode( int, Node & );
+    void writeNode( int, const Node & );
+    void writeHeader();
+    // child of a branch to descend into for a key
+    static int childFor( const Node &, const Entry & );
+
+    fstream file_;
+    bool opened_;
+    Header header_;
+    Node cursorNode_;   // leaf under the last used cursor
+    int cursorPage_;
+};
+
+// open an existing index file
+template< typename Entry >
+BTreeIndex< Entry >::BTreeIndex( const string &fileName )
+    : opened_( false ), cursorPage_( -1 )
+{
+    header_.count = 0;
+    file_.open( fileName.c_str(), ios::in | ios::out | ios::binary );
+    if( file_ )
+    {
+        file_.read( reinterpret_cast< char * >( &header_ ), sizeof( Header ) );
+        // a file in another format is not an index
+        opened_ = file_.good() && header_.magic == INDEX_MAGIC;
+        if( !opened_ )
+            header_.count = 0;
+    }
+} // end BTreeIndex constructor
+
+// read a page of the file into a node
+template< typename Entry >
+void BTreeIndex< Entry >::readNode( int page, Node &node )
+{
+    char buffer[ PAGE_BYTES ];
+    file_.seekg( static_cast< streamoff >( page ) * PAGE_BYTES );
+    file_.read( buffer, PAGE_BYTES );
+
+    const int32_t *fields = reinterpret_cast< const int32_t * >( buffer );
+    const Entry *entries =
+        reinterpret_cast< const Entry * >( buffer + NODE_HEADER );
+    node.leaf = fields[0] != 0;
+    node.next = fields[2];
+    node.entries.assign( entries, entries + fields[1] );
+    node.children.clear();
+    if( !node.leaf )
+    {
+        // children follow the separators of a full branch
+        const int32_t *children = reinterpret_cast< const int32_t * >(
+                buffer + NODE_HEADER + BRANCH_CAPACITY * sizeof( Entry ) );
+        node.children.assign( children, children + fields[1] + 1 );
+    }
+} // end function readNode
+
+// write a node, within capacity, to a page of the file
+template< typename Entry >
+void BTreeIndex< Entry >::writeNode( int page, const Node &node )
+{
+    char buffer[ PAGE_BYTES ] = { 0 };
+    int32_t *fields = reinterpret_cast< int32_t * >( buffer );
+    fields[0] = node.leaf;
+    fields[1] = node.entries.size();
+    fields[2] = node.next;
+    if( !node.entries.empty() )
+        memcpy( buffer + NODE_HEADER, &node.entries[0],
+                node.entries.size() * sizeof( Entry ) );
+    if( !node.leaf )
+        memcpy( buffer + NODE_HEADER + BRANCH_CAPACITY * sizeof( Entry ),
+                &node.children[0], node.children.size() * sizeof( int32_t ) );
+
+    file_.seekp( static_cast< streamoff >( page ) * PAGE_BYTES );
+    file_.write( buffer, PAGE_BYTES );
+    if( page == cursorPage_ )
+        cursorPage_ = -1;  // the cached leaf is out of date
+} // end function writeNode
+
+// write the header page
+template< typename Entry >
+void BTreeIndex< Entry >::writeHeader()
+{
+    file_.seekp( 0 );
+    file_.write( reinterpret_cast< const char * >( &header_ ), sizeof( Header ) );
+    file_.flush();
+} // end function writeHeader
+
+// child of a branch to descend into: entries equal to a
+// separator are in the subtree to its right
+template< typename Entry >
+int BTreeIndex< Entry >::childFor( const Node &node, const Entry &key )
+{
+    return upper_bound( node.entries.begin(), node.entries.end(), key )
+           - node.entries.begin();
+} // end function childFor
+
+// position a cursor at the first entry not less than a key
+template< typename Entry >
+void BTreeIndex< Entry >::seek( const Entry &key, Cursor &cursor )
+{
+    int page = header_.root;
+    readNode( page, cursorNode_ );
+    while( !cursorNode_.leaf )
+    {
+        page = cursorNode_.children[ childFor( cursorNode_, key ) ];
+        readNode( page, cursorNode_ );
+    }
+    cursorPage_ = page;
+
+    cursor.page = page;
+    cursor.slot = lower_bound( cursorNode_.entries.begin(),
+                               cursorNode_.entries.end(), key )
+                  - cursorNode_.entries.begin();
+} // end function seek
+
+// position a cursor at the first entry
+template< typename Entry >
+void BTreeIndex< Entry >::first( Cursor &cursor )
+{
+    int page = header_.root;
+    readNode( page, cursorNode_ );
+    while( !cursorNode_.leaf )
+    {
+        page = cursorNode_.children[0];
+        readNode( page, cursorNode_ );
+    }
+    cursorPage_ = page;
+    cursor.page = page;
+    cursor.slot = 0;
+} // end function first
+
+// read the entry at a cursor and move it to the next entry
+template< typename Entry >
+bool BTreeIndex< Entry >::next( Cursor &cursor, Entry &entry )
+{
+    while( cursor.page >= 0 )
+    {
+        if( cursor.page != cursorPage_ )
+        {
+            readNode( cursor.page, cursorNode_ );
+            cursorPage_ = cursor.page;
+        }
+        if( cursor.slot < static_cast< int >( cursorNode_.entries.size() ) )
+        {
+            entry = cursorNode_.entries[ cursor.slot++ ];
+            return true;
+        }
+        // continue in the next leaf
+        cursor.page = cursorNode_.next;
+        cursor.slot = 0;
+    }
+    return false;
+} // end function next
+
+// add an entry, splitting the pages that overflow
+template< typename Entry >
+bool BTreeIndex< Entry >::insert( const Entry &entry )
+{
+    // descend to the leaf, remembering the branches on the way
+    vector< int > path;
+    Node node;
+    int page = header_.root;
+    readNode( page, node );
+    while( !node.leaf )
+    {
+        path.push_back( page );
+        page = node.children[ childFor( node, entry ) ];
+        readNode( page, node );
+    }
+
+    node.entries.insert( lower_bound( node.entries.begin(),
+                                      node.entries.end(), entry ),
+                         entry );
+    ++header_.count;
+
+    // split full pages from the leaf up
+    while( true )
+    {
+        int capacity = ( node.leaf ? LEAF_CAPACITY : BRANCH_CAPACITY );
+        if( static_cast< int >( node.entries.size() ) <= capacity )
+        {
+            writeNode( page, node );
+            break;
+        }
+
+        int half = node.entries.size() / 2;
+        Node right;
+        right.leaf = node.leaf;
+        Entry separator = node.entries[ half ];
+        if( node.leaf )
+        {
+            // the right leaf starts with the separator
+            right.entries.assign( node.entries.begin() + half,
+                                  node.entries.end() );
+            right.next = node.next;
+        }
+        else
+        {
+            // the separator moves up, out of the branch
+            right.entries.assign( node.entries.begin() + half + 1,
+                                  node.entries.end() );
+            right.children.assign( node.children.begin() + half + 1,
+                                   node.children.end() );
+            node.children.resize( half + 1 );
+            right.next = -1;
+        }
+        node.entries.resize( half );
+
+        int rightPage = header_.pageCount++;
+        if( node.leaf )
+            node.next = rightPage;
+        writeNode( rightPage, right );
+        writeNode( page, node );
+
+        if( path.empty() )
+        {
+            // a new root above the split page
+            Node root;
+            root.leaf = false;
+            root.next = -1;
+            root.entries.push_back( separator );
+            root.children.push_back( page );
+            root.children.push_back( rightPage );
+            header_.root = header_.pageCount++;
+            writeNode( header_.root, root );
+            break;
+        }
+
+        // add the separator to the parent, which may split in turn
+        int childPage = page;
+        page = path.back();
+        path.pop_back();
+        readNode( page, node );
+        int position = find( node.children.begin(), node.children.end(),
+                             childPage ) - node.children.begin();
+        node.entries.insert( node.entries.begin() + position, separator );
+        node.children.insert( node.children.begin() + position + 1,
+                              rightPage );
+    }
+
+    writeHeader();
+    return file_.good();
+} // end function insert
+
+// remove an entry, pages are not merged
+template< typename Entry >
+bool BTreeIndex< Entry >::remove( const Entry &entry )
+{
+    Node node;
+    int page = header_.root;
+    readNode( page, node );
+    while( !node.leaf )
+    {
+        page = node.children[ childFor( node, entry ) ];
+        readNode( page, node );
+    }
+
+    typename vector< Entry >::iterator found =
+        lower_bound( node.entries.begin(), node.entries.end(), entry );
+    if( found == node.entries.end() || !( *found == entry ) )
+    {
+        return false;
+    }
+
+    node.entries.erase( found );
+    writeNode( page, node );
+    --header_.count;
+    writeHeader();
+    return file_.good();
+} // end function remove
+
+// sort entries and write them as a new index file, building the
+// tree bottom up with pages three quarters full
+template< typename Entry >
+bool BTreeIndex< Entry >::create( const string &fileName,
+                                  vector< Entry > &entries )
+{
+    sort( entries.begin(), entries.end() );
+
+    BTreeIndex< Entry > index( fileName );
+    index.file_.close();
+    index.file_.clear();
+    index.file_.open( fileName.c_str(),
+                      ios::in | ios::out | ios::trunc | ios::binary );
+    if( !index.file_ )
+    {
+        return false;
+    }
+    index.header_.magic = INDEX_MAGIC;
+    index.header_.count = entries.size();
+    index.header_.pageCount = 1;
+
+    // the leaves, chained in key order
+    const int leafFill = LEAF_CAPACITY * 3 / 4;
+    vector< Entry > firstKeys;   // first entry under each page
+    vector< int32_t > pages;     // pages of the level being built
+    size_t next = 0;
+    do
+    {
+        Node leaf;
+        leaf.leaf = true;
+        size_t end = min( entries.size(), next + leafFill );
+        leaf.entries.assign( entries.begin() + next, entries.begin() + end );
+        int page = index.header_.pageCount++;
+        leaf.next = ( end < entries.size() ? page + 1 : -1 );
+        index.writeNode( page, leaf );
+
+        firstKeys.push_back( leaf.entries.empty() ? Entry() : leaf.entries[0] );
+        pages.push_back( page );
+        next = end;
+    } while( next < entries.size() );
+
+    // levels of branches until a single root
+    const int branchFill = BRANCH_CAPACITY * 3 / 4 + 1;  // children
+    while( pages.size() > 1 )
+    {
+        vector< Entry > upperKeys;
+        vector< int32_t > upperPages;
+        for( size_t first = 0; first < pages.size(); first += branchFill )
+        {
+            size_t end = min( pages.size(), first + branchFill );
+            Node branch;
+            branch.leaf = false;
+            branch.next = -1;
+            branch.entries.assign( firstKeys.begin() + first + 1,
+                                   firstKeys.begin() + end );
+            branch.children.assign( pages.begin() + first,
+                                    pages.begin() + end );
+            int page = index.header_.pageCount++;
+            index.writeNode( page, branch );
+
+            upperKeys.push_back( firstKeys[ first ] );
+            upperPages.push_back( page );
+        }
+        firstKeys.swap( upperKeys );
+        pages.swap( upperPages );
+    }
+
+    index.header_.root = pages[0];
+    index.writeHeader();
+    return index.file_.good();
+} // end function create
+
+// an entry of the name index
+struct NameEntry
+{
+    char name[ NAME_LENGTH ];
+    int recordNumber;
+};
+
+// order name entries by name, then by record number
+bool operator<( const NameEntry &, const NameEntry & );
+bool operator==( const NameEntry &, const NameEntry & );
+// make a name index entry for a (record numbered) Student
+NameEntry makeNameEntry( const string &, int );
+
+// build the name index from all records in the file,
+// into another file than the index in use if given
+bool buildNameIndex( fstream &, const char * = NAME_INDEX_FILE );
+// build the name index if there is no valid index file
+bool ensureNameIndex( fstream & );
+// record numbers of the students with a name
+vector< int > findByName( const string & );
+// update the name index for a record being replaced
+void updateNameIndex( int, const Student &, const Student & );
+
+// an entry of the score index
+struct ScoreEntry
+{
+    float score;
+    int recordNumber;
+};
+
+// order score entries by score, highest first, then by record number
+bool operator<( const ScoreEntry &, const ScoreEntry & );
+bool operator==( const ScoreEntry &, const ScoreEntry & );
+// make a score index entry for a (record numbered) Student
+ScoreEntry makeScoreEntry( float, int );
+
+// build the score index from all records in the file,
+// into another file than the index in use if given
+bool buildScoreIndex( fstream &, const char * = SCORE_INDEX_FILE );
+// build the score index if there is no valid index file
+bool ensureScoreIndex( fstream & );
+// record numbers of the students with a score in a range
+// [low, high], highest score first
+vector< int > findByScore( float, float );
+// record numbers of the students with the highest scores
+vector< int > topScores( int );
+// update the score index for a record being replaced
+void updateScoreIndex( int, const Student &, const Student & );
+
+// mend the name and score index entries of a record after a
+// replayed write, whatever part of the write reached the indexes
+// before a crash: the entries of the record it replaced, of the
+// record now in the file and of the new record are removed, and
+// the new record's are put in once
+void mendIndexes( int, const Student &, const Student &, const Student & );
+
+#endif
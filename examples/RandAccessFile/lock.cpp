@@ -0,0 +1,91 @@
+// lock.cpp
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "record.h"
+#include "fileheader.h"
+#include "lock.h"
+
+// record locks of the records file used by the tools
+RecordLocks recordLocks;
+
+// create a closed lock table
+RecordLocks::RecordLocks() : fd_(-1)
+{
+} // end RecordLocks constructor
+
+// release the descriptor, and with it all locks
+RecordLocks::~RecordLocks()
+{
+    if( fd_ >= 0 )
+        ::close( fd_ );
+} // end RecordLocks destructor
+
+// open the file the locks are taken on
+bool RecordLocks::open( const string &fileName )
+{
+    // a reopened file drops the locks on the one before
+    if( fd_ >= 0 )
+        ::close( fd_ );
+    // exclusive locks need a descriptor open for writing,
+    // a reader can only take shared locks
+    fd_ = ::open( fileName.c_str(), O_RDWR );
+    if( fd_ < 0 )
+    {
+        fd_ = ::open( fileName.c_str(), O_RDONLY );
+    }
+    return fd_ >= 0;
+} // end function open
+
+// lock the bytes of a range of records
+bool RecordLocks::lock( int first, int count, LockMode mode )
+{
+    return lockBytes( recordPosition( first ),
+                      static_cast< off_t >( count ) * sizeof( Student ),
+                      mode == SHARED_LOCK ? F_RDLCK : F_WRLCK );
+} // end function lock
+
+// unlock the bytes of a range of records
+bool RecordLocks::unlock( int first, int count )
+{
+    return lockBytes( recordPosition( first ),
+                      static_cast< off_t >( count ) * sizeof( Student ),
+                      F_UNLCK );
+} // end function unlock
+
+// lock the file header, which does not overlap any record
+bool RecordLocks::lockHeader( LockMode mode )
+{
+    return lockBytes( 0, FILE_HEADER_SIZE,
+                      mode == SHARED_LOCK ? F_RDLCK : F_WRLCK );
+} // end function lockHeader
+
+// unlock the file header
+bool RecordLocks::unlockHeader()
+{
+    return lockBytes( 0, FILE_HEADER_SIZE, F_UNLCK );
+} // end function unlockHeader
+
+// lock or unlock a range of bytes of the file
+bool RecordLocks::lockBytes( off_t start, off_t length, short type )
+{
+    struct flock range;
+    range.l_type = type;
+    range.l_whence = SEEK_SET;
+    range.l_start = start;
+    range.l_len = length;
+
+    if( type == F_UNLCK )
+    {
+        return fcntl( fd_, F_SETLK, &range ) == 0;
+    }
+
+    // wait for conflicting locks, retry if a signal interrupts
+    int result;
+    do
+    {
+        result = fcntl( fd_, F_SETLKW, &range );
+    } while( result < 0 && errno == EINTR );
+
+    return result == 0;
+} // end function lockBytes
@@ -0,0 +1,51 @@
+// lock.h
+#ifndef LOCK_H
+#define LOCK_H
+
+#include <string>
+#include <sys/types.h>
+using namespace std;
+
+// kinds of record locks
+enum LockMode { SHARED_LOCK, EXCLUSIVE_LOCK };
+
+// advisory byte-range locks on the records of a file, shared for
+// reads and exclusive for writes, so many reader processes can run
+// next to a writer and only wait for the record it is writing.
+//
+// POSIX record locks belong to the process: closing ANY descriptor
+// of the file drops them all, and a second lock on the same range
+// replaces the first. a record must not be locked twice at a time.
+class RecordLocks
+{
+public:
+    RecordLocks();
+    ~RecordLocks();
+
+    // open the file the locks are taken on
+    bool open( const string & );
+    bool isOpen() const { return fd_ >= 0; }
+
+    // lock a range of records, waiting for conflicting locks
+    bool lock( int first, int count, LockMode mode );
+    // unlock a range of records
+    bool unlock( int first, int count );
+    // lock and unlock the file header in front of the records
+    bool lockHeader( LockMode mode );
+    bool unlockHeader();
+
+private:
+    // lock descriptors are not shared
+    RecordLocks( const RecordLocks & );
+    RecordLocks &operator=( const RecordLocks & );
+
+    // lock (or unlock) a range of bytes of the file
+    bool lockBytes( off_t start, off_t length, short type );
+
+    int fd_;
+};
+
+// record locks of the records file used by the tools
+extern RecordLocks recordLocks;
+
+#endif
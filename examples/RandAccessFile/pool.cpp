@@ -0,0 +1,208 @@
+// pool.cpp
+#include <algorithm>
+#include "pool.h"
+#include "lock.h"
+#include "checksum.h"
+
+// buffer pool of the records file used by the tools
+BufferPool bufferPool;
+
+// create a disabled pool
+BufferPool::BufferPool()
+    : capacity_(0), hits_(0), misses_(0), writeBacks_(0)
+{
+} // end BufferPool constructor
+
+// number of pages the pool may hold
+void BufferPool::resize( fstream &ioFile, int pages )
+{
+    capacity_ = ( pages > 0 ? pages : 0 );
+    // evict pages over the new size
+    while( static_cast< int >( frames_.size() ) > capacity_ )
+    {
+        writeBack( ioFile, frames_.back() );
+        pages_.erase( frames_.back().page );
+        frames_.pop_back();
+    }
+} // end function resize
+
+// find a page in the pool or read it from the file
+BufferPool::Frame &BufferPool::fetch( fstream &ioFile, int page )
+{
+    map< int, FrameIterator >::iterator found = pages_.find( page );
+    if( found != pages_.end() )
+    {
+        ++hits_;
+        // move the page to the most recently used end
+        frames_.splice( frames_.begin(), frames_, found->second );
+        return frames_.front();
+    }
+
+    ++misses_;
+    // reuse the least recently used frame when the pool is full
+    if( static_cast< int >( frames_.size() ) >= capacity_ )
+    {
+        writeBack( ioFile, frames_.back() );
+        pages_.erase( frames_.back().page );
+        frames_.splice( frames_.begin(), frames_, --frames_.end() );
+    }
+    else
+    {
+        frames_.push_front( Frame() );
+        frames_.front().records.resize( RECORDS_PER_PAGE );
+        frames_.front().dirty.resize( RECORDS_PER_PAGE );
+        frames_.front().sums.resize( RECORDS_PER_PAGE );
+    }
+
+    Frame &frame = frames_.front();
+    frame.page = page;
+    frame.anyDirty = false;
+    fill( frame.dirty.begin(), frame.dirty.end(), false );
+
+    // read the whole page under a shared lock
+    int first = page * RECORDS_PER_PAGE + 1;
+    if( recordLocks.isOpen() )
+        recordLocks.lock( first, RECORDS_PER_PAGE, SHARED_LOCK );
+    ioFile.seekg( recordPosition( first ) );
+    ioFile.read( reinterpret_cast< char * >( &frame.records[0] ),
+                 RECORDS_PER_PAGE * sizeof( Student ) );
+    // the last page of the file is short
+    frame.loaded = ioFile.gcount() / sizeof( Student );
+    ioFile.clear();
+    // the checksums read with the page, a record is checked when read
+    recordChecksums.load( first, RECORDS_PER_PAGE, &frame.sums[0] );
+    if( recordLocks.isOpen() )
+        recordLocks.unlock( first, RECORDS_PER_PAGE );
+
+    pages_[ page ] = frames_.begin();
+    return frame;
+} // end function fetch
+
+// read a record through the pool
+bool BufferPool::read( fstream &ioFile, int recordNumber, Student &rec )
+{
+    Frame &frame = fetch( ioFile, ( recordNumber - 1 ) / RECORDS_PER_PAGE );
+    int slot = ( recordNumber - 1 ) % RECORDS_PER_PAGE;
+    if( slot >= frame.loaded )
+    {
+        return false;
+    }
+    rec = frame.records[ slot ];
+    recordChecksums.check( recordNumber, rec, frame.sums[ slot ] );
+    return true;
+} // end function read
+
+// write a record to its cached page
+void BufferPool::write( fstream &ioFile, int recordNumber, const Student &rec )
+{
+    Frame &frame = fetch( ioFile, ( recordNumber - 1 ) / RECORDS_PER_PAGE );
+    int slot = ( recordNumber - 1 ) % RECORDS_PER_PAGE;
+
+    // records between the end of file and an appended record
+    // read as null records, but are not written back: another
+    // process may have appended them since, and a hole left in
+    // the file reads as null records too
+    for( ; frame.loaded < slot; frame.loaded++ )
+    {
+        frame.records[ frame.loaded ] = Student();
+    }
+    if( frame.loaded == slot )
+        ++frame.loaded;
+
+    frame.records[ slot ] = rec;
+    frame.dirty[ slot ] = true;
+    // the record is no longer the one checksummed
+    frame.sums[ slot ] = 0;
+    frame.anyDirty = true;
+} // end function write
+
+// write the dirty records of a page to the file
+bool BufferPool::writeBack( fstream &ioFile, Frame &frame )
+{
+    if( !frame.anyDirty )
+    {
+        return true;
+    }
+
+    // write each run of dirty records with one write, records of
+    // the page written by other processes are left alone
+    int first = frame.page * RECORDS_PER_PAGE + 1;
+    bool written = true;
+    for( int slot = 0; slot < frame.loaded; )
+    {
+        if( !frame.dirty[ slot ] )
+        {
+            ++slot;
+            continue;
+        }
+        int end = slot;
+        while( end < frame.loaded && frame.dirty[ end ] )
+            frame.dirty[ end++ ] = false;
+
+        // the run is locked while it is written
+        if( recordLocks.isOpen() )
+            recordLocks.lock( first + slot, end - slot, EXCLUSIVE_LOCK );
+        ioFile.seekp( recordPosition( first + slot ) );
+        ioFile.write( reinterpret_cast< const char * >( &frame.records[ slot ] ),
+                      ( end - slot ) * sizeof( Student ) );
+        ioFile.flush();
+        if( ioFile.good() )
+            recordChecksums.update( first + slot, end - slot,
+                                    &frame.records[ slot ] );
+        if( recordLocks.isOpen() )
+            recordLocks.unlock( first + slot, end - slot );
+
+        written = ioFile.good() && written;
+        slot = end;
+    }
+
+    frame.anyDirty = false;
+    ++writeBacks_;
+    return written;
+} // end function writeBack
+
+// write all dirty records back to the file
+bool BufferPool::flush( fstream &ioFile )
+{
+    bool written = true;
+    for( FrameIterator frame = frames_.begin(); frame != frames_.end(); ++frame )
+        written = writeBack( ioFile, *frame ) && written;
+    return written;
+} // end function flush
+
+// write back and drop the pages of a range of records
+bool BufferPool::discard( fstream &ioFile, int first, int count )
+{
+    bool written = true;
+    int firstPage = ( first - 1 ) / RECORDS_PER_PAGE;
+    int lastPage = ( first + count - 2 ) / RECORDS_PER_PAGE;
+
+    map< int, FrameIterator >::iterator page = pages_.lower_bound( firstPage );
+    while( page != pages_.end() && page->first <= lastPage )
+    {
+        written = writeBack( ioFile, *page->second ) && written;
+        frames_.erase( page->second );
+        pages_.erase( page++ );
+    }
+    return written;
+} // end function discard
+
+// write back and drop all pages
+bool BufferPool::invalidate( fstream &ioFile )
+{
+    bool written = flush( ioFile );
+    frames_.clear();
+    pages_.clear();
+    return written;
+} // end function invalidate
+
+// print the counters
+void BufferPool::printStats( ostream &output ) const
+{
+    long lookups = hits_ + misses_;
+    output << "Buffer pool: " << capacity_ << " page(s), "
+        << hits_ << " hit(s), " << misses_ << " miss(es)";
+    if( lookups > 0 )
+        output << " (" << 100 * hits_ / lookups << "% hits)";
+    output << ", " << writeBacks_ << " page write back(s)" << endl;
+} // end function printStats
@@ -0,0 +1,83 @@
+// pool.h
+#ifndef POOL_H
+#define POOL_H
+
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <vector>
+#include "record.h"
+using namespace std;
+
+// bytes per page of the buffer pool
+const int PAGE_SIZE = 4096;
+// whole records held by a page
+const int RECORDS_PER_PAGE = PAGE_SIZE / sizeof( Student );
+
+// a pool of cached pages of the records file. pages are evicted in
+// least recently used order, and records written to a cached page
+// are written back to the file when the page is evicted or the pool
+// is flushed. the pool is disabled until it is given a size.
+//
+// cached pages are private to the process: a tool drops them with
+// invalidate() before an operation that must see the writes of
+// other processes.
+class BufferPool
+{
+public:
+    BufferPool();
+
+    // number of pages the pool may hold, 0 disables the pool
+    void resize( fstream &, int );
+    bool isEnabled() const { return capacity_ > 0; }
+
+    // read a record through the pool, false past end of file
+    bool read( fstream &, int, Student & );
+    // write a record to its cached page
+    void write( fstream &, int, const Student & );
+
+    // write all dirty records back to the file
+    bool flush( fstream & );
+    // write back and drop the pages of a range of records
+    bool discard( fstream &, int, int );
+    // write back and drop all pages
+    bool invalidate( fstream & );
+
+    // counters to size the pool
+    long getHits() const { return hits_; }
+    long getMisses() const { return misses_; }
+    long getWriteBacks() const { return writeBacks_; }
+    // print the counters
+    void printStats( ostream & ) const;
+
+private:
+    // a cached page of records
+    struct Frame
+    {
+        int page;                 // page number in the file
+        int loaded;               // records held, short at end of file
+        bool anyDirty;            // some record must be written back
+        vector< Student > records;
+        vector< bool > dirty;     // records to write back
+        vector< uint32_t > sums;  // stored checksums, 0 once written
+    };
+    typedef list< Frame >::iterator FrameIterator;
+
+    // find a page in the pool or read it from the file
+    Frame &fetch( fstream &, int );
+    // write the dirty records of a page to the file
+    bool writeBack( fstream &, Frame & );
+
+    int capacity_;
+    list< Frame > frames_;                // most recently used first
+    map< int, FrameIterator > pages_;     // page number to frame
+    long hits_;
+    long misses_;
+    long writeBacks_;
+};
+
+// buffer pool of the records file used by the tools
+extern BufferPool bufferPool;
+
+#endif
@@ -4,13 +4,25 @@
 #include <sstream>
 #include <iomanip>
 #include <cstdlib>
+#include <cstddef>
+#include <cstring>
 #include "inputs.h"
 #include "record.h"
+#include "fileheader.h"
+#include "index.h"
+#include "freemap.h"
+#include "wal.h"
+#include "lock.h"
+#include "pool.h"
+#include "checksum.h"
 
 // null Student object, usefull to erase
 // a record in the random-access file
 Student nullStudentRecord;
 
+// the record is 40 bytes, with no padding left to the compiler
+typedef char StudentSizeCheck[ sizeof( Student ) == 40 ? 1 : -1 ];
+
 /**
  *  Student class member functions
  */
@@ -18,6 +30,9 @@ Student nullStudentRecord;
 // default constructor
 Student::Student( int id, string name, float score ) : id_(id), score_(score)
 {
+    // zero fill so records of equal fields are equal byte for byte
+    memset( name_, 0, NAME_LENGTH );
+    memset( reserved_, 0, sizeof( reserved_ ) );
     setName( name );
 } // end Student constructor
 
@@ -51,7 +66,7 @@ Student &Student::setScore( float score )
 } // end function setScore
 
 // print a record
-void Student::print()
+void Student::print() const
 {
     // print read record
     cout << setw(4) << id_
@@ -60,23 +75,46 @@ void Student::print()
 } // end function print
 
 // check if the record is null
-bool Student::isNullRecord()
+bool Student::isNullRecord() const
 {
-    // check if the record is null
+    // check if the record is null, without
+    // building a string from the name field
     return (
             id_ == 0
             &&
-            string( name_ ) == ""
+            name_[0] == '\0'
             &&
             score_ == 0.00
     );
 } // end function isNullRecord
 
+// hash of the field offsets and sizes, so a file written with
+// another layout of the record is refused instead of misread
+uint32_t Student::layoutHash()
+{
+    stringstream layout;
+    layout << "id:" << offsetof( Student, id_ ) << ':' << sizeof( int32_t )
+        << ";name:" << offsetof( Student, name_ ) << ':' << NAME_LENGTH
+        << ";reserved:" << offsetof( Student, reserved_ ) << ':' << 2
+        << ";score:" << offsetof( Student, score_ ) << ':' << sizeof( float )
+        << ";size:" << sizeof( Student );
+
+    // FNV-1a over the description
+    string text = layout.str();
+    uint32_t hash = 2166136261u;
+    for( size_t i = 0; i < text.size(); i++ )
+    {
+        hash ^= static_cast< unsigned char >( text[i] );
+        hash *= 16777619u;
+    }
+    return hash;
+} // end function layoutHash
+
 /**
  *  record processing utility functions
  */
 
-// get number of student records in the file
+// get number of student records in the file from its header
 int getRecordCount( fstream &ioFile )
 {
     if( !ioFile )
@@ -85,14 +123,15 @@ int getRecordCount( fstream &ioFile )
         exit(1);
     }
 
-    // position get pointer
-    ioFile.seekg( 0, ios::end );  // 0 bytes from end of file
-    // data length (bytes) in file divided by bytes per record
-    int records = ioFile.tellg() / sizeof( Student );
-    ioFile.seekg( 0, ios::beg );  // reset get pointer
-
-    return records;
-} // end function getRecordRequest
+    // the count is kept in the header, the file size is not used
+    FileHeader header;
+    string reason;
+    if( !readFileHeader( ioFile, header ) || !checkFileHeader( header, reason ) )
+    {
+        return 0;
+    }
+    return header.recordCount;
+} // end function getRecordCount
 
 // ask for a record number to search
 int getRecordRequest( int recordCount )
@@ -112,20 +151,130 @@ int getRecordRequest( int recordCount )
    return request;
 } // end function getRecordRequest
 
-// read a record in the file
-Student readRecord( fstream &inFile, int recordNumber )
+// byte offset of a (record numbered) location in the file
+streampos recordPosition( int recordNumber )
+{
+    // records follow the file header
+    return FILE_HEADER_SIZE
+           + static_cast< streamoff >( recordNumber - 1 ) * sizeof( Student );
+} // end function recordPosition
+
+// read a record in the file without locking it
+static Student fetchRecord( fstream &inFile, int recordNumber )
 {
     Student rec;
     // position the get pointer
-    inFile.seekg( ( recordNumber - 1 ) * sizeof( Student ) );
+    inFile.seekg( recordPosition( recordNumber ) );
     // read the record
     inFile.read(
             reinterpret_cast<char *>( &rec ),
             sizeof( Student )
     );
+    // a record past the end of file has nothing to check
+    if( inFile.gcount() == sizeof( Student ) )
+        recordChecksums.verify( recordNumber, 1, &rec );
+    return rec;
+} // end function fetchRecord
+
+// read a record in the file
+Student readRecord( fstream &inFile, int recordNumber )
+{
+    Student rec;
+    if( bufferPool.isEnabled() )
+    {
+        // a record past the end of file reads as a null record
+        bufferPool.read( inFile, recordNumber, rec );
+    }
+    else
+    {
+        // a shared lock keeps a writer from changing the record
+        // while it is read, other readers are not blocked
+        if( recordLocks.isOpen() )
+            recordLocks.lock( recordNumber, 1, SHARED_LOCK );
+        rec = fetchRecord( inFile, recordNumber );
+        if( recordLocks.isOpen() )
+            recordLocks.unlock( recordNumber, 1 );
+    }
+
+    // a write of the open batch is newer than the file
+    writeLog.pendingRecord( recordNumber, rec );
     return rec;
 } // end function readRecord
 
+// read count records starting at a (record numbered) location
+// into an array with one read, return number of records read
+int readRecords( fstream &inFile, int first, int count, Student *recs )
+{
+    if( count <= 0 )
+    {
+        return 0;
+    }
+
+    // a range is read from the file, after the
+    // records written to the pool are in it
+    if( bufferPool.isEnabled() )
+        bufferPool.flush( inFile );
+
+    if( recordLocks.isOpen() )
+        recordLocks.lock( first, count, SHARED_LOCK );
+    // position the get pointer
+    inFile.seekg( recordPosition( first ) );
+    // read the whole range at once
+    inFile.read(
+            reinterpret_cast<char *>( recs ),
+            static_cast< streamsize >( count ) * sizeof( Student )
+    );
+    // a short read at the end of file leaves the stream failed
+    int records = inFile.gcount() / sizeof( Student );
+    inFile.clear();
+    recordChecksums.verify( first, records, recs );
+    if( recordLocks.isOpen() )
+        recordLocks.unlock( first, count );
+
+    // writes of the open batch are newer than the file
+    for( int i = 0; writeLog.pendingCount() > 0 && i < records; i++ )
+        writeLog.pendingRecord( first + i, recs[i] );
+
+    return records;
+} // end function readRecords
+
+// write count records from an array starting at a
+// (record numbered) location with one write
+bool writeRecords( fstream &ioFile, int first, int count, const Student *recs )
+{
+    if( count <= 0 )
+    {
+        return true;
+    }
+
+    // cached pages of the range would hide the new records
+    if( bufferPool.isEnabled() )
+        bufferPool.discard( ioFile, first, count );
+
+    if( recordLocks.isOpen() )
+        recordLocks.lock( first, count, EXCLUSIVE_LOCK );
+    // position the put pointer
+    ioFile.seekp( recordPosition( first ) );
+    // write the whole range at once
+    ioFile.write(
+            reinterpret_cast< const char * >( recs ),
+            static_cast< streamsize >( count ) * sizeof( Student )
+    );
+    // readers of other processes must see the records once unlocked
+    ioFile.flush();
+    if( ioFile.good() )
+        recordChecksums.update( first, count, recs );
+    if( recordLocks.isOpen() )
+        recordLocks.unlock( first, count );
+    if( !ioFile.good() )
+    {
+        return false;
+    }
+
+    // records written past the end are counted once they are in the file
+    return extendRecordCount( ioFile, first + count - 1 );
+} // end function writeRecords
+
 // print a row of field headings
 void printRecordHeader()
 {
@@ -136,18 +285,100 @@ void printRecordHeader()
         << fixed << setprecision(2) << endl;
 } // end function printRecordHeader
 
-// update a record at a (record numbered) location
-bool updateRecord( fstream &ioFile, int recordNumber )
+// replace the record at a (record numbered) location, through
+// the write-ahead log when the log of the file is open
+bool writeRecord( fstream &ioFile, int recordNumber, const Student &rec )
+{
+    if( writeLog.isOpen() )
+    {
+        return writeLog.write( ioFile, recordNumber, rec );
+    }
+    return applyRecord( ioFile, recordNumber, rec );
+} // end function writeRecord
+
+// overwrite the record at a (record numbered) location in place and
+// keep the secondary index on the file in step with it
+bool applyRecord( fstream &ioFile, int recordNumber, const Student &rec,
+                  const Student *replaced )
+{
+    Student oldRec;
+    bool appended;  // the record is past the end of file
+    if( bufferPool.isEnabled() )
+    {
+        // the record is written to its cached page, and
+        // reaches the file when the page is written back
+        appended = !bufferPool.read( ioFile, recordNumber, oldRec );
+        bufferPool.write( ioFile, recordNumber, rec );
+    }
+    else
+    {
+        // an exclusive lock keeps readers and other writers out
+        // of the record until the new record is in the file
+        if( recordLocks.isOpen() )
+            recordLocks.lock( recordNumber, 1, EXCLUSIVE_LOCK );
+
+        // the index entry to replace comes from the current record
+        oldRec = fetchRecord( ioFile, recordNumber );
+        // a slot appended at the end of file has no current record
+        appended = !ioFile;
+        ioFile.clear();
+
+        // position the put pointer
+        ioFile.seekp( recordPosition( recordNumber ) );
+        // write the record
+        ioFile.write(
+                reinterpret_cast< const char * >( &rec ),
+                sizeof( Student )
+        );
+        ioFile.flush();
+        if( ioFile.good() )
+            recordChecksums.update( recordNumber, 1, &rec );
+        if( recordLocks.isOpen() )
+            recordLocks.unlock( recordNumber, 1 );
+        if( !ioFile.good() )
+        {
+            return false;
+        }
+    }
+
+    // a replayed append may be in the file but not yet counted
+    if( freeSlots.isLoaded() && freeSlots.getRecordCount() < recordNumber )
+        appended = true;
+    if( appended && !extendRecordCount( ioFile, recordNumber ) )
+    {
+        return false;
+    }
+
+    if( replaced != 0 )
+    {
+        // the record in the file may already be the new one, with
+        // or without its index entries, so they are mended from
+        // the record the write replaced
+        mendIndexes( recordNumber, *replaced, oldRec, rec );
+    }
+    else
+    {
+        updateNameIndex( recordNumber, oldRec, rec );
+        updateScoreIndex( recordNumber, oldRec, rec );
+    }
+    // keep the free-slot bitmap in step with the slot
+    if( freeSlots.isLoaded() )
+    {
+        // a replayed write may be past the end of the bitmap
+        freeSlots.extendTo( recordNumber );
+        if( isDeletedRecord( rec ) )
+            freeSlots.markFree( recordNumber );
+        else
+            freeSlots.markUsed( recordNumber );
+    }
+    return true;
+} // end function applyRecord
+
+// read the fields of a record from the user
+void inputRecord( Student &rec )
 {
-    Student rec;
     string name;
     float score;
-    int length;
-
-    // position the get pointer
-    ioFile.seekp( ( recordNumber - 1 ) * sizeof( Student ) );
-    // copy recordNumber to the record's id field
-    rec.setID( recordNumber );
 
     // read name field from the user
     do
@@ -166,42 +397,58 @@ bool updateRecord( fstream &ioFile, int recordNumber )
     }while( score < 0.0 || score > 100.0 );
     // set the record's score field to the user input
     rec.setScore( score );
+} // end function inputRecord
+
+// update a record at a (record numbered) location
+bool updateRecord( fstream &ioFile, int recordNumber )
+{
+    Student rec;
+
+    // copy recordNumber to the record's id field
+    rec.setID( recordNumber );
+    // read the other fields from the user
+    inputRecord( rec );
 
     // write the record
-    ioFile.write(
-            reinterpret_cast< char * >( &rec ),
-            sizeof( Student )
-    );
-    if( ioFile.good() )
+    return writeRecord( ioFile, recordNumber, rec );
+} // end function updateRecord
+
+// insert a record in a free slot, or at the end of the file
+// if there is none, return its record number (0 on failure)
+int insertRecord( fstream &ioFile, Student rec )
+{
+    if( !freeSlots.isLoaded() && !freeSlots.load( ioFile ) )
     {
-        return true;
+        return 0;
     }
 
-    return false;
-} // end function updateRecord
+    // a free slot, or a new one at the end of the file, that no
+    // other process inserting at the same time can take
+    int recordNumber = freeSlots.claimSlot( ioFile );
+    if( recordNumber == 0 )
+    {
+        return 0;
+    }
+
+    // copy recordNumber to the record's id field
+    rec.setID( recordNumber );
+    if( !writeRecord( ioFile, recordNumber, rec ) )
+    {
+        return 0;
+    }
+    return recordNumber;
+} // end function insertRecord
 
 // dalete a record at a (record numbered) location
 bool deleteRecord( fstream &ioFile, int recordNumber )
 {
-    // position the get pointer
-    ioFile.seekp( ( recordNumber - 1 ) * sizeof( Student ) );
-
     cout << "Writing null record...\n";
     // write the record
-    ioFile.write(
-            reinterpret_cast< char * >( &nullStudentRecord ),
-            sizeof( Student )
-    );
-    if( ioFile.good() )
-    {
-        return true;
-    }
-
-    return false;
+    return writeRecord( ioFile, recordNumber, nullStudentRecord );
 } // end function deleteRecord
 
 // check if a record is deleted
-bool isDeletedRecord( Student rec )
+bool isDeletedRecord( const Student &rec )
 {
     // check if the record is null
     return rec.isNullRecord();
@@ -4,6 +4,7 @@
 
 #include <fstream>
 #include <string>
+#include <stdint.h>
 using namespace std;
 
 // const length for name char array
@@ -22,30 +23,49 @@ public:
     Student &setScore( float score );
     float getScore() const { return score_; }
     // print record stored in "this" object
-    void print();
+    void print() const;
     // check if "this" record is deleted
-    bool isNullRecord();
+    bool isNullRecord() const;
+    // hash of the field offsets and sizes, stored in file headers
+    static uint32_t layoutHash();
 
 private:
-    // alias definition for a student record
-    int id_;
+    // the record as laid out in the file: no padding is left to
+    // the compiler, the spare bytes are an explicit zeroed field
+    int32_t id_;
     char name_[NAME_LENGTH];
+    char reserved_[2];
     float score_;
 };
 
-// get number of student records in the file
+// get number of student records in the file from its header
 int getRecordCount( fstream & );
 // ask for a record number to search
 int getRecordRequest( int );
+// byte offset of a (record numbered) location in the file
+streampos recordPosition( int );
 // read a record in the file
 Student readRecord( fstream &, int );
+// read a range of records with a single read, return records read
+int readRecords( fstream &, int, int, Student * );
+// write a range of records with a single write
+bool writeRecords( fstream &, int, int, const Student * );
 // print a row of field headings
 void printRecordHeader();
+// replace a record at a (record numbered) location
+bool writeRecord( fstream &, int, const Student & );
+// overwrite a record in place, bypassing the write-ahead log; a
+// replayed write also passes the record it replaced, as logged
+bool applyRecord( fstream &, int, const Student &, const Student * = 0 );
+// read the fields of a record from the user
+void inputRecord( Student & );
 // update a record at a (record numbered) location
 bool updateRecord( fstream &, int );
+// insert a record in a free slot, return its record number
+int insertRecord( fstream &, Student );
 // dalete a record at a (record numbered) location
 bool deleteRecord( fstream &, int );
 // check if a record is deleted
-bool isDeletedRecord( Student );
+bool isDeletedRecord( const Student & );
 
 #endif
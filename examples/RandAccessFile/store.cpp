@@ -0,0 +1,138 @@
+// store.cpp
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fileheader.h"
+#include "store.h"
+
+// create a closed store
+StudentStore::StudentStore()
+    : opened_(false), map_(0), buffer_(0), length_(0),
+      records_(0), recordCount_(0)
+{
+} // end StudentStore constructor
+
+// create a store and open the file
+StudentStore::StudentStore( const string &fileName )
+    : opened_(false), map_(0), buffer_(0), length_(0),
+      records_(0), recordCount_(0)
+{
+    open( fileName );
+} // end StudentStore constructor
+
+// unmap the file
+StudentStore::~StudentStore()
+{
+    close();
+} // end StudentStore destructor
+
+// map a file of Student records into memory
+bool StudentStore::open( const string &fileName )
+{
+    close();
+
+    int fd = ::open( fileName.c_str(), O_RDONLY );
+    if( fd < 0 )
+    {
+        return false;
+    }
+
+    struct stat info;
+    if( fstat( fd, &info ) < 0 )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    // the header gives the record count, a file of another
+    // format or record layout is not opened
+    FileHeader header;
+    string reason;
+    if( pread( fd, &header, sizeof( FileHeader ), 0 )
+            != static_cast< ssize_t >( sizeof( FileHeader ) )
+        || !checkFileHeader( header, reason ) )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    // counted records not yet written are not part of the store
+    off_t available = ( info.st_size - FILE_HEADER_SIZE ) / sizeof( Student );
+    recordCount_ = ( header.recordCount < available ? header.recordCount
+                                                    : available );
+    length_ = FILE_HEADER_SIZE + recordCount_ * sizeof( Student );
+
+    // a file without records has nothing to map
+    if( recordCount_ > 0 )
+    {
+        map_ = mmap( 0, length_, PROT_READ, MAP_SHARED, fd, 0 );
+        if( map_ == MAP_FAILED )
+        {
+            map_ = 0;
+            length_ = 0;
+            ::close( fd );
+            return load( fileName );
+        }
+        // records are mostly scanned front to back
+        madvise( map_, length_, MADV_SEQUENTIAL );
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    ::close( fd );
+    // records follow the header in the mapping
+    if( map_ != 0 )
+        records_ = reinterpret_cast< const Student * >(
+                static_cast< const char * >( map_ ) + FILE_HEADER_SIZE );
+    opened_ = true;
+    return true;
+} // end function open
+
+// read all records of a file that cannot be mapped
+bool StudentStore::load( const string &fileName )
+{
+    fstream fin( fileName.c_str(), ios::in | ios::binary );
+    if( !fin )
+    {
+        recordCount_ = 0;
+        return false;
+    }
+
+    // one read for the whole file
+    buffer_ = new Student[ recordCount_ ];
+    recordCount_ = readRecords( fin, 1, recordCount_, buffer_ );
+    records_ = buffer_;
+    opened_ = true;
+    return true;
+} // end function load
+
+// unmap the file
+void StudentStore::close()
+{
+    if( map_ != 0 )
+    {
+        munmap( map_, length_ );
+    }
+    delete [] buffer_;
+    opened_ = false;
+    map_ = 0;
+    buffer_ = 0;
+    length_ = 0;
+    records_ = 0;
+    recordCount_ = 0;
+} // end function close
+
+// record at a (record numbered) location with a bounds check
+const Student &StudentStore::at( int recordNumber ) const
+{
+    if( recordNumber < 1 || recordNumber > recordCount_ )
+    {
+        stringstream ss;
+        ss << "record number " << recordNumber << " is out of range";
+        throw out_of_range( ss.str() );
+    }
+    return records_[ recordNumber - 1 ];
+} // end function at
@@ -0,0 +1,64 @@
+// store.h
+#ifndef STORE_H
+#define STORE_H
+
+#include <cstddef>
+#include <string>
+#include "record.h"
+using namespace std;
+
+// read-only view of a random access file of Student records.
+// the file is mapped into memory, so a record is accessed in
+// place instead of being copied out of the file on every lookup.
+// where the file cannot be mapped, it is loaded with one batched
+// read and served from memory the same way.
+class StudentStore
+{
+public:
+    // records are contiguous in the mapping, so a plain
+    // pointer serves as the scan iterator
+    typedef const Student *const_iterator;
+
+    // create a closed store
+    StudentStore();
+    // create a store and open the file
+    explicit StudentStore( const string & );
+    // unmap the file
+    ~StudentStore();
+
+    // map a file written by CreateRAFile, return false on failure
+    bool open( const string & );
+    // unmap the file
+    void close();
+    bool isOpen() const { return opened_; }
+
+    // number of records in the mapped file
+    int getRecordCount() const { return recordCount_; }
+    // record at a (record numbered) location, no bounds check
+    const Student &operator[]( int recordNumber ) const
+    {
+        return records_[ recordNumber - 1 ];
+    }
+    // record at a (record numbered) location, throws out_of_range
+    const Student &at( int ) const;
+
+    // iterators to scan all records in the file
+    const_iterator begin() const { return records_; }
+    const_iterator end() const { return records_ + recordCount_; }
+
+private:
+    // a mapping has a single owner
+    StudentStore( const StudentStore & );
+    StudentStore &operator=( const StudentStore & );
+    // read the file into memory with a batched read
+    bool load( const string & );
+
+    bool opened_;
+    void *map_;              // start of the mapping
+    Student *buffer_;        // records loaded when mapping failed
+    size_t length_;          // length of the mapping (bytes)
+    const Student *records_; // first record in the mapping
+    int recordCount_;
+};
+
+#endif
@@ -0,0 +1,222 @@
+// wal.cpp
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "wal.h"
+#include "pool.h"
+#include "checksum.h"
+
+// marks the start of a log entry
+const uint32_t LOG_MAGIC = 0x57414c31;  // "WAL1"
+// entries logged before the log is emptied by a checkpoint
+const int CHECKPOINT_ENTRIES = 1024;
+
+// write-ahead log of the records file used by the tools
+WriteAheadLog writeLog;
+
+// checksum of a log entry (32 bit FNV-1a of its fields)
+uint32_t logChecksum( const LogEntry &entry )
+{
+    const unsigned char *bytes =
+        reinterpret_cast< const unsigned char * >( &entry );
+    uint32_t hash = 2166136261u;
+    for( size_t i = 0; i < offsetof( LogEntry, checksum ); i++ )
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+} // end function logChecksum
+
+// create a closed log
+WriteAheadLog::WriteAheadLog()
+    : logFd_(-1), dataFd_(-1), inBatch_(false), logged_(0)
+{
+} // end WriteAheadLog constructor
+
+// release the file descriptors
+WriteAheadLog::~WriteAheadLog()
+{
+    if( logFd_ >= 0 )
+        ::close( logFd_ );
+    if( dataFd_ >= 0 )
+        ::close( dataFd_ );
+} // end WriteAheadLog destructor
+
+// open the log of a records file and replay it
+bool WriteAheadLog::open( fstream &ioFile, const string &fileName )
+{
+    logFd_ = ::open( LOG_FILE, O_RDWR | O_CREAT | O_APPEND, 0644 );
+    dataFd_ = ::open( fileName.c_str(), O_RDWR );
+    if( logFd_ < 0 || dataFd_ < 0 )
+    {
+        return false;
+    }
+
+    // a writer session holds a shared lock on the records file,
+    // a vacuum takes it exclusively before it replaces the file
+    flock( dataFd_, LOCK_SH );
+    struct stat opened, current;
+    if( fstat( dataFd_, &opened ) < 0 || stat( fileName.c_str(), &current ) < 0
+        || opened.st_ino != current.st_ino || opened.st_dev != current.st_dev )
+    {
+        // the file was replaced since the caller opened it
+        ::close( logFd_ );
+        ::close( dataFd_ );
+        logFd_ = dataFd_ = -1;
+        return false;
+    }
+
+    // writes of a crashed session are redone before any new write
+    flock( logFd_, LOCK_EX );
+    bool replayed = replay( ioFile ) && checkpoint( ioFile );
+    flock( logFd_, LOCK_UN );
+    return replayed;
+} // end function open
+
+// commit pending writes, checkpoint and close the log
+bool WriteAheadLog::close( fstream &ioFile )
+{
+    if( !isOpen() )
+    {
+        return true;
+    }
+
+    bool closed = commitBatch( ioFile );
+    flock( logFd_, LOCK_EX );
+    closed = checkpoint( ioFile ) && closed;
+    flock( logFd_, LOCK_UN );
+
+    ::close( logFd_ );
+    ::close( dataFd_ );
+    logFd_ = dataFd_ = -1;
+    return closed;
+} // end function close
+
+// apply the complete entries of the log to the records file
+bool WriteAheadLog::replay( fstream &ioFile )
+{
+    LogEntry entry;
+    off_t offset = 0;
+
+    // a torn entry at the end was never committed, stop there
+    while( pread( logFd_, &entry, sizeof( LogEntry ), offset )
+               == static_cast< ssize_t >( sizeof( LogEntry ) )
+           && entry.magic == LOG_MAGIC
+           && entry.checksum == logChecksum( entry ) )
+    {
+        // a record image is applied whole and the index entries are
+        // mended from the replaced record, so replay is idempotent
+        if( !applyRecord( ioFile, entry.recordNumber, entry.record,
+                          &entry.replaced ) )
+        {
+            return false;
+        }
+        offset += sizeof( LogEntry );
+    }
+    return true;
+} // end function replay
+
+// log a record write
+bool WriteAheadLog::write( fstream &ioFile, int recordNumber,
+                           const Student &rec )
+{
+    LogEntry entry = LogEntry();
+    entry.magic = LOG_MAGIC;
+    entry.recordNumber = recordNumber;
+    // the record as the batch left it so far, or as in the file
+    entry.replaced = readRecord( ioFile, recordNumber );
+    // a slot appended at the end of file has no current record
+    ioFile.clear();
+    entry.record = rec;
+    entry.checksum = logChecksum( entry );
+
+    pending_.push_back( entry );
+    pendingRecords_[ recordNumber ] = rec;
+
+    // outside a batch every write is its own commit
+    return inBatch_ ? true : commitBatch( ioFile );
+} // end function write
+
+// hold writes until commitBatch()
+void WriteAheadLog::beginBatch()
+{
+    inBatch_ = true;
+} // end function beginBatch
+
+// make all pending writes durable and apply them
+bool WriteAheadLog::commitBatch( fstream &ioFile )
+{
+    inBatch_ = false;
+    if( pending_.empty() )
+    {
+        return true;
+    }
+
+    // reads during the apply must see the file, not the batch
+    vector< LogEntry > batch;
+    batch.swap( pending_ );
+    pendingRecords_.clear();
+
+    // one append and one fsync for the whole batch
+    flock( logFd_, LOCK_EX );
+    size_t bytes = batch.size() * sizeof( LogEntry );
+    bool durable =
+        ::write( logFd_, &batch[0], bytes ) == static_cast< ssize_t >( bytes )
+        && fdatasync( logFd_ ) == 0;
+
+    // the log now holds the records, overwrite them in place
+    bool applied = durable;
+    for( size_t i = 0; durable && i < batch.size(); i++ )
+    {
+        applied = applyRecord( ioFile, batch[i].recordNumber,
+                               batch[i].record ) && applied;
+    }
+    logged_ += batch.size();
+    // committed records are visible to other processes once
+    // their pages are written back
+    if( bufferPool.isEnabled() )
+        applied = bufferPool.flush( ioFile ) && applied;
+
+    if( applied && logged_ >= CHECKPOINT_ENTRIES )
+    {
+        applied = checkpoint( ioFile );
+    }
+    flock( logFd_, LOCK_UN );
+
+    return applied;
+} // end function commitBatch
+
+// latest image of a record written but not yet committed
+bool WriteAheadLog::pendingRecord( int recordNumber, Student &rec ) const
+{
+    map< int, Student >::const_iterator found =
+        pendingRecords_.find( recordNumber );
+    if( found == pendingRecords_.end() )
+    {
+        return false;
+    }
+    rec = found->second;
+    return true;
+} // end function pendingRecord
+
+// flush the records file to disk and empty the log,
+// called with the log locked
+bool WriteAheadLog::checkpoint( fstream &ioFile )
+{
+    if( bufferPool.isEnabled() && !bufferPool.flush( ioFile ) )
+    {
+        return false;
+    }
+    ioFile.flush();
+    // the log may only be dropped once the records
+    // and their checksums are on disk
+    if( ioFile.bad() || fsync( dataFd_ ) != 0 || !recordChecksums.sync() )
+    {
+        return false;
+    }
+    logged_ = 0;
+    return ftruncate( logFd_, 0 ) == 0;
+} // end function checkpoint
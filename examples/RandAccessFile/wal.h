@@ -0,0 +1,82 @@
+// wal.h
+#ifndef WAL_H
+#define WAL_H
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "record.h"
+using namespace std;
+
+// file name of the write-ahead log of the records file
+const char LOG_FILE[] = "students.wal";
+
+// an entry of the log: the new image of a whole record, and the
+// record it replaces, from which a replay mends the indexes
+struct LogEntry
+{
+    uint32_t magic;       // marks the start of an entry
+    int32_t recordNumber; // location of the record
+    Student replaced;     // record before the write
+    Student record;       // record after the write
+    uint32_t checksum;    // checksum of the fields above
+};
+
+// append-only write-ahead log in front of record writes.
+// a write is appended to the log and made durable before the
+// record is overwritten in place, so a crash in the middle of a
+// write leaves a whole record image to replay. writes made in a
+// batch share a single log append and fsync (group commit).
+class WriteAheadLog
+{
+public:
+    WriteAheadLog();
+    ~WriteAheadLog();
+
+    // open the log of a records file and replay it, holding off a
+    // vacuum until close(). false if the file was replaced meanwhile
+    bool open( fstream &, const string & );
+    // commit pending writes, checkpoint and close the log
+    bool close( fstream & );
+    bool isOpen() const { return logFd_ >= 0; }
+
+    // log a record write, applied at once outside a batch
+    bool write( fstream &, int, const Student & );
+    // hold writes until commitBatch()
+    void beginBatch();
+    // make all writes of the batch durable with one fsync
+    // and apply them to the records file
+    bool commitBatch( fstream & );
+    // number of writes waiting for commit
+    int pendingCount() const { return static_cast< int >( pending_.size() ); }
+    // latest image of a record written but not yet committed
+    bool pendingRecord( int, Student & ) const;
+
+    // flush the records file to disk and empty the log
+    bool checkpoint( fstream & );
+
+private:
+    // a log has a single owner
+    WriteAheadLog( const WriteAheadLog & );
+    WriteAheadLog &operator=( const WriteAheadLog & );
+
+    // apply the complete entries of the log to the records file
+    bool replay( fstream & );
+
+    int logFd_;                        // log file
+    int dataFd_;                       // records file, for fsync
+    bool inBatch_;
+    int logged_;                       // entries since checkpoint
+    vector< LogEntry > pending_;       // writes of the open batch
+    map< int, Student > pendingRecords_;
+};
+
+// checksum of a log entry
+uint32_t logChecksum( const LogEntry & );
+
+// write-ahead log of the records file used by the tools
+extern WriteAheadLog writeLog;
+
+#endif